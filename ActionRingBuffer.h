@@ -101,6 +101,31 @@ class ActionRingBuffer {
     byte ElementsNb(void) const { return _elementsCurrentNb; }
 
 
+    // Return a pointer to the 'index'th oldest element of the buffer (index 0 is the next element to be popped)
+    // Allows an element to be modified in place while it is waiting in the buffer
+    // Return NULL when index is out of range
+    T* Element(byte index)
+    {
+      if (index >= _elementsCurrentNb) return NULL;
+      return &_buffer[(_head + index) % _size];
+    }
+
+
+    // Remove the 'index'th oldest element of the buffer (index 0 is the next element to be popped)
+    // The newer elements are moved one place back, so that the order of the remaining elements is kept
+    // Return TRUE when the element is removed, FALSE when index is out of range
+    boolean Remove(byte index, T& removedData)
+    {
+      if (index >= _elementsCurrentNb) return false;
+      removedData = _buffer[(_head + index) % _size];
+      for (byte i = index; i < _elementsCurrentNb - 1; i++)
+        _buffer[(_head + i) % _size] = _buffer[(_head + i + 1) % _size];
+      _tail = (_tail + _size - 1) % _size;
+      _elementsCurrentNb--;
+      return true;
+    }
+
+
     #ifdef ACTIONRINGBUFFER_STAT
     // Return Stat information
     void Info(String& str)
@@ -0,0 +1,191 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxAddressIndex.cpp
+// Author : Franck Marini
+// Description : Index of the com objects group addresses (lookup of the received telegrams target address)
+// Module dependencies : KnxComObject
+
+#include "KnxAddressIndex.h"
+
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+#define BITMAP_WORDS_NB 1024 // 65536 addresses / 64 bits
+#endif
+
+// Address index of the com objects list, when not declared with KNX_DEVICE_COM_OBJECTS() (no entries)
+// NB : weak definition, replaced by the one of KNX_DEVICE_COM_OBJECTS()
+extern const type_address_index_table knxComObjectsAddressIndex __attribute__((weak)) = { NULL, 0, 0 };
+
+// Entries order : increasing address, then increasing com object index
+static int CompareEntries(const void *a, const void *b)
+{
+const type_address_index_entry *entryA = (const type_address_index_entry *) a;
+const type_address_index_entry *entryB = (const type_address_index_entry *) b;
+  if (entryA->addr != entryB->addr) return (entryA->addr < entryB->addr) ? -1 : 1;
+  return (int) entryA->index - (int) entryB->index;
+}
+
+
+// Constructor
+KnxAddressIndex::KnxAddressIndex()
+{
+  _entries = NULL;
+  _entriesInFlash = false;
+  _entriesNb = 0;
+  _addressesNb = 0;
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+  _presenceBitmap = NULL;
+  _rankTable = NULL;
+  _runStartTable = NULL;
+#endif
+}
+
+
+// Destructor
+KnxAddressIndex::~KnxAddressIndex() { Clear(); }
+
+
+// Build the index with the com objects having "communication" attribute
+byte KnxAddressIndex::Build(KnxComObject comObjectsList[], type_com_obj_index listSize)
+{
+type_com_obj_index i, nb = 0;
+type_address_index_entry *entries;
+
+  Clear();
+  // Count all the com objects with communication indicator
+  for (i = 0; i < listSize; i++) if (comObjectsList[i].GetIndicator() & KNX_COM_OBJ_C_INDICATOR) nb++;
+  if (!nb) return KNX_ADDRESS_INDEX_OK;
+
+  entries = (type_address_index_entry *) malloc(nb * sizeof(type_address_index_entry));
+  if (entries == NULL) return KNX_ADDRESS_INDEX_ERROR;
+  for (i = 0; i < listSize; i++)
+  {
+    if (!(comObjectsList[i].GetIndicator() & KNX_COM_OBJ_C_INDICATOR)) continue;
+    entries[_entriesNb].addr = comObjectsList[i].GetAddr();
+    entries[_entriesNb++].index = i;
+  }
+  qsort(entries, _entriesNb, sizeof(type_address_index_entry), CompareEntries);
+  _entries = entries;
+  // Count the different addresses
+  for (i = 0; i < _entriesNb; i++) if ((i == 0) || (_entries[i].addr != _entries[i - 1].addr)) _addressesNb++;
+
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+  BuildBitmap();
+#endif
+  return KNX_ADDRESS_INDEX_OK;
+}
+
+
+// Attach an index built at compile time
+byte KnxAddressIndex::Attach(const type_address_index_table& table)
+{
+  Clear();
+  _entries = table.entries;
+  _entriesInFlash = true;
+  _entriesNb = table.entriesNb;
+  _addressesNb = table.addressesNb;
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+  BuildBitmap();
+#endif
+  return KNX_ADDRESS_INDEX_OK;
+}
+
+
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+// Build the presence bitmap and the rank tables from the entries
+// NB : the binary search is used in case of memory allocation failure
+void KnxAddressIndex::BuildBitmap(void)
+{
+type_com_obj_index i, nb;
+
+  if (!_entriesNb) return;
+  _presenceBitmap = (uint64_t *) calloc(BITMAP_WORDS_NB, sizeof(uint64_t));
+  _rankTable = (type_com_obj_index *) malloc(BITMAP_WORDS_NB * sizeof(type_com_obj_index));
+  _runStartTable = (type_com_obj_index *) malloc((_addressesNb + 1) * sizeof(type_com_obj_index));
+  if ((_presenceBitmap == NULL) || (_rankTable == NULL) || (_runStartTable == NULL))
+  { // not enough memory, the binary search is used
+    free(_presenceBitmap); _presenceBitmap = NULL;
+    free(_rankTable); _rankTable = NULL;
+    free(_runStartTable); _runStartTable = NULL;
+    return;
+  }
+  nb = 0; i = 0; // nb of addresses and entries already indexed
+  for (word w = 0; w < BITMAP_WORDS_NB; w++)
+  {
+    _rankTable[w] = nb; // nb of addresses lower than the block start
+    for ( ; (i < _entriesNb) && ((GetEntryAddr(i) >> 6) == w); i++)
+    {
+      if ((i > 0) && (GetEntryAddr(i) == GetEntryAddr(i - 1))) continue; // same run
+      _presenceBitmap[w] |= (uint64_t) 1 << (GetEntryAddr(i) & 63);
+      _runStartTable[nb++] = i;
+    }
+  }
+  _runStartTable[nb] = _entriesNb; // end of the last run
+}
+#endif
+
+
+// Clear the index
+void KnxAddressIndex::Clear(void)
+{
+  if (!_entriesInFlash) free((void *) _entries);
+  _entries = NULL;
+  _entriesInFlash = false;
+  _entriesNb = 0;
+  _addressesNb = 0;
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+  free(_presenceBitmap); _presenceBitmap = NULL;
+  free(_rankTable); _rankTable = NULL;
+  free(_runStartTable); _runStartTable = NULL;
+#endif
+}
+
+
+// Find the com objects assigned to the address
+type_com_obj_index KnxAddressIndex::Find(word addr, type_com_obj_index &firstEntry) const
+{
+word low, high, middle;
+
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+  if (_presenceBitmap != NULL)
+  { // constant time : the run position is given by the nb of assigned addresses lower than addr
+    uint64_t block = _presenceBitmap[addr >> 6];
+    uint64_t bit = (uint64_t) 1 << (addr & 63);
+    if (!(block & bit)) return 0;
+    middle = _rankTable[addr >> 6] + __builtin_popcountll(block & (bit - 1));
+    firstEntry = _runStartTable[middle];
+    return _runStartTable[middle + 1] - firstEntry;
+  }
+#endif
+  // binary search of the first entry with an address >= addr
+  low = 0; high = _entriesNb;
+  while (low < high)
+  {
+    middle = (low + high) >> 1;
+    if (GetEntryAddr(middle) < addr) low = middle + 1;
+    else high = middle;
+  }
+  if ((low == _entriesNb) || (GetEntryAddr(low) != addr)) return 0;
+  firstEntry = low;
+  // the run goes on as long as the address is the same
+  for (high = low + 1; (high < _entriesNb) && (GetEntryAddr(high) == addr); high++);
+  return high - low;
+}
+
+//EOF
@@ -0,0 +1,132 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxAddressIndex.h
+// Author : Franck Marini
+// Description : Index of the com objects group addresses (lookup of the received telegrams target address)
+// Module dependencies : KnxComObject
+
+#ifndef KNXADDRESSINDEX_H
+#define KNXADDRESSINDEX_H
+
+#include "Arduino.h"
+#include "KnxComObject.h"
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// By default, the lookup is a binary search in the table of the assigned addresses sorted by increasing value
+// (8 steps max for 255 objects, 12 steps for 4096 objects with KNX_COM_OBJ_16BIT_INDEX flag, 3 or 4 bytes of RAM
+// per object).
+// When the com objects list is declared with KNX_DEVICE_COM_OBJECTS() (see KnxComObjectTable.h), the sorted table
+// is built by the compiler and read in flash memory (see Attach()) : no RAM is used and nothing is built at startup.
+// When the RAM is not an issue (hosts), a presence bitmap of the 65536 group addresses (8KB) and a rank table (1KB)
+// give a constant time lookup whatever the nb of com objects : turn KNX_ADDRESS_INDEX_BITMAP flag on.
+// NB : the flag is not turned on by default on the non AVR targets, the 32 bits boards having a few tens of KB of RAM
+// #define KNX_ADDRESS_INDEX_BITMAP
+
+#define KNX_ADDRESS_INDEX_OK     0
+#define KNX_ADDRESS_INDEX_ERROR  255
+
+// Index entry : assigned address, with the index of the com object in the list
+typedef struct {
+  word addr;
+  type_com_obj_index index;
+} type_address_index_entry;
+
+// Index built at compile time (see KnxComObjectTable.h) : the entries are stored in flash memory
+typedef struct {
+  const type_address_index_entry *entries; // Entries in flash memory, same order as the ones built by Build()
+  type_com_obj_index entriesNb;            // Nb of entries
+  type_com_obj_index addressesNb;          // Nb of different addresses
+} type_address_index_table;
+
+// Address index of the com objects list declared with KNX_DEVICE_COM_OBJECTS() (see KnxComObjectTable.h)
+// NB : the definition is provided by KNX_DEVICE_COM_OBJECTS(), a weak definition without entries is used otherwise
+extern const type_address_index_table knxComObjectsAddressIndex;
+
+
+class KnxAddressIndex {
+    const type_address_index_entry *_entries; // Entries ordered by increasing address, then increasing com object index
+                                        // The entries of a group address shared by several com objects form a run
+    boolean _entriesInFlash;            // True when the entries are the flash ones of an attached index
+    type_com_obj_index _entriesNb;      // Nb of entries
+    type_com_obj_index _addressesNb;    // Nb of different addresses
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+    uint64_t *_presenceBitmap;          // 1 bit per group address, set when the address is assigned
+    type_com_obj_index *_rankTable;     // Nb of assigned addresses lower than each 64 addresses block
+    type_com_obj_index *_runStartTable; // Position of the run of each assigned address (+ end position)
+#endif
+
+  public:
+    // Constructor / Destructor
+    KnxAddressIndex();
+    ~KnxAddressIndex();
+
+  // INLINED functions (see definitions later in this file)
+    // Get the nb of assigned com objects
+    type_com_obj_index GetEntriesNb(void) const;
+
+    // Get the nb of com objects sharing their address with another com object (fan-out)
+    type_com_obj_index GetDuplicatesNb(void) const;
+
+    // Get the index (in the list) of the com object of an entry
+    type_com_obj_index GetComObjectIndex(type_com_obj_index entry) const;
+
+  // Functions NOT INLINED
+    // Build the index with the com objects having "communication" attribute
+    // The build is done in O(n log n)
+    // Return KNX_ADDRESS_INDEX_ERROR in case of memory allocation failure, else KNX_ADDRESS_INDEX_OK
+    byte Build(KnxComObject comObjectsList[], type_com_obj_index listSize);
+
+    // Attach an index built at compile time, the entries are read in flash memory (no RAM needed for the entries)
+    // Return KNX_ADDRESS_INDEX_OK
+    byte Attach(const type_address_index_table& table);
+
+    // Clear the index
+    void Clear(void);
+
+    // Find the com objects assigned to the address
+    // Return the nb of com objects (0 if the address is not assigned), and update firstEntry parameter with
+    // the first entry of the run : the com objects indexes are given by GetComObjectIndex(firstEntry + n)
+    // for n from 0 to nb-1, by increasing index
+    // NB : the function can be called from an interrupt routine
+    type_com_obj_index Find(word addr, type_com_obj_index &firstEntry) const;
+
+  private:
+    // Get the address of an entry (in RAM or in flash memory)
+    word GetEntryAddr(type_com_obj_index entry) const;
+
+#if defined(KNX_ADDRESS_INDEX_BITMAP)
+    // Build the presence bitmap and the rank tables from the entries
+    void BuildBitmap(void);
+#endif
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline type_com_obj_index KnxAddressIndex::GetEntriesNb(void) const { return _entriesNb; }
+
+inline type_com_obj_index KnxAddressIndex::GetDuplicatesNb(void) const { return _entriesNb - _addressesNb; }
+
+inline type_com_obj_index KnxAddressIndex::GetComObjectIndex(type_com_obj_index entry) const
+{ return (_entriesInFlash ? pgm_read_com_obj_index(&_entries[entry].index) : _entries[entry].index); }
+
+inline word KnxAddressIndex::GetEntryAddr(type_com_obj_index entry) const
+{ return (_entriesInFlash ? pgm_read_word(&_entries[entry].addr) : _entries[entry].addr); }
+
+#endif // KNXADDRESSINDEX_H
@@ -24,50 +24,23 @@
 
 #include "KnxComObject.h"
 
-// Data length is calculated in the same way as telegram payload length
-byte lengthCalculation(e_KnxDPT_ID dptId) {
-	return (pgm_read_byte(&KnxDPTFormatToLengthBit[ pgm_read_byte(&KnxDPTIdToFormat[dptId])] ) / 8) + 1;
-}
-
-
-// Contructor
-#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
-KnxComObject::KnxComObject(word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator )
-: _addr(addr), _dptId(dptId), _indicator(indicator), _length(lengthCalculation(dptId)), _prio(prio)
-#else
-KnxComObject::KnxComObject(word addr, e_KnxDPT_ID dptId, byte indicator )
-: _addr(addr), _dptId(dptId), _indicator(indicator), _length(lengthCalculation(dptId))
-#endif
-{
-	if (_length <= 2) _longValue = NULL; // short value case
-	else { // long value case
-		_longValue = (byte *) malloc(_length-1);
-		for (byte i=0; i <_length-1 ; i++) _longValue[i] = 0;
-	}  
-	if (_indicator & KNX_COM_OBJ_I_INDICATOR) _validity = false; // case of object with "InitRead" indicator
-	else _validity = true; // case of object without "InitRead" indicator
-}
-
-
-// Destructor
-KnxComObject::~KnxComObject() { if (_length > 2) free(_longValue); }
-
-
-
 // Get the com obj value (short and long value cases)
 void KnxComObject::GetValue(byte dest[]) const
 {
 	if (_length <=2) dest[0] = _value; // short value case, ReadValue(void) fct should rather be used
+	else if (_longValue == NULL) for (byte i=0; i < _length-1 ; i++) dest[i] = 0; // no data space attached
 	else for (byte i=0; i < _length-1 ; i++) dest[i] = _longValue[i]; // long value case
 }
 
 
 // Update the com obj value (short and long value cases)
-void KnxComObject::UpdateValue(const byte ori[])
+byte KnxComObject::UpdateValue(const byte ori[])
 {
 	if (_length <=2) _value = ori[0]; // short value case, UpdateValue(byte) fct should rather be used
+	else if (_longValue == NULL) return KNX_COM_OBJECT_ERROR; // no data space attached, the value is not updated
 	else for (byte i=0; i < _length-1 ; i++) _longValue[i] = ori[i]; // long value case
 	_validity = true;  // com obj set to valid
+	return KNX_COM_OBJECT_OK;
 }
 
 
@@ -77,6 +50,7 @@ byte KnxComObject::UpdateValue(const KnxTelegram& ori)
 	if (ori.GetPayloadLength() != GetLength()) return KNX_COM_OBJECT_ERROR; // Error : telegram payload length differs from com obj one
 	if (_length == 1) _value = ori.GetFirstPayloadByte();
 	else if (_length == 2) ori.GetLongPayload(&_value,1);
+	else if (_longValue == NULL) return KNX_COM_OBJECT_ERROR; // no data space attached
 	else ori.GetLongPayload(_longValue, _length - 1);
 	_validity = true;  // com object set to valid
 	return KNX_COM_OBJECT_OK;
@@ -97,10 +71,57 @@ void KnxComObject::CopyValue(KnxTelegram& dest) const
 {
 	if (_length == 1) dest.SetFirstPayloadByte(_value);
 	else if (_length == 2 )dest.SetLongPayload(&_value, 1);
+	else if (_longValue == NULL) dest.ClearLongPayload(); // no data space attached
 	else dest.SetLongPayload(_longValue, _length - 1);
 }
 
 
+// Build a whole telegram from the pre-encoded header
+void KnxComObject::CopyToTelegram(KnxTelegram& dest, e_KnxCommand command) const
+{
+	if (command == KNX_COMMAND_VALUE_READ) dest.BuildFromHeader(_header, _headerXorSum, command, 0, NULL);
+	else if (_length == 1) dest.BuildFromHeader(_header, _headerXorSum, command, _value, NULL);
+	else if (_length == 2) dest.BuildFromHeader(_header, _headerXorSum, command, 0, &_value);
+	else dest.BuildFromHeader(_header, _headerXorSum, command, 0, _longValue);
+}
+
+
+// Set the source address of the pre-encoded header
+void KnxComObject::SetSourceAddress(word addr)
+{
+	_headerXorSum ^= _header[1] ^ _header[2];
+	_header[1] = (byte)(addr >> 8); _header[2] = (byte) addr;
+	_headerXorSum ^= _header[1] ^ _header[2];
+}
+
+
+// Get the size of the data spaces needed by the long values of a com objs list
+unsigned long KnxComObject::GetLongValuesSize(const KnxComObject list[], type_com_obj_index listSize, boolean notAttachedOnly)
+{
+unsigned long size = 0;
+	for (type_com_obj_index i = 0; i < listSize; i++)
+	{
+		if (list[i]._length <= 2) continue; // short value
+		if (notAttachedOnly && (list[i]._longValue != NULL)) continue;
+		size += list[i]._length - 1;
+	}
+	return size;
+}
+
+
+// Attach the long values without data space of a com objs list to consecutive parts of an arena
+void KnxComObject::AttachLongValuesArena(KnxComObject list[], type_com_obj_index listSize, byte arena[])
+{
+	for (type_com_obj_index i = 0; i < listSize; i++)
+	{
+		if ((list[i]._length <= 2) || (list[i]._longValue != NULL)) continue;
+		list[i]._longValue = arena;
+		for (byte j = 0; j < list[i]._length - 1; j++) arena[j] = 0;
+		arena += list[i]._length - 1;
+	}
+}
+
+
 // DEBUG function
 void KnxComObject::Info(String& str) const
 {
@@ -126,7 +147,7 @@ byte length = GetLength();
 	else 
         {
 		str+="\nLongValue=";
-		byte *longValue = (byte *) malloc(length- 1);
+		byte longValue[KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2]; // no dynamic allocation (no leak)
                 GetValue(longValue);
 		for (byte i = 0; i < length-1; i++) str+=String(longValue[i], HEX)+' ';
 	}
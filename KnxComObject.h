@@ -33,6 +33,11 @@
 // turn KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES flag on to allow support of all the priorities
 // #define KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
 
+// By default, the com objects indexes are 8 bits values : a device has 255 com objects max
+// turn KNX_COM_OBJ_16BIT_INDEX flag on to get 16 bits indexes (65535 com objects max, e.g. gateway on a host)
+// NB : the knxEvents() callback parameter is then a word (see KnxDevice.h)
+// #define KNX_COM_OBJ_16BIT_INDEX
+
 // Definition of com obj indicator values
 // See "knx.org" for com obj indicators specification
 // INDICATOR field : B7  B6  B5  B4  B3  B2  B1  B0
@@ -58,9 +63,25 @@
 #define KNX_COM_OBJECT_OK       0
 #define KNX_COM_OBJECT_ERROR    255
 
+// Index of a com object in a list (also used for the nb of com objects of a list)
+#ifdef KNX_COM_OBJ_16BIT_INDEX
+typedef word type_com_obj_index;
+#define pgm_read_com_obj_index(addr) pgm_read_word(addr) // Read an index stored in flash memory
+#else
+typedef byte type_com_obj_index;
+#define pgm_read_com_obj_index(addr) pgm_read_byte(addr)
+#endif
+#define KNX_COM_OBJ_INDEX_MAX ((type_com_obj_index) ~0) // Max nb of com objects in a list
+
 
 class KnxComObject {
-	const word _addr; // Group Address value
+	// Pre-encoded header of the telegrams sent by the com obj : control field (with the com obj priority),
+	// source address, group address and routing field (with the com obj length).
+	// A telegram is built by copying the header and adding the command and value bytes (see CopyToTelegram()).
+	// NB : the group address value is stored in the header only
+	byte _header[KNX_TELEGRAM_HEADER_SIZE];
+
+	byte _headerXorSum; // XOR sum of the header bytes (checksum part of the header)
 
 	const byte _dptId; // Datapoint type
 
@@ -86,19 +107,33 @@ class KnxComObject {
 			byte _notUSed;
 		};
 		// field used in case of long value (2 bytes width or more, i.e. length > 2)
-		// The data space is allocated dynamically by the constructor
+		// The data space (length-1 bytes) is not allocated by the com obj : it is a part of a values arena
+		// shared by all the com objs of a list (see AttachLongValuesArena()), or a storage given to the constructor.
+		// The value is 0 while no data space is attached.
 		byte *_longValue;
 	};
+
+	// Constructor used by the public ones (the length is calculated once)
+	constexpr KnxComObject(word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator, byte length, byte longValue[]);
 	
 public:
   // Constructor :
+  // The constructor is "constexpr" : a com objects list defined with constant parameters is fully
+  // initialized at compile time (length, header...) and no code is executed at startup
+  // NB : the data space of a long value is attached later (see AttachLongValuesArena())
 #ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES	
-	KnxComObject(word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator );
+	constexpr KnxComObject(word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator );
 #else
-	KnxComObject(word addr, e_KnxDPT_ID dptId, byte indicator );
+	constexpr KnxComObject(word addr, e_KnxDPT_ID dptId, byte indicator );
+#endif
+
+  // Constructor with the data space of the long value (length-1 bytes initialized to 0, ignored for short values)
+  // NB : used by KNX_DEVICE_COM_OBJECTS() with the values arena sized at compile time (see KnxComObjectTable.h)
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES	
+	constexpr KnxComObject(byte longValue[], word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator );
+#else
+	constexpr KnxComObject(byte longValue[], word addr, e_KnxDPT_ID dptId, byte indicator );
 #endif
-  // Destructor
-	~KnxComObject();
 
   // INLINED functions (see definitions later in this file)
 	word GetAddr(void) const;
@@ -124,13 +159,18 @@ public:
 	// NB : the function does not change the validity.
 	void ToggleValue(void);
 
+	// Clear the validity of a com object having "InitRead" indicator (no effect on the other ones) :
+	// its value is read on the bus again by the next init
+	void ClearValidity(void);
+
   // functions NOT INLINED :
 
 	// Get the com obj value (short and long value cases)
 	void GetValue(byte dest[]) const;
 
 	// Update the com obj value (short and long value cases)
-	void UpdateValue(const byte ori[]);
+	// Return ERROR if the com obj is long value without data space attached (the value is not updated), else return OK
+	byte UpdateValue(const byte ori[]);
 
 	// Update the com obj value with a telegram payload content
 	// Return ERROR if the telegram payload length differs from com obj one, else return OK
@@ -142,13 +182,57 @@ public:
 	// Copy the com obj value into a telegram object
 	void CopyValue(KnxTelegram& dest) const;
 
+	// Build a whole telegram (with checksum) from the pre-encoded header, with the given command :
+	// the com obj value is copied for WRITE and RESPONSE commands, the payload is cleared for READ command
+	void CopyToTelegram(KnxTelegram& dest, e_KnxCommand command) const;
+
+	// Set the source address of the pre-encoded header (i.e. the physical address of the device)
+	void SetSourceAddress(word addr);
+
 	// DEBUG function
 	void Info(String&) const;
+
+  // Values arena functions :
+	// Get the size of the data spaces needed by the long values of a com objs list
+	// (only the values without data space attached when notAttachedOnly is true)
+	static unsigned long GetLongValuesSize(const KnxComObject list[], type_com_obj_index listSize, boolean notAttachedOnly = false);
+
+	// Attach the long values without data space of a com objs list to consecutive parts of an arena
+	// The arena size shall be GetLongValuesSize(list, listSize, true), the values are initialized to 0
+	static void AttachLongValuesArena(KnxComObject list[], type_com_obj_index listSize, byte arena[]);
 };
 
 
 // --------------- Definition of the INLINED functions -----------------
-inline word KnxComObject::GetAddr(void) const { return _addr; }
+// NB : the source address of the header is set later (SetSourceAddress())
+inline constexpr KnxComObject::KnxComObject(word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator, byte length,
+                                            byte longValue[])
+: _header{ (byte)((CONTROL_FIELD_DEFAULT_VALUE & ~CONTROL_FIELD_PRIORITY_MASK) | prio), 0, 0,
+           (byte)(addr >> 8), (byte) addr, (byte)((ROUTING_FIELD_DEFAULT_VALUE & ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK) | length) },
+  _headerXorSum((byte)(((CONTROL_FIELD_DEFAULT_VALUE & ~CONTROL_FIELD_PRIORITY_MASK) | prio) ^ (addr >> 8) ^ addr
+                       ^ ((ROUTING_FIELD_DEFAULT_VALUE & ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK) | length))),
+  _dptId(dptId), _indicator(indicator), _length(length),
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+  _prio(prio),
+#endif
+  _validity(!(indicator & KNX_COM_OBJ_I_INDICATOR)), // only the objects with "InitRead" indicator are not valid
+  _longValue((length > 2) ? longValue : NULL) {}
+
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+inline constexpr KnxComObject::KnxComObject(word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator)
+: KnxComObject(addr, dptId, prio, indicator, KnxDPTLength(dptId), NULL) {}
+
+inline constexpr KnxComObject::KnxComObject(byte longValue[], word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator)
+: KnxComObject(addr, dptId, prio, indicator, KnxDPTLength(dptId), longValue) {}
+#else
+inline constexpr KnxComObject::KnxComObject(word addr, e_KnxDPT_ID dptId, byte indicator)
+: KnxComObject(addr, dptId, KNX_PRIORITY_NORMAL_VALUE, indicator, KnxDPTLength(dptId), NULL) {}
+
+inline constexpr KnxComObject::KnxComObject(byte longValue[], word addr, e_KnxDPT_ID dptId, byte indicator)
+: KnxComObject(addr, dptId, KNX_PRIORITY_NORMAL_VALUE, indicator, KnxDPTLength(dptId), longValue) {}
+#endif
+
+inline word KnxComObject::GetAddr(void) const { return (word)((_header[3] << 8) + _header[4]); } // big endian in the header
 
 inline byte KnxComObject::GetDptId(void) const { return _dptId; }
 
@@ -162,6 +246,8 @@ inline byte KnxComObject::GetIndicator(void) const { return _indicator; }
 
 inline boolean KnxComObject::GetValidity(void) const { return _validity; }
 
+inline void KnxComObject::ClearValidity(void) { if (_indicator & KNX_COM_OBJ_I_INDICATOR) _validity = false; }
+
 inline byte KnxComObject::GetLength(void) const { return _length; }
 
 inline byte KnxComObject::GetValue(void) const { return _value; } 
@@ -0,0 +1,313 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxComObjectTable.h
+// Author : Franck Marini
+// Description : Compile time declaration of the com objects list (typed handles, checks, address index in flash)
+// Module dependencies : KnxComObject, KnxPackedComObjects, KnxAddressIndex
+
+#ifndef KNXCOMOBJECTTABLE_H
+#define KNXCOMOBJECTTABLE_H
+
+#include "Arduino.h"
+#include "KnxComObject.h"
+#include "KnxPackedComObjects.h"
+#include "KnxAddressIndex.h"
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// By default, several com objects may share the same group address (see KnxTpUart.h)
+// turn KNX_COM_OBJ_TABLE_UNIQUE_ADDRESSES flag on to get a compilation error when a group address
+// is shared by several com objects having "communication" attribute
+// #define KNX_COM_OBJ_TABLE_UNIQUE_ADDRESSES
+
+
+/* The com objects list is declared with a list macro, one line per com object with its handle name followed by
+   the KnxComObject constructor parameters, then KNX_DEVICE_COM_OBJECTS() is called once in the sketch :
+
+     #define MY_COM_OBJECTS(OBJ) \
+       OBJ(SWITCH_CMD,    G_ADDR(0,0,1), KNX_DPT_1_001, COM_OBJ_SENSOR) \
+       OBJ(SWITCH_STATUS, G_ADDR(0,0,2), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT)
+     KNX_DEVICE_COM_OBJECTS(MY_COM_OBJECTS)
+
+   The macro defines KnxDevice::_comObjectsList[] and KnxDevice::_comObjectsNb, and everything else is done
+   by the compiler :
+   - the com objects (length, pre-encoded header, validity) are initialized at compile time
+   - the long values (width > 1 byte) are placed in a single arena sized at compile time (no heap use)
+   - each com object gets a typed handle (SWITCH_CMD, SWITCH_STATUS...), to be used in place of its index
+   - the group addresses index is sorted at compile time and stored in flash memory, so that begin() does not
+     build it (no RAM used, no qsort at startup)
+   - the list size and (optionally) the unique group addresses are checked with static_assert
+   KnxComObjectsNb_ gives the nb of com objects.
+   When KNX_COM_OBJ_PACKED_TABLE flag is on (see KnxPackedComObjects.h), the macro defines a packed table instead :
+   the attributes are PROGMEM arrays, the validity flags and B1 values are bitsets, and the other values
+   are packed in a single arena.
+   KNX_PACKED_COM_OBJECTS(LIST, table) defines a standalone packed table (whatever the flag), with the handles.
+   NB : the com objects list can still be defined by hand (KnxComObject array only), the address index is then
+   built by begin(). The compile time computations grow with the square of the list size : the macros are limited
+   to 255 com objects, a bigger list (KNX_COM_OBJ_16BIT_INDEX flag, see KnxComObject.h) is defined by hand */
+
+
+// Typed handle of a com object : the index in the list wrapped in a dedicated type
+// The handle is a compile time constant (zero cost), it converts implicitly to the index expected by the KnxDevice
+// functions, and can be compared to the index given to knxEvents() (including "case" labels).
+// An arbitrary integer is not converted to a handle by mistake.
+class KnxComObjectHandle {
+    byte _index;
+
+  public:
+    constexpr explicit KnxComObjectHandle(byte index) : _index(index) {}
+
+    constexpr operator byte() const { return _index; }
+};
+
+
+// Attributes of a com object needed at compile time (group address index, values arena, packed table)
+typedef struct {
+  word addr;
+  e_KnxDPT_ID dptId;
+  e_KnxPriority prio;
+  byte indicator;
+  byte length;
+} type_com_obj_table_attr;
+
+// Attributes extracted from the KnxComObject constructor parameters
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+constexpr type_com_obj_table_attr KnxComObjectTableAttr(word addr, e_KnxDPT_ID dptId, e_KnxPriority prio, byte indicator)
+{ return type_com_obj_table_attr{ addr, dptId, prio, indicator, KnxDPTLength(dptId) }; }
+#else
+constexpr type_com_obj_table_attr KnxComObjectTableAttr(word addr, e_KnxDPT_ID dptId, byte indicator)
+{ return type_com_obj_table_attr{ addr, dptId, KNX_PRIORITY_NORMAL_VALUE, indicator, KnxDPTLength(dptId) }; }
+#endif
+
+
+// Compile time calculations on a com objects table
+// T shall provide "nb" (nb of com objects) and "list[]" (type_com_obj_table_attr array)
+// The index entries are the objects having "communication" attribute, ordered by increasing address,
+// then increasing index (same order as KnxAddressIndex::Build())
+// NB : the functions are recursive (single return statement constexpr functions), the depth is the list size
+template <class T> struct KnxComObjectTableCalc {
+  // True if the object is indexed (communication attribute)
+  static constexpr boolean IsIndexed(word i)
+  { return (T::list[i].indicator & KNX_COM_OBJ_C_INDICATOR) != 0; }
+
+  // Nb of indexed objects (from object i to the end of the list)
+  static constexpr byte EntriesNb(word i = 0)
+  { return (i >= T::nb) ? 0 : (IsIndexed(i) ? 1 : 0) + EntriesNb(i + 1); }
+
+  // True if no indexed object before object i has the same address (object k is the current comparison)
+  static constexpr boolean IsFirstOfAddress(word i, word k = 0)
+  { return (k >= i) || (!(IsIndexed(k) && (T::list[k].addr == T::list[i].addr)) && IsFirstOfAddress(i, k + 1)); }
+
+  // Nb of different addresses among the indexed objects (from object i to the end of the list)
+  static constexpr byte AddressesNb(word i = 0)
+  { return (i >= T::nb) ? 0 : ((IsIndexed(i) && IsFirstOfAddress(i)) ? 1 : 0) + AddressesNb(i + 1); }
+
+  // Size of the long value of object i (0 for a short value)
+  static constexpr byte LongValueSize(word i)
+  { return (T::list[i].length > 2) ? T::list[i].length - 1 : 0; }
+
+  // Size of the long values of the objects before object k (from object i), i.e. position of its value in the arena
+  // The size of the whole arena is given by k = nb
+  static constexpr word LongValuesSize(word k, word i = 0)
+  { return (i >= k) ? 0 : LongValueSize(i) + LongValuesSize(k, i + 1); }
+
+  // Data space of the long value of object k in the arena (NULL for a short value)
+  static constexpr byte* LongValue(byte arena[], word k)
+  { return LongValueSize(k) ? arena + LongValuesSize(k) : NULL; }
+
+  // Packed table : true if object i has a B1 value (stored in the B1 values bitset)
+  static constexpr boolean IsB1(word i)
+  { return KnxDPTFormat(T::list[i].dptId) == KNX_DPT_FORMAT_B1; }
+
+  // Packed table : size of the value of object i in the values arena (0 for a B1 value)
+  static constexpr byte PackedValueSize(word i)
+  { return IsB1(i) ? 0 : (T::list[i].length <= 2) ? 1 : T::list[i].length - 1; }
+
+  // Packed table : size of the values of the objects before object k (from object i) in the values arena
+  // The size of the whole arena is given by k = nb
+  static constexpr word PackedValuesSize(word k, word i = 0)
+  { return (i >= k) ? 0 : PackedValueSize(i) + PackedValuesSize(k, i + 1); }
+
+  // Packed table : nb of B1 objects before object k (from object i), i.e. bit nb of its value in the B1 bitset
+  // The nb of B1 objects is given by k = nb
+  static constexpr word B1ValuesNb(word k, word i = 0)
+  { return (i >= k) ? 0 : (IsB1(i) ? 1 : 0) + B1ValuesNb(k, i + 1); }
+
+  // Packed table : value position of object k (see KnxPackedComObjects)
+  static constexpr word PackedValuePos(word k)
+  { return IsB1(k) ? (KNX_PACKED_COM_OBJ_B1_VALUE | B1ValuesNb(k)) : PackedValuesSize(k); }
+
+  // Packed table : size of a bitset (at least 1 byte, no zero size array)
+  static constexpr byte BitsetSize(word bitsNb)
+  { return bitsNb ? (bitsNb + 7) / 8 : 1; }
+
+  // Packed table : byte k of the validity bitset (bit j and following ones)
+  // Only the objects with "InitRead" indicator are not valid (see KnxComObject)
+  static constexpr byte ValidityBits(byte k, byte j = 0)
+  { return ((j >= 8) || (8 * k + j >= T::nb)) ? 0
+           : ((T::list[8 * k + j].indicator & KNX_COM_OBJ_I_INDICATOR) ? 0 : (1 << j)) | ValidityBits(k, j + 1); }
+
+  // Sort key of object i : address, then index (24 bits)
+  static constexpr unsigned long Key(word i)
+  { return ((unsigned long) T::list[i].addr << 8) | i; }
+
+  // Nb of indexed objects with a key lower or equal to a given key (from object i to the end of the list)
+  static constexpr byte KeysNbUpTo(unsigned long key, word i = 0)
+  { return (i >= T::nb) ? 0 : ((IsIndexed(i) && (Key(i) <= key)) ? 1 : 0) + KeysNbUpTo(key, i + 1); }
+
+  // Key of the entry at a given position in the index : the lowest key having more than "position" keys
+  // lower or equal to it, found by dichotomy in [low, high] (24 steps, so that the whole index is
+  // calculated in O(n^2) whatever the compiler)
+  static constexpr unsigned long EntryKey(byte position, unsigned long low = 0, unsigned long high = 0xFFFFFF)
+  { return (low >= high) ? low : (KeysNbUpTo((low + high) >> 1) > position) ? EntryKey(position, low, (low + high) >> 1)
+                                                                             : EntryKey(position, ((low + high) >> 1) + 1, high); }
+
+  // Index entry at a given position
+  static constexpr type_address_index_entry Entry(byte position)
+  { return MakeEntry(EntryKey(position)); }
+
+  // Index entry of a given key
+  static constexpr type_address_index_entry MakeEntry(unsigned long key)
+  { return type_address_index_entry{ (word)(key >> 8), (byte) key }; }
+};
+
+
+// Sequence of positions 0 to N-1 (used to expand the index entries)
+template <byte... I> struct KnxIndexSequence {};
+template <byte N, byte... I> struct KnxMakeIndexSequence : KnxMakeIndexSequence<N - 1, N - 1, I...> {};
+template <byte... I> struct KnxMakeIndexSequence<0, I...> { typedef KnxIndexSequence<I...> type; };
+
+// Address index entries built at compile time
+// NB : the last entry is not used, it avoids a zero size array when no object has "communication" attribute
+template <byte N> struct KnxComObjectTableIndex {
+  type_address_index_entry entries[N + 1];
+};
+
+template <class T, byte... E>
+constexpr KnxComObjectTableIndex<sizeof...(E)> KnxComObjectTableMakeIndex(KnxIndexSequence<E...>)
+{
+  return KnxComObjectTableIndex<sizeof...(E)>{{
+    KnxComObjectTableCalc<T>::Entry(E)...,
+    { 0xFFFF, 0xFF } }};
+}
+
+
+// Packed table validity bitset built at compile time
+template <byte N> struct KnxComObjectTableBits {
+  byte bits[N];
+};
+
+template <class T, byte... K>
+constexpr KnxComObjectTableBits<sizeof...(K)> KnxComObjectTableMakeValidityBits(KnxIndexSequence<K...>)
+{
+  return KnxComObjectTableBits<sizeof...(K)>{{ KnxComObjectTableCalc<T>::ValidityBits(K)... }};
+}
+
+
+// Expansion of one line of the list macro
+#define KNX_COM_OBJ_TABLE_INDEX_(name, ...)  KnxComObjectIndex_##name,
+#define KNX_COM_OBJ_TABLE_HANDLE_(name, ...) constexpr KnxComObjectHandle name(KnxComObjectIndex_##name);
+#define KNX_COM_OBJ_TABLE_OBJECT_(name, ...) \
+  KnxComObject(KnxComObjectTableCalc<KnxComObjectsAttr_>::LongValue(knxComObjectsLongValues_, KnxComObjectIndex_##name), __VA_ARGS__),
+#define KNX_COM_OBJ_TABLE_ATTR_(name, ...)   KnxComObjectTableAttr(__VA_ARGS__),
+#define KNX_COM_OBJ_TABLE_ADDR_(name, ...)      KnxComObjectsAttr_::list[KnxComObjectIndex_##name].addr,
+#define KNX_COM_OBJ_TABLE_DPT_(name, ...)       (byte) KnxComObjectsAttr_::list[KnxComObjectIndex_##name].dptId,
+#define KNX_COM_OBJ_TABLE_INDICATOR_(name, ...) KnxComObjectsAttr_::list[KnxComObjectIndex_##name].indicator,
+#define KNX_COM_OBJ_TABLE_LENGTH_(name, ...)    KnxComObjectsAttr_::list[KnxComObjectIndex_##name].length,
+#define KNX_COM_OBJ_TABLE_PRIO_(name, ...)      (byte) KnxComObjectsAttr_::list[KnxComObjectIndex_##name].prio,
+#define KNX_COM_OBJ_TABLE_VALUE_POS_(name, ...) \
+  KnxComObjectTableCalc<KnxComObjectsAttr_>::PackedValuePos(KnxComObjectIndex_##name),
+
+#if defined(KNX_COM_OBJ_TABLE_UNIQUE_ADDRESSES)
+#define KNX_COM_OBJ_TABLE_CHECK_UNIQUE_(T) \
+  static_assert(KnxComObjectTableCalc<T>::AddressesNb() == KnxComObjectTableCalc<T>::EntriesNb(), \
+                "group address shared by several com objects (see KNX_COM_OBJ_TABLE_UNIQUE_ADDRESSES)");
+#else
+#define KNX_COM_OBJ_TABLE_CHECK_UNIQUE_(T)
+#endif
+
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+#define KNX_COM_OBJ_TABLE_PRIO_ARRAY_(LIST) constexpr byte knxComObjectsPrio_[KnxComObjectsNb_] PROGMEM = { LIST(KNX_COM_OBJ_TABLE_PRIO_) };
+#define KNX_COM_OBJ_TABLE_PRIO_ARG_ knxComObjectsPrio_,
+#else
+#define KNX_COM_OBJ_TABLE_PRIO_ARRAY_(LIST)
+#define KNX_COM_OBJ_TABLE_PRIO_ARG_
+#endif
+
+// Nb, handles and compile time attributes of the list
+#define KNX_COM_OBJ_TABLE_DECLARE_(LIST) \
+  enum { LIST(KNX_COM_OBJ_TABLE_INDEX_) KnxComObjectsNb_ }; \
+  static_assert(KnxComObjectsNb_ > 0, "empty com objects list"); \
+  static_assert(KnxComObjectsNb_ <= 255, "too many com objects (255 max), define the list by hand"); \
+  LIST(KNX_COM_OBJ_TABLE_HANDLE_) \
+  struct KnxComObjectsAttr_ { \
+    static constexpr word nb = KnxComObjectsNb_; \
+    static constexpr type_com_obj_table_attr list[KnxComObjectsNb_] = { LIST(KNX_COM_OBJ_TABLE_ATTR_) }; \
+  }; \
+  constexpr type_com_obj_table_attr KnxComObjectsAttr_::list[KnxComObjectsNb_];
+
+// Packed table : attributes arrays in flash, validity bitset (initialized at compile time), B1 values bitset
+// and values arena, then the table object (constant initialized)
+#define KNX_COM_OBJ_TABLE_PACKED_(LIST, table) \
+  constexpr word knxComObjectsAddr_[KnxComObjectsNb_] PROGMEM = { LIST(KNX_COM_OBJ_TABLE_ADDR_) }; \
+  constexpr byte knxComObjectsDptId_[KnxComObjectsNb_] PROGMEM = { LIST(KNX_COM_OBJ_TABLE_DPT_) }; \
+  constexpr byte knxComObjectsIndicator_[KnxComObjectsNb_] PROGMEM = { LIST(KNX_COM_OBJ_TABLE_INDICATOR_) }; \
+  constexpr byte knxComObjectsLength_[KnxComObjectsNb_] PROGMEM = { LIST(KNX_COM_OBJ_TABLE_LENGTH_) }; \
+  KNX_COM_OBJ_TABLE_PRIO_ARRAY_(LIST) \
+  constexpr word knxComObjectsValuePos_[KnxComObjectsNb_] PROGMEM = { LIST(KNX_COM_OBJ_TABLE_VALUE_POS_) }; \
+  static KnxComObjectTableBits<(KnxComObjectsNb_ + 7) / 8> knxComObjectsValidityBits_ = \
+    KnxComObjectTableMakeValidityBits<KnxComObjectsAttr_>(KnxMakeIndexSequence<(KnxComObjectsNb_ + 7) / 8>::type()); \
+  static byte knxComObjectsB1Bits_[KnxComObjectTableCalc<KnxComObjectsAttr_>::BitsetSize( \
+    KnxComObjectTableCalc<KnxComObjectsAttr_>::B1ValuesNb(KnxComObjectsNb_))]; \
+  static byte knxComObjectsValues_[KnxComObjectTableCalc<KnxComObjectsAttr_>::PackedValuesSize(KnxComObjectsNb_) + 1 /* no zero size */]; \
+  table(knxComObjectsAddr_, knxComObjectsDptId_, knxComObjectsIndicator_, knxComObjectsLength_, KNX_COM_OBJ_TABLE_PRIO_ARG_ \
+    knxComObjectsValuePos_, knxComObjectsValidityBits_.bits, knxComObjectsB1Bits_, sizeof(knxComObjectsB1Bits_), \
+    knxComObjectsValues_, KnxComObjectTableCalc<KnxComObjectsAttr_>::PackedValuesSize(KnxComObjectsNb_), KnxComObjectsNb_);
+
+// Address index of the list, in flash
+#define KNX_COM_OBJ_TABLE_ADDRESS_INDEX_ \
+  KNX_COM_OBJ_TABLE_CHECK_UNIQUE_(KnxComObjectsAttr_) \
+  constexpr KnxComObjectTableIndex<KnxComObjectTableCalc<KnxComObjectsAttr_>::EntriesNb()> knxComObjectsIndexEntries_ PROGMEM = \
+    KnxComObjectTableMakeIndex<KnxComObjectsAttr_>( \
+      KnxMakeIndexSequence<KnxComObjectTableCalc<KnxComObjectsAttr_>::EntriesNb()>::type()); \
+  const type_address_index_table knxComObjectsAddressIndex = { knxComObjectsIndexEntries_.entries, \
+    KnxComObjectTableCalc<KnxComObjectsAttr_>::EntriesNb(), KnxComObjectTableCalc<KnxComObjectsAttr_>::AddressesNb() };
+
+// Declaration of the com objects list (see above)
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+#define KNX_DEVICE_COM_OBJECTS(LIST) \
+  KNX_COM_OBJ_TABLE_DECLARE_(LIST) \
+  KNX_COM_OBJ_TABLE_PACKED_(LIST, KnxPackedComObjects KnxDevice::_comObjectsList) \
+  const type_com_obj_index KnxDevice::_comObjectsNb = KnxComObjectsNb_; \
+  KNX_COM_OBJ_TABLE_ADDRESS_INDEX_
+#else
+#define KNX_DEVICE_COM_OBJECTS(LIST) \
+  KNX_COM_OBJ_TABLE_DECLARE_(LIST) \
+  static byte knxComObjectsLongValues_[KnxComObjectTableCalc<KnxComObjectsAttr_>::LongValuesSize(KnxComObjectsNb_) + 1 /* no zero size */]; \
+  KnxComObject KnxDevice::_comObjectsList[] = { LIST(KNX_COM_OBJ_TABLE_OBJECT_) }; \
+  const type_com_obj_index KnxDevice::_comObjectsNb = KnxComObjectsNb_; \
+  KNX_COM_OBJ_TABLE_ADDRESS_INDEX_
+#endif
+
+// Declaration of a standalone packed table (see above)
+#define KNX_PACKED_COM_OBJECTS(LIST, table) \
+  KNX_COM_OBJ_TABLE_DECLARE_(LIST) \
+  KNX_COM_OBJ_TABLE_PACKED_(LIST, static KnxPackedComObjects table)
+
+#endif // KNXCOMOBJECTTABLE_H
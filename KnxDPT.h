@@ -105,8 +105,9 @@ enum eKnxDPT_Format {
 };
 
 // Definition of the length in bits according to the format
-// NB : table is stored in flash program memory to save RAM
-const byte KnxDPTFormatToLengthBit[] PROGMEM = {
+// NB : table is stored in flash program memory to save RAM, it is "constexpr" so that the compiler can read it
+// when the format is known at compile time (see KnxDPTLength())
+constexpr byte KnxDPTFormatToLengthBit[] PROGMEM = {
   1 , //  KNX_DPT_FORMAT_B1 = 0,
   2 , //  KNX_DPT_FORMAT_B2,
   4 , // KNX_DPT_FORMAT_B1U3
@@ -281,8 +282,9 @@ enum e_KnxDPT_ID {
 };		 
 
 // Definition of the format according to the ID
-// NB : table is stored in flash program memory to save RAM
-const byte KnxDPTIdToFormat[] PROGMEM = {
+// NB : table is stored in flash program memory to save RAM, it is "constexpr" so that the compiler can read it
+// when the ID is known at compile time (see KnxDPTFormat())
+constexpr byte KnxDPTIdToFormat[] PROGMEM = {
   KNX_DPT_FORMAT_B1, //  KNX_DPT_1_001, // 1.001 B1 DPT_Switch
   KNX_DPT_FORMAT_B1, //  KNX_DPT_1_002, // 1.002 B1 DPT_Bool
   KNX_DPT_FORMAT_B1, //  KNX_DPT_1_003, // 1.003 B1 DPT_Enable
@@ -391,4 +393,36 @@ const byte KnxDPTIdToFormat[] PROGMEM = {
   KNX_DPT_FORMAT_F32 //  KNX_DPT_14_007, // 14.007 F32 DPT_Value_AngleDeg
 };
 
+
+// Format and length (in bytes, calculated in the same way as telegram payload length) of a DPT, read in the
+// tables in flash memory
+inline byte KnxDPTFormatFromFlash(byte dptId) { return pgm_read_byte(&KnxDPTIdToFormat[dptId]); }
+
+inline byte KnxDPTLengthFromFlash(byte dptId)
+{ return (pgm_read_byte(&KnxDPTFormatToLengthBit[KnxDPTFormatFromFlash(dptId)]) / 8) + 1; }
+
+// Format of a DPT, read in the tables by the compiler
+// NB : to be used in constant expressions only (e.g. com objects list definition, see KnxComObjectTable.h),
+// the table is in flash memory and cannot be read by a plain access at runtime (use KnxDPTFormatFromFlash())
+constexpr byte KnxDPTFormat(e_KnxDPT_ID dptId) { return KnxDPTIdToFormat[dptId]; }
+
+// Length of a DPT, given by the DPT main number (the IDs are sorted by main number) : 1 for 1.xxx to 3.xxx,
+// 2 for 4.xxx to 6.xxx, 3 for 7.xxx to 9.xxx, 4 for 10.xxx and 11.xxx, 5 for 12.xxx to 14.xxx
+// The function reads no table : it gives a constant when the DPT ID is a compile time constant (the KnxComObject
+// constructors are "constexpr"), and is also valid at runtime. It is checked against the tables at compile time.
+constexpr byte KnxDPTLength(e_KnxDPT_ID dptId)
+{
+  return (dptId < KNX_DPT_4_001) ? 1 : (dptId < KNX_DPT_7_001) ? 2 : (dptId < KNX_DPT_10_001) ? 3
+         : (dptId < KNX_DPT_12_001) ? 4 : 5;
+}
+
+// Compile time check of KnxDPTLength() against the tables, from a DPT ID to the last one
+constexpr boolean KnxDPTLengthCheck(byte dptId)
+{
+  return (dptId >= sizeof(KnxDPTIdToFormat))
+         || ((KnxDPTLength((e_KnxDPT_ID) dptId) == (KnxDPTFormatToLengthBit[KnxDPTIdToFormat[dptId]] / 8) + 1)
+             && KnxDPTLengthCheck(dptId + 1));
+}
+static_assert(KnxDPTLengthCheck(0), "KnxDPTLength() does not match the DPT tables");
+
 #endif // KNXDPT_H
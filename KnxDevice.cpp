@@ -19,12 +19,24 @@
 // File : KnxDevice.cpp
 // Author : Franck Marini
 // Description : KnxDevice Abstraction Layer
-// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxTpUart, ActionRingBuffer
+// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxPackedComObjects, KnxComObjectTable, KnxTpUart, ActionRingBuffer, SpscRingBuffer, KnxSnapshot, KnxTokenBucket
 
 #include "KnxDevice.h"
 
 static inline word TimeDeltaWord(word now, word before) { return (word)(now - before); }
 
+// Return the TX lane of a given priority (TX_LANE_PRIO_NB stands for the NORMAL priority lane)
+static inline byte PriorityToTxLane(e_KnxPriority priority)
+{
+  switch (priority)
+  {
+    case KNX_PRIORITY_SYSTEM_VALUE : return TX_LANE_SYSTEM;
+    case KNX_PRIORITY_ALARM_VALUE : return TX_LANE_ALARM;
+    case KNX_PRIORITY_HIGH_VALUE : return TX_LANE_HIGH;
+    default : return TX_LANE_PRIO_NB;
+  }
+}
+
 #ifdef KNXDEVICE_DEBUG_INFO
 const char KnxDevice::_debugInfoText[] = "KNXDEVICE INFO: ";
 #endif
@@ -40,8 +52,48 @@ KnxDevice::KnxDevice()
   _state = INIT;
   _tpuart = NULL;
   _txActionList= ActionRingBuffer<type_tx_action, ACTIONS_QUEUE_SIZE>();
+  _writeCoalescing = false;
+  _mergedWritesNb = 0;
+  _snapshot = NULL;
+  _longValuesArena = NULL;
   _initCompleted = false;
-  _initIndex = 0;
+  _initPendingBits = NULL;
+  _initPendingNb = 0;
+  _initCursor = 0;
+  _initReadsNb = 0;
+  _initReadsMaxNb = KNX_DEVICE_INIT_READS_DEFAULT_NB;
+  _initReadTimeoutMillis = KNX_DEVICE_INIT_READ_TIMEOUT_MILLIS;
+  _initBackoffMillis = 0;
+  _initBackoffStartMillis = 0;
+  _beginTimeMillis = 0;
+  _initDurationMillis = 0;
+  _handlers = NULL;
+  _changedBits = NULL;
+  _changedNb = 0;
+  _batchHandler = NULL;
+  _dispatchBudgetMicros = KNX_DEVICE_DISPATCH_BUDGET_DEFAULT_MICROS;
+  _deferredDispatchesNb = 0;
+  _maxHandlerMicros = 0;
+  _handlersMicros = 0;
+  for (byte i = 0; i < KNX_DEVICE_TX_TRANSACTIONS_NB; i++) _txTransactions[i].handle = KNX_TX_HANDLE_NONE;
+  _txHandleGeneration = 0;
+  _newActionTransaction = 0;
+  _sentAction.transaction = 0;
+  for (byte i = 0; i < KNX_DEVICE_RETRIES_NB; i++) _retries[i].action.attemptsNb = 0;
+  _retryAttemptsNb = KNX_DEVICE_RETRY_DEFAULT_ATTEMPTS_NB;
+  _retryBackoffMillis = KNX_DEVICE_RETRY_DEFAULT_BACKOFF_MILLIS;
+  _retryMaxBackoffMillis = KNX_DEVICE_RETRY_DEFAULT_MAX_BACKOFF_MILLIS;
+  _retryJitterSeed = 1;
+  _retriesNb = 0;
+  _giveUpsNb = 0;
+  _resetAnswerTimeoutMillis = TPUART_RESET_ANSWER_TIMEOUT_MILLISEC;
+  _resetBackoffMillis = 0;
+  _resetAttemptsNb = TPUART_RESET_ATTEMPTS_NB;
+  _txGroupLimitsNb = 0;
+  _sendPolicies = NULL;
+  _sendPoliciesNb = 0;
+  _policyWritesNb = 0;
+  _policySendsNb = 0;
   _rxTelegram = NULL;
 #if defined(KNXDEVICE_DEBUG_INFO)
    _nbOfInits = 0;
@@ -55,21 +107,51 @@ KnxDevice::KnxDevice()
 // else return KNX_DEVICE_OK
 e_KnxDeviceStatus KnxDevice::begin(HardwareSerial& serial, word physicalAddr)
 {
-  _tpuart = new KnxTpUart(serial ,physicalAddr, NORMAL);
-  _rxTelegram = &_tpuart->GetReceivedTelegram();
+KnxTpUart *tpuart;
+
+  if (_tpuart) end(); // begin() called again : the device is restarted (TPUART and init bitset released)
+  if (AttachLongValues() != KNX_DEVICE_OK) return KNX_DEVICE_ERROR;
+  // Bitset of the com objects waiting for their init read
+  _initPendingBits = (byte *) malloc((_comObjectsNb + 7) / 8);
+  if (_initPendingBits == NULL) return KNX_DEVICE_ERROR;
+  _initPendingNb = 0;
+  for (word i = 0; i < (_comObjectsNb + 7) / 8; i++) _initPendingBits[i] = 0;
+  // NB : only the objects having Init Read attribute are not valid (unless restored from a snapshot)
+  for (type_com_obj_index i = 0; i < _comObjectsNb; i++) if (!_comObjectsList[i].GetValidity()) SetInitPending(i);
+  _initCursor = 0;
+  _initReadsNb = 0;
+  _initBackoffMillis = 0;
+  _initDurationMillis = 0;
+  _initCompleted = false;
+  // seed of the retries jitter, so that devices failing together do not retry together
+  _retryJitterSeed = physicalAddr ^ (word) micros();
+  if (!_retryJitterSeed) _retryJitterSeed = 1;
+
+  SetTpUart(new KnxTpUart(serial ,physicalAddr, NORMAL));
+  _tpuart->SetResetPolicy(_resetAnswerTimeoutMillis, _resetBackoffMillis, _resetAttemptsNb);
   // delay(10000); // Workaround for init issue with bus-powered arduino
                    // the issue is reproduced on one (faulty?) TPUART device only, so remove it for the moment.
   if(_tpuart->Reset()!= KNX_TPUART_OK)
   {
-    delete(_tpuart);
-    _tpuart = NULL;
-    _rxTelegram = NULL;
+    tpuart = _tpuart;
+    SetTpUart(NULL);
+    delete(tpuart);
+    free(_initPendingBits);
+    _initPendingBits = NULL;
 #if defined(KNXDEVICE_DEBUG_INFO)
     DebugInfo("Init Error!\n");
 #endif
     return KNX_DEVICE_ERROR;
   }
-  _tpuart->AttachComObjectsList(_comObjectsList, _comObjectsNb);
+  // the telegrams headers of the com objects are pre-encoded with the device physical address
+  for (type_com_obj_index i = 0; i < _comObjectsNb; i++) _comObjectsList[i].SetSourceAddress(physicalAddr);
+  // the address index built at compile time is used when the list is declared with KNX_DEVICE_COM_OBJECTS()
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+  _tpuart->AttachComObjectsList(NULL, _comObjectsNb, &knxComObjectsAddressIndex); // packed table : always declared
+#else
+  _tpuart->AttachComObjectsList(_comObjectsList, _comObjectsNb,
+                                (knxComObjectsAddressIndex.entries ? &knxComObjectsAddressIndex : NULL));
+#endif
   _tpuart->SetEvtCallback(&KnxDevice::GetTpUartEvents);
   _tpuart->SetAckCallback(&KnxDevice::TxTelegramAck);
   _tpuart->Init();
@@ -77,8 +159,9 @@ e_KnxDeviceStatus KnxDevice::begin(HardwareSerial& serial, word physicalAddr)
 #if defined(KNXDEVICE_DEBUG_INFO)
   DebugInfo("Init successful\n");
 #endif
-  _lastInitTimeMillis = millis();
+  _beginTimeMillis = millis();
   _lastTXTimeMicros = micros();
+  _mergedWritesNb = 0;
 #if defined(KNXDEVICE_DEBUG_INFO)
    _nbOfInits = 0;
 #endif
@@ -90,14 +173,33 @@ e_KnxDeviceStatus KnxDevice::begin(HardwareSerial& serial, word physicalAddr)
 void KnxDevice::end()
 {
 type_tx_action action;
-
+type_isr_write isrWrite;
+KnxTpUart *tpuart;
+
+  // the queued actions and the pending retries are dropped, their transactions are completed
+  // (polling only, the handlers are not called). The writes queued by the interrupt routines are dropped too.
+  while(_isrWrites.Pop(isrWrite));
+  if ((_state == TX_ONGOING) && _sentAction.transaction) CompleteTransaction(_sentAction.transaction, KNX_TX_RESET);
+  _sentAction.transaction = 0;
   _state = INIT;
-  while(_txActionList.Pop(action)); // empty ring buffer
+  while(PopTxAction(action)) if (action.transaction) CompleteTransaction(action.transaction, KNX_TX_RESET);
+  for (byte i = 0; i < KNX_DEVICE_RETRIES_NB; i++)
+  {
+    if (_retries[i].action.attemptsNb && _retries[i].action.transaction)
+      CompleteTransaction(_retries[i].action.transaction, KNX_TX_RESET);
+    _retries[i].action.attemptsNb = 0;
+  }
+  for (byte i = 0; i < KNX_DEVICE_TX_TRANSACTIONS_NB; i++) _txTransactions[i].handler = NULL;
+  // the device is off the bus : the values of the "InitRead" objects are read again by the next begin()
+  for (type_com_obj_index i = 0; i < _comObjectsNb; i++) _comObjectsList[i].ClearValidity();
   _initCompleted = false;
-  _initIndex = 0;
+  free(_initPendingBits);
+  _initPendingBits = NULL;
+  _initReadsNb = 0;
   _rxTelegram = NULL;
-  delete(_tpuart);
-  _tpuart = NULL;
+  tpuart = _tpuart;
+  SetTpUart(NULL);
+  delete(tpuart);
 }
 
 
@@ -106,36 +208,30 @@ type_tx_action action;
 void KnxDevice::task(void)
 {
 type_tx_action action;
-word nowTimeMillis, nowTimeMicros;
+word nowTimeMicros;
 
-  // STEP 1 : Initialize Com Objects having Init Read attribute
-  if(!_initCompleted)
-  { 
-    nowTimeMillis = millis();
-    // To avoid EIB bus overloading, we wait for 500 ms between each Init read request
-    if (TimeDeltaWord(nowTimeMillis, _lastInitTimeMillis) > 500 )
-    { 
-      while ( (_initIndex< _comObjectsNb) && (_comObjectsList[_initIndex].GetValidity() )) _initIndex++;
-
-      if (_initIndex == _comObjectsNb) 
-      {
-        _initCompleted = true; // All the Com Object initialization have been performed
-      //  DebugInfo(String("KNXDevice INFO: Com Object init completed, ")+ String( _nbOfInits) + String("objs initialized.\n"));
-      }
-      else 
-      { // Com Object to be initialised has been found
-        // Add a READ request in the TX action list
-#if defined(KNXDEVICE_DEBUG_INFO) || defined(KNXDEVICE_DEBUG_INFO_VERBOSE)
-        _nbOfInits++;
-#endif
-        action.command = EIB_READ_REQUEST;
-        action.index = _initIndex;
-        _txActionList.Append(action);
-        _lastInitTimeMillis = millis(); // Update the timer
-      }
-    } 
+  // STEP 0 : RECOVER FROM A TPUART RESET
+  // The reset is performed step by step so that the application keeps running meanwhile
+  if (_state == RESET_ONGOING)
+  {
+    switch (_tpuart->ResetTask())
+    {
+      case TPUART_RESET_STATUS_DONE :
+        _tpuart->Init();
+        _state = IDLE;
+        break;
+
+      case TPUART_RESET_STATUS_FAILED : // the TPUART is not answering (bus still off?), we start again
+        _tpuart->StartReset(true); // the duration of the failed resets is included in the reset duration
+        return;
+
+      default : return; // reset ongoing, the RX/TX activities are stopped
+    }
   }
 
+  // STEP 1 : Initialize Com Objects having Init Read attribute
+  if(!_initCompleted) InitTask();
+
   // STEP 2 : Get new received EIB messages from the TPUART
   // The TPUART RX task is executed every 400 us
   nowTimeMicros = micros();
@@ -144,52 +240,41 @@ word nowTimeMillis, nowTimeMicros;
     _lastRXTimeMicros = nowTimeMicros;
     _tpuart->RXTask();
   }
+  // NB : the TPUART only assembles, checks and queues the received telegrams, they are dispatched at the end
+  // of task() (STEP 6)
 
   // STEP 3 : Send KNX messages following TX actions
+  // The failed writes are queued again once their retry backoff is elapsed, and the values of the com objects
+  // having a send policy are queued when the policy requires it. The writes done by the interrupt routines are
+  // performed first, as long as their TX queue has room
+  IsrWritesTask();
+  RetryTask();
+  if (_sendPoliciesNb) SendPoliciesTask();
   if(_state == IDLE)
   {
-    if( _txActionList.Pop(action))
+    if(PopAllowedTxAction(action))
     { // Data to be transmitted
+      _sentAction = action; // completed (or retried) by TxTelegramAck()
       switch (action.command)
       {
         case EIB_READ_REQUEST: // a read operation of a Com Object on the EIB network is required
-          //_objectsList[action.index].CopyToTelegram(_txTelegram, KNX_COMMAND_VALUE_READ);
-          _comObjectsList[action.index].CopyAttributes(_txTelegram);
-          _txTelegram.ClearLongPayload(); _txTelegram.ClearFirstPayloadByte(); // Is it required to have a clean payload ??
-          _txTelegram.SetCommand(KNX_COMMAND_VALUE_READ);
-          _txTelegram.UpdateChecksum();
-          _tpuart->SendTelegram(_txTelegram);
-          _state = TX_ONGOING;
+          SendComObjectTelegram(action, KNX_COMMAND_VALUE_READ);
           break;
 
         case EIB_RESPONSE_REQUEST: // a response operation of a Com Object on the EIB network is required
-          _comObjectsList[action.index].CopyAttributes(_txTelegram);
-          _comObjectsList[action.index].CopyValue(_txTelegram);
-          _txTelegram.SetCommand(KNX_COMMAND_VALUE_RESPONSE);
-          _txTelegram.UpdateChecksum();
-          _tpuart->SendTelegram(_txTelegram);
-          _state = TX_ONGOING;
+          SendComObjectTelegram(action, KNX_COMMAND_VALUE_RESPONSE);
           break;
 
         case EIB_WRITE_REQUEST: // a write operation of a Com Object on the EIB network is required
           // update the com obj value
           if ((_comObjectsList[action.index].GetLength()) <= 2 )
             _comObjectsList[action.index].UpdateValue(action.byteValue);
-          else
-          {
-            _comObjectsList[action.index].UpdateValue(action.valuePtr);
-            free(action.valuePtr);
-          }
+          else _comObjectsList[action.index].UpdateValue(action.longValue);
+          if (_snapshot) _snapshot->SetChanged(action.index);
           // transmit the value through EIB network only if the Com Object has transmit attribute
           if ( (_comObjectsList[action.index].GetIndicator()) & KNX_COM_OBJ_T_INDICATOR)
-          {
-            _comObjectsList[action.index].CopyAttributes(_txTelegram);
-            _comObjectsList[action.index].CopyValue(_txTelegram);
-            _txTelegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
-            _txTelegram.UpdateChecksum();
-            _tpuart->SendTelegram(_txTelegram);
-            _state = TX_ONGOING;
-          }
+            SendComObjectTelegram(action, KNX_COMMAND_VALUE_WRITE);
+          else if (action.transaction) CompleteTransaction(action.transaction, KNX_TX_LOCAL); // no telegram sent
           break;
 
         default : break;
@@ -205,12 +290,38 @@ word nowTimeMillis, nowTimeMicros;
     _lastTXTimeMicros = nowTimeMicros;
     _tpuart->TXTask();
   }
+
+  // STEP 5 : SAVE THE CHANGED COM OBJECTS VALUES IN THE SNAPSHOT
+  if (_snapshot) _snapshot->Task();
+
+  // STEP 6 : DISPATCH THE RECEIVED TELEGRAMS
+  // The com objects updates and the application notifications are done out of the reception, within
+  // the dispatch time budget, so that a slow processing does not delay the reception of the next telegrams
+  if (_tpuart->GetReceivedTelegramsNb()) RxTask();
+  // The batched updates are notified once the received telegrams are dispatched
+  if (_changedNb) BatchTask();
+  // The completed transactions are notified to their handlers
+  TransactionsTask();
+}
+
+
+// Build the telegram of a TX action from the com object pre-encoded header, and start its sending
+void KnxDevice::SendComObjectTelegram(const type_tx_action& action, e_KnxCommand command)
+{
+  _comObjectsList[action.index].CopyToTelegram(_txTelegram, command);
+  if (_txTelegram.GetPriority() != action.priority)
+  { // the action priority differs from the com object one
+    _txTelegram.ChangePriority(action.priority);
+    _txTelegram.UpdateChecksum();
+  }
+  _tpuart->SendTelegram(_txTelegram);
+  _state = TX_ONGOING;
 }
 
 
 // Quick method to read a short (<=1 byte) com object
 // NB : The returned value will be hazardous in case of use with long objects
-byte KnxDevice::read(byte objectIndex)
+byte KnxDevice::read(type_com_obj_index objectIndex)
 {
   return _comObjectsList[objectIndex].GetValue();
 }
@@ -218,7 +329,7 @@ byte KnxDevice::read(byte objectIndex)
 
 // Read an usual format com object
 // Supported DPT formats are short com object, U16, V16, U32, V32, F16 and F32 (not implemented yet)
-template <typename T>  e_KnxDeviceStatus KnxDevice::read(byte objectIndex, T& returnedValue)
+template <typename T>  e_KnxDeviceStatus KnxDevice::read(type_com_obj_index objectIndex, T& returnedValue)
 {
   // Short com object case
   if (_comObjectsList[objectIndex].GetLength()<=2)
@@ -230,24 +341,24 @@ template <typename T>  e_KnxDeviceStatus KnxDevice::read(byte objectIndex, T& re
   {
     byte dptValue[14]; // define temporary DPT value with max length
     _comObjectsList[objectIndex].GetValue(dptValue);
-    return ConvertFromDpt(dptValue, returnedValue, pgm_read_byte(&KnxDPTIdToFormat[_comObjectsList[objectIndex].GetDptId()]));
+    return ConvertFromDpt(dptValue, returnedValue, KnxDPTFormatFromFlash(_comObjectsList[objectIndex].GetDptId()));
   }
 }
 
-template e_KnxDeviceStatus KnxDevice::read <boolean>(byte objectIndex, boolean& returnedValue);
-template e_KnxDeviceStatus KnxDevice::read <unsigned char>(byte objectIndex, unsigned char& returnedValue);
-template e_KnxDeviceStatus KnxDevice::read <char>(byte objectIndex, char& returnedValue);
-template e_KnxDeviceStatus KnxDevice::read <unsigned int>(byte objectIndex, unsigned int& returnedValue);
-template e_KnxDeviceStatus KnxDevice::read <int>(byte objectIndex, int& returnedValue);
-template e_KnxDeviceStatus KnxDevice::read <unsigned long>(byte objectIndex, unsigned long& returnedValue);
-template e_KnxDeviceStatus KnxDevice::read <long>(byte objectIndex, long& returnedValue);
-template e_KnxDeviceStatus KnxDevice::read <float>(byte objectIndex, float& returnedValue);
-template e_KnxDeviceStatus KnxDevice::read <double>(byte objectIndex, double& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <boolean>(type_com_obj_index objectIndex, boolean& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <unsigned char>(type_com_obj_index objectIndex, unsigned char& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <char>(type_com_obj_index objectIndex, char& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <unsigned int>(type_com_obj_index objectIndex, unsigned int& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <int>(type_com_obj_index objectIndex, int& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <unsigned long>(type_com_obj_index objectIndex, unsigned long& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <long>(type_com_obj_index objectIndex, long& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <float>(type_com_obj_index objectIndex, float& returnedValue);
+template e_KnxDeviceStatus KnxDevice::read <double>(type_com_obj_index objectIndex, double& returnedValue);
 
 
 
 // Read any type of com object (DPT value provided as is)
-e_KnxDeviceStatus KnxDevice::read(byte objectIndex, byte returnedValue[])
+e_KnxDeviceStatus KnxDevice::read(type_com_obj_index objectIndex, byte returnedValue[])
 {
   _comObjectsList[objectIndex].GetValue(returnedValue);
   return KNX_DEVICE_OK;
@@ -257,142 +368,495 @@ e_KnxDeviceStatus KnxDevice::read(byte objectIndex, byte returnedValue[])
 // Update an usual format com object
 // Supported DPT types are short com object, U16, V16, U32, V32, F16 and F32
 // The Com Object value is updated locally
-// And a telegram is sent on the EIB bus if the com object has communication & transmit attributes
-template <typename T>  e_KnxDeviceStatus KnxDevice::write(byte objectIndex, T value)
+// And a telegram is sent on the EIB bus with the given priority if the com object has communication & transmit attributes
+template <typename T>  e_KnxDeviceStatus KnxDevice::write(type_com_obj_index objectIndex, T value, e_KnxPriority priority)
 {
   type_tx_action action;
-  byte *destValue;
   byte length = _comObjectsList[objectIndex].GetLength();
   
   if (length <= 2 ) action.byteValue = (byte) value; // short object case
   else
   { // long object case, let's try to translate value to the com object DPT
-    destValue = (byte *) malloc(length-1); // allocate the memory for DPT
-    e_KnxDeviceStatus status = ConvertToDpt(value, destValue, pgm_read_byte(&KnxDPTIdToFormat[_comObjectsList[objectIndex].GetDptId()]));
-    if (status) // translation error
-    { 
-      free(destValue);
-      return status; // we cannot convert, we stop here
-    }
-    else  action.valuePtr = destValue;
+    e_KnxDeviceStatus status = ConvertToDpt(value, action.longValue, KnxDPTFormatFromFlash(_comObjectsList[objectIndex].GetDptId()));
+    if (status) return status; // translation error, we cannot convert, we stop here
   }    
   // add WRITE action in the TX action queue
   action.command = EIB_WRITE_REQUEST;
   action.index = objectIndex;
-  _txActionList.Append(action);
+  action.priority = priority;
+  action.transaction = _newActionTransaction;
+  action.attemptsNb = 0;
+  if (!ApplySendPolicy(action)) AppendWriteAction(action);
   return KNX_DEVICE_OK;
 }
 
-template e_KnxDeviceStatus KnxDevice::write <boolean>(byte objectIndex, boolean value);
-template e_KnxDeviceStatus KnxDevice::write <unsigned char>(byte objectIndex, unsigned char value);
-template e_KnxDeviceStatus KnxDevice::write <char>(byte objectIndex, char value);
-template e_KnxDeviceStatus KnxDevice::write <unsigned int>(byte objectIndex, unsigned int value);
-template e_KnxDeviceStatus KnxDevice::write <int>(byte objectIndex, int value);
-template e_KnxDeviceStatus KnxDevice::write <unsigned long>(byte objectIndex, unsigned long value);
-template e_KnxDeviceStatus KnxDevice::write <long>(byte objectIndex, long value);
-template e_KnxDeviceStatus KnxDevice::write <float>(byte objectIndex, float value);
-template e_KnxDeviceStatus KnxDevice::write <double>(byte objectIndex, double value);
+template e_KnxDeviceStatus KnxDevice::write <boolean>(type_com_obj_index objectIndex, boolean value, e_KnxPriority priority);
+template e_KnxDeviceStatus KnxDevice::write <unsigned char>(type_com_obj_index objectIndex, unsigned char value, e_KnxPriority priority);
+template e_KnxDeviceStatus KnxDevice::write <char>(type_com_obj_index objectIndex, char value, e_KnxPriority priority);
+template e_KnxDeviceStatus KnxDevice::write <unsigned int>(type_com_obj_index objectIndex, unsigned int value, e_KnxPriority priority);
+template e_KnxDeviceStatus KnxDevice::write <int>(type_com_obj_index objectIndex, int value, e_KnxPriority priority);
+template e_KnxDeviceStatus KnxDevice::write <unsigned long>(type_com_obj_index objectIndex, unsigned long value, e_KnxPriority priority);
+template e_KnxDeviceStatus KnxDevice::write <long>(type_com_obj_index objectIndex, long value, e_KnxPriority priority);
+template e_KnxDeviceStatus KnxDevice::write <float>(type_com_obj_index objectIndex, float value, e_KnxPriority priority);
+template e_KnxDeviceStatus KnxDevice::write <double>(type_com_obj_index objectIndex, double value, e_KnxPriority priority);
 
 
 // Update any type of com object (rough DPT value shall be provided)
 // The Com Object value is updated locally
-// And a telegram is sent on the EIB bus if the com object has communication & transmit attributes
-e_KnxDeviceStatus KnxDevice::write(byte objectIndex, byte valuePtr[])
+// And a telegram is sent on the EIB bus with the given priority if the com object has communication & transmit attributes
+e_KnxDeviceStatus KnxDevice::write(type_com_obj_index objectIndex, byte valuePtr[], e_KnxPriority priority)
 {
 type_tx_action action;
-byte *dptValue;
 byte length = _comObjectsList[objectIndex].GetLength();
 
   if (length>2) // check we are in long object case
   { // add WRITE action in the TX action queue
     action.command = EIB_WRITE_REQUEST;
     action.index = objectIndex;
-    dptValue = (byte *) malloc(length-1); // allocate the memory for long value
-    for (byte i=0; i<length-1; i++) dptValue[i] = valuePtr[i]; // copy value
-    action.valuePtr = (byte *) dptValue;
-    _txActionList.Append(action);
+    action.priority = priority;
+    action.transaction = _newActionTransaction;
+    action.attemptsNb = 0;
+    for (byte i=0; i<length-1; i++) action.longValue[i] = valuePtr[i]; // copy value
+    if (!ApplySendPolicy(action)) AppendWriteAction(action);
     return KNX_DEVICE_OK;
   }
   return KNX_DEVICE_ERROR;
 }
 
 
+// Update a com object from an interrupt routine, the write is done by task()
+// NB : only the producer side of the writes queue is used here, and the com objects list is not modified
+e_KnxDeviceStatus KnxDevice::writeFromIsr(type_com_obj_index objectIndex, byte value)
+{
+type_isr_write isrWrite;
+
+  if ((objectIndex >= _comObjectsNb) || (_comObjectsList[objectIndex].GetLength() > 2)) return KNX_DEVICE_ERROR;
+  isrWrite.index = objectIndex;
+  isrWrite.value[0] = value;
+  return _isrWrites.TryAppend(isrWrite) ? KNX_DEVICE_OK : KNX_DEVICE_ERROR;
+}
+
+
+e_KnxDeviceStatus KnxDevice::writeFromIsr(type_com_obj_index objectIndex, const byte valuePtr[])
+{
+type_isr_write isrWrite;
+byte length;
+
+  if (objectIndex >= _comObjectsNb) return KNX_DEVICE_ERROR;
+  length = _comObjectsList[objectIndex].GetLength();
+  if (length <= 2) return KNX_DEVICE_ERROR; // long object only
+  isrWrite.index = objectIndex;
+  for (byte i=0; i<length-1; i++) isrWrite.value[i] = valuePtr[i]; // copy value
+  return _isrWrites.TryAppend(isrWrite) ? KNX_DEVICE_OK : KNX_DEVICE_ERROR;
+}
+
+
 // Com Object EIB Bus Update request
 // Request the local object to be updated with the value from the bus
+// The read request is sent with the given priority
 // NB : the function is asynchroneous, the update completion is notified by the knxEvents() callback
-void KnxDevice::update(byte objectIndex)
+void KnxDevice::update(type_com_obj_index objectIndex, e_KnxPriority priority)
 {
 type_tx_action action;
   action.command = EIB_READ_REQUEST;
   action.index = objectIndex;
-  _txActionList.Append(action); 
+  action.priority = priority;
+  action.transaction = _newActionTransaction;
+  action.attemptsNb = 0;
+  AppendTxAction(action); 
+}
+
+
+// Attach a snapshot of the com objects values, and restore the saved values
+// Return the nb of restored com objects
+type_com_obj_index KnxDevice::attachSnapshot(KnxSnapshot& snapshot)
+{
+  _snapshot = &snapshot;
+  if (AttachLongValues() != KNX_DEVICE_OK) return 0; // the long values cannot be restored
+  return _snapshot->Restore(_comObjectsList, _comObjectsNb);
+}
+
+
+// Attach the long values without data space to a single block allocated once
+// NB : the values of a packed table are always in the arena sized at compile time
+e_KnxDeviceStatus KnxDevice::AttachLongValues(void)
+{
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+  return KNX_DEVICE_OK;
+#else
+  unsigned long size = KnxComObject::GetLongValuesSize(_comObjectsList, _comObjectsNb, true);
+  if (!size) return KNX_DEVICE_OK; // no long value, or arena sized at compile time, or already attached
+  _longValuesArena = (byte *) malloc(size);
+  if (_longValuesArena == NULL) return KNX_DEVICE_ERROR;
+  KnxComObject::AttachLongValuesArena(_comObjectsList, _comObjectsNb, _longValuesArena);
+  return KNX_DEVICE_OK;
+#endif
 }
 
 
 // The function returns true if there is rx/tx activity ongoing, else false
 boolean KnxDevice::isActive(void) const
 {
+  if (_state == RESET_ONGOING) return true; // the TPUART is being reset
   if (_tpuart->IsActive()) return true; // TPUART is active
   if (_state == TX_ONGOING) return true; // the Device is sending a request
-  if(_txActionList.ElementsNb()) return true; // there is at least one tx action in the queue
+  if(TxActionsNb()) return true; // there is at least one tx action in the queues
   return false;
 }
 
 
-// Static GetTpUartEvents() function called by the KnxTpUart layer (callback)
-void KnxDevice::GetTpUartEvents(e_KnxTpUartEvent event)
+// Init reads scheduling
+// The reads in flight are released as soon as the object gets valid (response received) or on timeout,
+// and new reads are started immediately within the limit of _initReadsMaxNb reads in flight
+void KnxDevice::InitTask(void)
 {
 type_tx_action action;
-byte targetedComObjIndex; // index of the Com Object targeted by the event
+word nowTimeMillis = millis();
+byte i;
+type_com_obj_index index;
+
+  // Release the answered reads and the timed out ones
+  // The timeout of a read starts when it leaves the TX queues : a read held by the rate limits or by a busy bus
+  // is not sent twice
+  for (i = 0; i < _initReadsNb; )
+  {
+    index = _initReads[i].index;
+    if (!_comObjectsList[index].GetValidity())
+    {
+      if (FindPendingAction(index, EIB_READ_REQUEST)) _initReads[i].startTimeMillis = nowTimeMillis; // not sent yet
+      if (TimeDeltaWord(nowTimeMillis, _initReads[i].startTimeMillis) <= _initReadTimeoutMillis)
+      { i++; continue; } // still waiting for the response
+      SetInitPending(index); // no response, the object will be read again later
+    }
+    _initReads[i] = _initReads[--_initReadsNb];
+  }
+
+  // Pause the init reads while the bus is busy
+  if (_initBackoffMillis && (TimeDeltaWord(nowTimeMillis, _initBackoffStartMillis) < _initBackoffMillis)) return;
+
+  // Start a new read, only when the TX queues are empty so that the application telegrams are not delayed
+  while ((_initReadsNb < _initReadsMaxNb) && !TxActionsNb() && NextInitPending(index))
+  {
+    ClearInitPending(index);
+    if (_comObjectsList[index].GetValidity()) continue; // updated meanwhile (e.g. bus write), no read needed
+#if defined(KNXDEVICE_DEBUG_INFO) || defined(KNXDEVICE_DEBUG_INFO_VERBOSE)
+    _nbOfInits++;
+#endif
+    action.command = EIB_READ_REQUEST;
+    action.index = index;
+    action.priority = _comObjectsList[index].GetPriority();
+    action.transaction = 0;
+    action.attemptsNb = 0;
+    AppendTxAction(action);
+    _initReads[_initReadsNb].index = index;
+    _initReads[_initReadsNb++].startTimeMillis = nowTimeMillis;
+  }
+
+  if (!_initPendingNb && !_initReadsNb)
+  {
+    _initCompleted = true; // All the Com Object initialization have been performed
+    _initDurationMillis = millis() - _beginTimeMillis;
+  //  DebugInfo(String("KNXDevice INFO: Com Object init completed, ")+ String( _nbOfInits) + String("objs initialized.\n"));
+  }
+}
+
+
+// Find the next com object waiting for its init read, from the cursor position
+// The bitset is scanned byte per byte, so the empty bytes (8 objects) are skipped at once : a search reads at
+// most (_comObjectsNb / 8) + 1 bytes, and returns at once when no object is waiting (_initPendingNb).
+// NB : the cost is linear in the nb of objects, but 8 times lower than the scan of the com objects list
+boolean KnxDevice::NextInitPending(type_com_obj_index& index)
+{
+word i = _initCursor;
+byte bits;
+
+  if (!_initPendingNb) return false;
+  for(;;)
+  {
+    bits = _initPendingBits[i >> 3] >> (i & 7);
+    if (bits)
+    { // the pending object is in this byte
+      while (!(bits & 1)) { bits >>= 1; i++; }
+      index = i;
+      _initCursor = (i + 1 < _comObjectsNb) ? i + 1 : 0; // the next search starts after this object
+      return true;
+    }
+    i = (i | 7) + 1; // next byte
+    if (i >= _comObjectsNb) i = 0;
+  }
+}
+
+
+// Set the bit of a com object in the init reads bitset
+void KnxDevice::SetInitPending(type_com_obj_index index)
+{
+  if (_initPendingBits[index >> 3] & (1 << (index & 7))) return;
+  _initPendingBits[index >> 3] |= (1 << (index & 7));
+  _initPendingNb++;
+}
+
+
+// Clear the bit of a com object in the init reads bitset
+void KnxDevice::ClearInitPending(type_com_obj_index index)
+{
+  if (!(_initPendingBits[index >> 3] & (1 << (index & 7)))) return;
+  _initPendingBits[index >> 3] &= ~(1 << (index & 7));
+  _initPendingNb--;
+}
+
+
+// Add a TX action in the queue matching its priority
+// NB : a full queue drops its oldest action, the transaction of a dropped action is completed
+void KnxDevice::AppendTxAction(const type_tx_action& action)
+{
+  byte lane = PriorityToTxLane(action.priority);
+  type_tx_action *oldestAction;
+  if (lane == TX_LANE_PRIO_NB)
+  {
+    if ((_txActionList.ElementsNb() == ACTIONS_QUEUE_SIZE) && ((oldestAction = _txActionList.Element(0)) != NULL)
+        && oldestAction->transaction) CompleteTransaction(oldestAction->transaction, KNX_TX_DROPPED);
+    _txActionList.Append(action);
+  }
+  else
+  {
+    if ((_txPrioActionLists[lane].ElementsNb() == ACTIONS_PRIO_QUEUE_SIZE)
+        && ((oldestAction = _txPrioActionLists[lane].Element(0)) != NULL) && oldestAction->transaction)
+      CompleteTransaction(oldestAction->transaction, KNX_TX_DROPPED);
+    _txPrioActionLists[lane].Append(action);
+  }
+}
+
+
+// Find the action of a given command pending for a given com object in the TX queues
+// Return NULL if there is no such pending action for this object
+type_tx_action* KnxDevice::FindPendingAction(type_com_obj_index objectIndex, e_KnxDeviceTxActionType command)
+{
+type_tx_action *action;
+
+  for (byte lane = 0; lane < TX_LANE_PRIO_NB; lane++)
+  {
+    for (byte i = 0; (action = _txPrioActionLists[lane].Element(i)) != NULL; i++)
+      if ((action->command == command) && (action->index == objectIndex)) return action;
+  }
+  for (byte i = 0; (action = _txActionList.Element(i)) != NULL; i++)
+    if ((action->command == command) && (action->index == objectIndex)) return action;
+  return NULL;
+}
+
 
-  // Manage RECEIVED MESSAGES
-  if (event == TPUART_EVENT_RECEIVED_EIB_TELEGRAM)
+// Queue a WRITE action, or merge it into the pending one in case of write coalescing
+void KnxDevice::AppendWriteAction(const type_tx_action& action)
+{
+type_tx_action *pendingAction;
+
+  SupersedeRetry(action.index); // the fresher value replaces the failed one (a pending write is never a retried one)
+  if (_writeCoalescing && ((pendingAction = FindPendingAction(action.index, EIB_WRITE_REQUEST)) != NULL))
+  { // latest value wins : the pending write value is updated in place
+    byte length = _comObjectsList[action.index].GetLength();
+    if (length <= 2) pendingAction->byteValue = action.byteValue;
+    else for (byte i=0; i<length-1; i++) pendingAction->longValue[i] = action.longValue[i];
+    if (action.transaction)
+    { // the pending write is now tracked by the new transaction, its own value will not be sent
+      if (pendingAction->transaction) CompleteTransaction(pendingAction->transaction, KNX_TX_SUPERSEDED);
+      pendingAction->transaction = action.transaction;
+    }
+    _mergedWritesNb++;
+  }
+  else AppendTxAction(action);
+}
+
+
+// Pop the next TX action to be performed, from the highest priority non-empty queue
+// Return TRUE when an action is available, otherwise FALSE
+boolean KnxDevice::PopTxAction(type_tx_action& action)
+{
+  for (byte lane = 0; lane < TX_LANE_PRIO_NB; lane++)
+    if (_txPrioActionLists[lane].Pop(action)) return true;
+  return _txActionList.Pop(action);
+}
+
+
+// Pop the next TX action allowed by the rate limits, from the highest priority non-empty queue
+// An action held by the limit of its group address stays queued (a newer write may be merged into it),
+// and the next actions are sent meanwhile. The writes sending no telegram are never held.
+boolean KnxDevice::PopAllowedTxAction(type_tx_action& action)
+{
+type_tx_action *pendingAction;
+unsigned long nowTimeMillis;
+boolean deviceTokenAvailable;
+
+  if (!_txGroupLimitsNb && !_txBucket.IsLimited()) return PopTxAction(action); // no rate limit
+  nowTimeMillis = millis();
+  deviceTokenAvailable = _txBucket.Available(nowTimeMillis);
+  for (byte lane = 0; lane < TX_LANE_PRIO_NB; lane++)
+  {
+    for (byte i = 0; (pendingAction = _txPrioActionLists[lane].Element(i)) != NULL; i++)
+      if (TakeTxTokens(*pendingAction, deviceTokenAvailable, nowTimeMillis)) return _txPrioActionLists[lane].Remove(i, action);
+  }
+  for (byte i = 0; (pendingAction = _txActionList.Element(i)) != NULL; i++)
+    if (TakeTxTokens(*pendingAction, deviceTokenAvailable, nowTimeMillis)) return _txActionList.Remove(i, action);
+  return false;
+}
+
+
+// Take the tokens needed to send the telegram of an action
+boolean KnxDevice::TakeTxTokens(const type_tx_action& action, boolean deviceTokenAvailable, unsigned long nowTimeMillis)
+{
+KnxTokenBucket *groupBucket = NULL;
+word addr;
+
+  if ((action.command == EIB_WRITE_REQUEST) && !(_comObjectsList[action.index].GetIndicator() & KNX_COM_OBJ_T_INDICATOR))
+    return true; // local write, no telegram sent
+  if (!deviceTokenAvailable) return false;
+  addr = _comObjectsList[action.index].GetAddr();
+  for (byte i = 0; i < _txGroupLimitsNb; i++)
+    if (_txGroupLimits[i].addr == addr) { groupBucket = &_txGroupLimits[i].bucket; break; }
+  if (groupBucket)
   {
-    Knx._state = IDLE;
-    targetedComObjIndex = Knx._tpuart->GetTargetedComObjectIndex();
+    if (!groupBucket->Available(nowTimeMillis)) return false;
+    groupBucket->Take();
+  }
+  _txBucket.Take();
+  return true;
+}
+
+
+// Limit the rate of the telegrams sent to a group address
+e_KnxDeviceStatus KnxDevice::setGroupRateLimit(word groupAddr, word periodMillis, byte burst)
+{
+byte i;
+
+  for (i = 0; (i < _txGroupLimitsNb) && (_txGroupLimits[i].addr != groupAddr); i++);
+  if (!periodMillis)
+  { // limit removed, the slot is given to the last limit
+    if (i < _txGroupLimitsNb) _txGroupLimits[i] = _txGroupLimits[--_txGroupLimitsNb];
+    return KNX_DEVICE_OK;
+  }
+  if (i == _txGroupLimitsNb)
+  { // new limited group address
+    if (_txGroupLimitsNb == KNX_DEVICE_TX_GROUP_LIMITS_NB) return KNX_DEVICE_ERROR;
+    _txGroupLimits[_txGroupLimitsNb++].addr = groupAddr;
+  }
+  _txGroupLimits[i].bucket.SetRate(periodMillis, burst, millis());
+  return KNX_DEVICE_OK;
+}
+
 
-    switch(Knx._rxTelegram->GetCommand())
+// Return the nb of TX actions waiting in all the queues
+byte KnxDevice::TxActionsNb(void) const
+{
+  byte nb = _txActionList.ElementsNb();
+  for (byte lane = 0; lane < TX_LANE_PRIO_NB; lane++) nb += _txPrioActionLists[lane].ElementsNb();
+  return nb;
+}
+
+
+// Return TRUE when the TX queue of a priority is full
+boolean KnxDevice::TxQueueFull(e_KnxPriority priority) const
+{
+  byte lane = PriorityToTxLane(priority);
+  if (lane == TX_LANE_PRIO_NB) return (_txActionList.ElementsNb() == ACTIONS_QUEUE_SIZE);
+  return (_txPrioActionLists[lane].ElementsNb() == ACTIONS_PRIO_QUEUE_SIZE);
+}
+
+
+// Do the writes queued by the interrupt routines, in their order
+// A write waits in the queue while its TX queue is full : a full TX queue would drop its oldest action, and the
+// interrupt routines get the backpressure (writeFromIsr() fails) instead
+void KnxDevice::IsrWritesTask(void)
+{
+const type_isr_write *pendingWrite;
+type_isr_write isrWrite;
+
+  while (((pendingWrite = _isrWrites.Front()) != NULL)
+         && !TxQueueFull(_comObjectsList[pendingWrite->index].GetPriority()))
+  {
+    _isrWrites.Pop(isrWrite);
+    if (_comObjectsList[isrWrite.index].GetLength() <= 2) write(isrWrite.index, isrWrite.value[0]);
+    else write(isrWrite.index, isrWrite.value);
+  }
+}
+
+
+// Process the telegrams waiting in the TPUART RX queue
+// Each telegram is processed in its queue slot (no copy), the slot is then released for a next reception
+// At least one telegram is processed, the next ones as long as the dispatch time budget is not spent
+// NB : the device state is not changed here, a telegram may be received while a telegram is being sent
+// (the end of the transmission is always notified by TxTelegramAck())
+void KnxDevice::RxTask(void)
+{
+type_tx_action action;
+type_com_obj_index targetedComObjIndex; // index of the Com Object targeted by the telegram
+type_com_obj_index targetedComObjNb, rank; // nb of Com Objects targeted by the received telegram (fan-out)
+unsigned long startTimeMicros = micros();
+
+  while ((_rxTelegram = _tpuart->GetReceivedTelegram()) != NULL)
+  {
+    // NB : a group address may be shared by several Com Objects, the telegram is applied to all of them
+    targetedComObjNb = _tpuart->GetTargetedComObjectsNb();
+
+    switch(_rxTelegram->GetCommand())
     {
       case KNX_COMMAND_VALUE_READ :
 #if defined(KNXDEVICE_DEBUG_INFO)
-    	Knx.DebugInfo("READ req.\n");
+    	DebugInfo("READ req.\n");
 #endif
         // READ command coming from the bus
-        // if the Com Object has read attribute, then add RESPONSE action in the TX action list
-        if ( (_comObjectsList[targetedComObjIndex].GetIndicator()) & KNX_COM_OBJ_R_INDICATOR)
-        { // The targeted Com Object can indeed be read
-          action.command = EIB_RESPONSE_REQUEST;
-          action.index = targetedComObjIndex;
-          Knx._txActionList.Append(action);
+        // the first targeted Com Object with read attribute answers : add RESPONSE action in the TX action list
+        for (rank = 0; rank < targetedComObjNb; rank++)
+        {
+          targetedComObjIndex = _tpuart->GetTargetedComObjectIndex(rank);
+          if ( (_comObjectsList[targetedComObjIndex].GetIndicator()) & KNX_COM_OBJ_R_INDICATOR)
+          { // The targeted Com Object can indeed be read
+            action.command = EIB_RESPONSE_REQUEST;
+            action.index = targetedComObjIndex;
+            action.priority = _comObjectsList[targetedComObjIndex].GetPriority();
+            action.transaction = 0;
+            action.attemptsNb = 0;
+            AppendTxAction(action);
+            break; // a single response is sent on the bus
+          }
         }
         break;
 
       case KNX_COMMAND_VALUE_RESPONSE :
 #if defined(KNXDEVICE_DEBUG_INFO)
-      	Knx.DebugInfo("RESP req.\n");
+      	DebugInfo("RESP req.\n");
 #endif
-        // RESPONSE command coming from EIB network, we update the value of the corresponding Com Object.
-        // We 1st check that the corresponding Com Object has UPDATE attribute
-        if((_comObjectsList[targetedComObjIndex].GetIndicator()) & KNX_COM_OBJ_U_INDICATOR)
+        // RESPONSE command coming from EIB network, we update the value of the corresponding Com Objects.
+        // We 1st check that each corresponding Com Object has UPDATE attribute
+        for (rank = 0; rank < targetedComObjNb; rank++)
         {
-          _comObjectsList[targetedComObjIndex].UpdateValue(*(Knx._rxTelegram));
-          //We notify the upper layer of the update
-          knxEvents(targetedComObjIndex);
+          targetedComObjIndex = _tpuart->GetTargetedComObjectIndex(rank);
+          if((_comObjectsList[targetedComObjIndex].GetIndicator()) & KNX_COM_OBJ_U_INDICATOR)
+          {
+            _comObjectsList[targetedComObjIndex].UpdateValue(*_rxTelegram);
+            if (_snapshot) _snapshot->SetChanged(targetedComObjIndex);
+            SupersedeRetry(targetedComObjIndex); // the bus value is fresher than a failed write
+            //We notify the upper layer of the update
+            NotifyUpdate(targetedComObjIndex);
+          }
         }
         break;
 
 
       case KNX_COMMAND_VALUE_WRITE :
 #if defined(KNXDEVICE_DEBUG_INFO)
-    	Knx.DebugInfo("WRITE req.\n");
+    	DebugInfo("WRITE req.\n");
 #endif
-        // WRITE command coming from EIB network, we update the value of the corresponding Com Object.
-        // We 1st check that the corresponding Com Object has WRITE attribute
-        if((_comObjectsList[targetedComObjIndex].GetIndicator()) & KNX_COM_OBJ_W_INDICATOR)
+        // WRITE command coming from EIB network, we update the value of the corresponding Com Objects.
+        // We 1st check that each corresponding Com Object has WRITE attribute
+        for (rank = 0; rank < targetedComObjNb; rank++)
         {
-          _comObjectsList[targetedComObjIndex].UpdateValue(*(Knx._rxTelegram));
-          //We notify the upper layer of the update
-          knxEvents(targetedComObjIndex);
+          targetedComObjIndex = _tpuart->GetTargetedComObjectIndex(rank);
+          if((_comObjectsList[targetedComObjIndex].GetIndicator()) & KNX_COM_OBJ_W_INDICATOR)
+          {
+            _comObjectsList[targetedComObjIndex].UpdateValue(*_rxTelegram);
+            if (_snapshot) _snapshot->SetChanged(targetedComObjIndex);
+            SupersedeRetry(targetedComObjIndex); // the bus value is fresher than a failed write
+            //We notify the upper layer of the update
+            NotifyUpdate(targetedComObjIndex);
+          }
         }
         break;
 
@@ -400,14 +864,392 @@ byte targetedComObjIndex; // index of the Com Object targeted by the event
 
       default : break; // not supposed to happen
     }
+    _tpuart->ReleaseReceivedTelegram();
+    if (_tpuart->GetReceivedTelegramsNb() && ((micros() - startTimeMicros) >= _dispatchBudgetMicros))
+    { // budget spent, the remaining telegrams are dispatched by the next task() execution
+      _rxTelegram = NULL;
+      _deferredDispatchesNb++;
+      break;
+    }
+  }
+}
+
+
+// Notify the update of a com object by the bus
+void KnxDevice::NotifyUpdate(type_com_obj_index objectIndex)
+{
+  if (_changedBits)
+  { // batched updates : the com object is notified by the next BatchTask() call
+    if (isComObjectSet(_changedBits, objectIndex)) return; // already updated during this task() execution
+    _changedBits[objectIndex >> 3] |= (1 << (objectIndex & 7));
+    _changedNb++;
+  }
+  else
+  {
+    unsigned long startTimeMicros = micros();
+    if (_handlers && _handlers[objectIndex]) _handlers[objectIndex](objectIndex);
+    else knxEvents(objectIndex);
+    RecordHandlerDuration(startTimeMicros);
+  }
+}
+
+
+// Record the execution time of an update handler
+// NB : the durations are computed on 32 bits, so that a handler running longer than 65ms is not truncated
+void KnxDevice::RecordHandlerDuration(unsigned long startTimeMicros)
+{
+unsigned long duration = micros() - startTimeMicros;
+
+  if (duration > _maxHandlerMicros) _maxHandlerMicros = duration;
+  _handlersMicros += duration;
+}
+
+
+// Call the batched updates handler, and clear the bitset
+// NB : only the bytes having bits set are cleared, the bitset is scanned byte per byte
+void KnxDevice::BatchTask(void)
+{
+byte *changedBits = _changedBits;
+type_com_obj_index nb = _changedNb;
+unsigned long startTimeMicros = micros();
+
+  _batchHandler(changedBits, nb);
+  RecordHandlerDuration(startTimeMicros);
+  // the handler may have disabled the batch or given a new bitset (setBatchedEvents() clears the new one)
+  if (_changedBits != changedBits) return;
+  for (word i = 0; nb && (i < KNX_DEVICE_BITSET_SIZE(_comObjectsNb)); i++)
+  {
+    if (!changedBits[i]) continue;
+    for (byte bits = changedBits[i]; bits && nb; bits &= bits - 1) nb--;
+    changedBits[i] = 0;
+  }
+  _changedNb = 0;
+}
+
+
+// Enable the batched updates notification (NULL bitset to disable)
+void KnxDevice::setBatchedEvents(byte changedBits[], type_knx_batch_handler handler)
+{
+  _changedBits = (handler ? changedBits : NULL);
+  _batchHandler = handler;
+  _changedNb = 0;
+  if (_changedBits) for (word i = 0; i < KNX_DEVICE_BITSET_SIZE(_comObjectsNb); i++) _changedBits[i] = 0;
+}
+
+
+// Allocate a transaction in the pool for a com object
+// A free slot is taken first, otherwise a completed transaction not read yet (polling) is recycled
+type_knx_tx_handle KnxDevice::NewTransaction(type_com_obj_index objectIndex, type_knx_tx_handler handler)
+{
+byte slot;
+
+  for (slot = 0; slot < KNX_DEVICE_TX_TRANSACTIONS_NB; slot++)
+    if (_txTransactions[slot].handle == KNX_TX_HANDLE_NONE) break;
+  if (slot == KNX_DEVICE_TX_TRANSACTIONS_NB)
+  {
+    for (slot = 0; slot < KNX_DEVICE_TX_TRANSACTIONS_NB; slot++)
+      if ((_txTransactions[slot].status != KNX_TX_PENDING) && (_txTransactions[slot].handler == NULL)) break;
+    if (slot == KNX_DEVICE_TX_TRANSACTIONS_NB) return KNX_TX_HANDLE_NONE; // pool full
+  }
+  if (++_txHandleGeneration > 31) _txHandleGeneration = 1; // the generation is never 0 (no KNX_TX_HANDLE_NONE handle)
+  _txTransactions[slot].handle = (_txHandleGeneration << 3) | slot;
+  _txTransactions[slot].status = KNX_TX_PENDING;
+  _txTransactions[slot].index = objectIndex;
+  _txTransactions[slot].handler = handler;
+  _txTransactions[slot].timeMicros = micros();
+  _newActionTransaction = slot + 1;
+  return _txTransactions[slot].handle;
+}
+
+
+// End the tracking of the actions built by write()/update()
+type_knx_tx_handle KnxDevice::EndNewTransaction(type_knx_tx_handle handle, boolean used)
+{
+  _newActionTransaction = 0;
+  if ((handle != KNX_TX_HANDLE_NONE) && !used)
+  { // no action built (write error)
+    _txTransactions[handle & 7].handle = KNX_TX_HANDLE_NONE;
+    return KNX_TX_HANDLE_NONE;
+  }
+  return handle;
+}
+
+
+// Complete the transaction of a pool slot (+1)
+void KnxDevice::CompleteTransaction(byte transaction, e_KnxTxStatus status)
+{
+type_tx_transaction& tr = _txTransactions[transaction - 1];
+
+  if ((tr.handle == KNX_TX_HANDLE_NONE) || (tr.status != KNX_TX_PENDING)) return;
+  tr.status = status;
+  tr.timeMicros = micros() - tr.timeMicros; // latency
+}
+
+
+// Call the handlers of the completed transactions, and release them
+void KnxDevice::TransactionsTask(void)
+{
+unsigned long startTimeMicros;
+
+  for (byte slot = 0; slot < KNX_DEVICE_TX_TRANSACTIONS_NB; slot++)
+  {
+    type_tx_transaction& tr = _txTransactions[slot];
+    if ((tr.handle == KNX_TX_HANDLE_NONE) || (tr.status == KNX_TX_PENDING) || (tr.handler == NULL)) continue;
+    type_knx_tx_handle handle = tr.handle;
+    tr.handle = KNX_TX_HANDLE_NONE; // released before the call, the handler may start a new transaction
+    startTimeMicros = micros();
+    tr.handler(handle, tr.index, tr.status, tr.timeMicros);
+    RecordHandlerDuration(startTimeMicros);
   }
+}
+
+
+// Get the status of a tracked transaction
+e_KnxTxStatus KnxDevice::getTxStatus(type_knx_tx_handle handle, unsigned long *latencyMicros)
+{
+byte slot = handle & 7;
+
+  if ((slot >= KNX_DEVICE_TX_TRANSACTIONS_NB) || (handle == KNX_TX_HANDLE_NONE) || (_txTransactions[slot].handle != handle))
+    return KNX_TX_UNKNOWN;
+  if (_txTransactions[slot].status == KNX_TX_PENDING) return KNX_TX_PENDING;
+  if (latencyMicros) *latencyMicros = _txTransactions[slot].timeMicros;
+  _txTransactions[slot].handle = KNX_TX_HANDLE_NONE; // completion read, the handle is released
+  return _txTransactions[slot].status;
+}
+
+
+// Attach the send policies of com objects
+e_KnxDeviceStatus KnxDevice::attachSendPolicies(type_knx_send_policy policies[], byte policiesNb)
+{
+byte dptValue[ACTION_VALUE_MAX_SIZE];
+float value;
+
+  if (!policies) policiesNb = 0; // policies detached
+  for (byte i = 0; i < ACTION_VALUE_MAX_SIZE; i++) dptValue[i] = 0;
+  for (byte i = 0; i < policiesNb; i++)
+  {
+    if (policies[i].index >= _comObjectsNb) return KNX_DEVICE_ERROR; // unknown com object
+    if (DecodeValue(policies[i].index, dptValue, value) != KNX_DEVICE_OK) return KNX_DEVICE_ERROR; // format not supported
+    policies[i].state = 0;
+  }
+  _sendPolicies = policies;
+  _sendPoliciesNb = policiesNb;
+  return KNX_DEVICE_OK;
+}
+
+
+// Apply the send policy of the com object of a WRITE action
+// A tracked write is sent at once (the policy restarts from its value), as well as a write following a queued
+// tracked write (whose value is kept). Otherwise the com object value is updated at once and the telegram is
+// sent later by SendPoliciesTask()
+// Return TRUE when the action is absorbed by the policy (not to be queued)
+boolean KnxDevice::ApplySendPolicy(const type_tx_action& action)
+{
+type_knx_send_policy *policy = NULL;
+type_tx_action *pendingAction;
+
+  for (byte i = 0; i < _sendPoliciesNb; i++)
+    if (_sendPolicies[i].index == action.index) { policy = &_sendPolicies[i]; break; }
+  if (!policy) return false;
+  pendingAction = FindPendingAction(action.index, EIB_WRITE_REQUEST);
+  if (action.transaction || (pendingAction && pendingAction->transaction))
+  { // tracked write, or write queued after a tracked one
+    DecodeValue(action.index, (_comObjectsList[action.index].GetLength() <= 2) ? &action.byteValue : action.longValue,
+                policy->sentValue);
+    policy->sentTimeMillis = millis();
+    policy->state = KNX_SEND_POLICY_SENT;
+    return false;
+  }
+  // the fresher value replaces a failed one, whose sending is unknown : the new value is sent at once
+  if (SupersedeRetry(action.index)) policy->state &= ~KNX_SEND_POLICY_SENT;
+  if ((_comObjectsList[action.index].GetLength()) <= 2 ) _comObjectsList[action.index].UpdateValue(action.byteValue);
+  else _comObjectsList[action.index].UpdateValue(action.longValue);
+  if (_snapshot) _snapshot->SetChanged(action.index);
+  _policyWritesNb++;
+  if (pendingAction)
+  { // the value sent by the policy is still queued : it is replaced by the new one (the queued value would
+    // overwrite the com object value when sent)
+    byte length = _comObjectsList[action.index].GetLength();
+    if (length <= 2) pendingAction->byteValue = action.byteValue;
+    else for (byte i=0; i<length-1; i++) pendingAction->longValue[i] = action.longValue[i];
+    DecodeValue(action.index, (length <= 2) ? &action.byteValue : action.longValue, policy->sentValue);
+    return true;
+  }
+  policy->state |= KNX_SEND_POLICY_CHANGED;
+  return true;
+}
+
+
+// Queue the values of the com objects having a send policy, when the policy requires it
+// The value is decoded only when the com object has been written since the last evaluation
+void KnxDevice::SendPoliciesTask(void)
+{
+type_knx_send_policy *policy;
+type_tx_action action;
+unsigned long nowTimeMillis = millis(), elapsedMillis;
+byte dptValue[ACTION_VALUE_MAX_SIZE];
+float value, change, deadband;
+boolean send;
+
+  for (byte i = 0; i < _sendPoliciesNb; i++)
+  {
+    policy = &_sendPolicies[i];
+    elapsedMillis = nowTimeMillis - policy->sentTimeMillis;
+    if (!(policy->state & KNX_SEND_POLICY_SENT))
+    { // the first written value is sent at once
+      if (!(policy->state & KNX_SEND_POLICY_CHANGED)) continue;
+      send = true;
+    }
+    else if (elapsedMillis < policy->minIntervalMillis) continue; // the changes are evaluated at the end of the min interval
+    else send = (policy->heartbeatSec && (elapsedMillis >= policy->heartbeatSec * 1000UL));
+    if (policy->state & KNX_SEND_POLICY_CHANGED)
+    { // written since the last evaluation, the value is compared to the last sent one
+      policy->state &= ~KNX_SEND_POLICY_CHANGED;
+      _comObjectsList[policy->index].GetValue(dptValue);
+      DecodeValue(policy->index, dptValue, value);
+      change = value - policy->sentValue;
+      if (change < 0) change = -change;
+      deadband = policy->deadband;
+      if (policy->relativeDeadband) deadband *= ((policy->sentValue < 0) ? -policy->sentValue : policy->sentValue) / 100;
+      if (change == 0) policy->state &= ~KNX_SEND_POLICY_DRIFTED;
+      else if (change >= deadband) send = true;
+      else policy->state |= KNX_SEND_POLICY_DRIFTED; // change below the deadband
+    }
+    if ((policy->state & KNX_SEND_POLICY_DRIFTED) && policy->maxIntervalSec
+        && (elapsedMillis >= policy->maxIntervalSec * 1000UL)) send = true;
+    if (!send) continue;
+    // the current value is sent
+    action.command = EIB_WRITE_REQUEST;
+    action.index = policy->index;
+    action.priority = _comObjectsList[policy->index].GetPriority();
+    action.transaction = 0;
+    action.attemptsNb = 0;
+    if ((_comObjectsList[policy->index].GetLength()) <= 2) action.byteValue = _comObjectsList[policy->index].GetValue();
+    else _comObjectsList[policy->index].GetValue(action.longValue);
+    AppendWriteAction(action);
+    _comObjectsList[policy->index].GetValue(dptValue);
+    DecodeValue(policy->index, dptValue, policy->sentValue);
+    policy->sentTimeMillis = nowTimeMillis;
+    policy->state = KNX_SEND_POLICY_SENT;
+    _policySendsNb++;
+  }
+}
+
+
+// Decode the DPT value of a com object (short values, U16, V16, F16, U32 and V32 formats)
+e_KnxDeviceStatus KnxDevice::DecodeValue(type_com_obj_index objectIndex, const byte dptValue[], float& value)
+{
+  if (_comObjectsList[objectIndex].GetLength() <= 2) { value = dptValue[0]; return KNX_DEVICE_OK; }
+  return ConvertFromDpt(dptValue, value, KnxDPTFormatFromFlash(_comObjectsList[objectIndex].GetDptId()));
+}
+
+
+// Set the policy of the retries of the failed writes
+void KnxDevice::setRetryPolicy(byte attemptsNb, word backoffMillis, word maxBackoffMillis)
+{
+  if (attemptsNb < 1) attemptsNb = 1;
+  if (backoffMillis < 1) backoffMillis = 1;
+  if (maxBackoffMillis < backoffMillis) maxBackoffMillis = backoffMillis;
+  _retryAttemptsNb = attemptsNb; _retryBackoffMillis = backoffMillis; _retryMaxBackoffMillis = maxBackoffMillis;
+}
+
+
+// Schedule the retry of a failed action
+// The delay is the backoff doubled on each failure (up to the max backoff), with "equal jitter" :
+// half of the delay is fixed, the other half is random
+// Return FALSE when the action is not retried (not a write, retries disabled, attempts exhausted or no free slot)
+boolean KnxDevice::ScheduleRetry(const type_tx_action& action)
+{
+  word delayMillis;
+  if ((action.command != EIB_WRITE_REQUEST) || (_retryAttemptsNb <= 1)) return false;
+  if (action.attemptsNb + 1 >= _retryAttemptsNb) { _giveUpsNb++; return false; }
+  for (byte i = 0; i < KNX_DEVICE_RETRIES_NB; i++)
+  {
+    if (_retries[i].action.attemptsNb) continue; // slot used
+    delayMillis = _retryBackoffMillis;
+    for (byte n = 0; (n < action.attemptsNb) && (delayMillis < _retryMaxBackoffMillis); n++)
+    { // clamped before the shift, a doubled delay may not fit in a word
+      if (delayMillis > (_retryMaxBackoffMillis >> 1)) delayMillis = _retryMaxBackoffMillis;
+      else delayMillis <<= 1;
+    }
+    // xorshift16 pseudo random generator
+    _retryJitterSeed ^= _retryJitterSeed << 7; _retryJitterSeed ^= _retryJitterSeed >> 9; _retryJitterSeed ^= _retryJitterSeed << 8;
+    _retries[i].delayMillis = (delayMillis >> 1) + (_retryJitterSeed % ((delayMillis >> 1) + 1));
+    _retries[i].startTimeMillis = (word) millis();
+    _retries[i].action = action;
+    _retries[i].action.attemptsNb++;
+    return true;
+  }
+  _giveUpsNb++;
+  return false;
+}
+
+
+// Queue again the failed actions whose retry delay is elapsed
+void KnxDevice::RetryTask(void)
+{
+  word nowTimeMillis = (word) millis();
+  for (byte i = 0; i < KNX_DEVICE_RETRIES_NB; i++)
+  {
+    if (!_retries[i].action.attemptsNb) continue; // free slot
+    if ((word)(nowTimeMillis - _retries[i].startTimeMillis) < _retries[i].delayMillis) continue;
+    AppendTxAction(_retries[i].action);
+    _retries[i].action.attemptsNb = 0;
+    _retriesNb++;
+  }
+}
+
+
+// Cancel the retries of a given com object, their transactions are completed as superseded
+// Both the retries waiting for their backoff and the retried writes already queued again by RetryTask() are
+// cancelled, so that a stale value never overwrites a fresher one (written by the application or by the bus)
+// Return TRUE when a retry is cancelled
+boolean KnxDevice::SupersedeRetry(type_com_obj_index objectIndex)
+{
+type_tx_action *pendingAction, action;
+boolean superseded = false;
+
+  for (byte i = 0; i < KNX_DEVICE_RETRIES_NB; i++)
+  {
+    if (!_retries[i].action.attemptsNb || (_retries[i].action.index != objectIndex)) continue;
+    if (_retries[i].action.transaction) CompleteTransaction(_retries[i].action.transaction, KNX_TX_SUPERSEDED);
+    _retries[i].action.attemptsNb = 0;
+    superseded = true;
+  }
+  for (byte lane = 0; lane < TX_LANE_PRIO_NB; lane++)
+  {
+    for (byte i = 0; (pendingAction = _txPrioActionLists[lane].Element(i)) != NULL; )
+    {
+      if ((pendingAction->command != EIB_WRITE_REQUEST) || !pendingAction->attemptsNb
+          || (pendingAction->index != objectIndex)) { i++; continue; }
+      _txPrioActionLists[lane].Remove(i, action);
+      if (action.transaction) CompleteTransaction(action.transaction, KNX_TX_SUPERSEDED);
+      superseded = true;
+    }
+  }
+  for (byte i = 0; (pendingAction = _txActionList.Element(i)) != NULL; )
+  {
+    if ((pendingAction->command != EIB_WRITE_REQUEST) || !pendingAction->attemptsNb
+        || (pendingAction->index != objectIndex)) { i++; continue; }
+    _txActionList.Remove(i, action);
+    if (action.transaction) CompleteTransaction(action.transaction, KNX_TX_SUPERSEDED);
+    superseded = true;
+  }
+  return superseded;
+}
+
+
+// Static GetTpUartEvents() function called by the KnxTpUart layer (callback)
+void KnxDevice::GetTpUartEvents(e_KnxTpUartEvent event)
+{
+  // NB : the RECEIVED_EIB_TELEGRAM events are not handled here, the RX queue is processed by RxTask()
 
   // Manage RESET events
   if (event == TPUART_EVENT_RESET)
   {
-    while(Knx._tpuart->Reset()==KNX_TPUART_ERROR);
-    Knx._tpuart->Init();
-    Knx._state = IDLE;
+    // The reset is started here and then completed by the task() calls
+    Knx._tpuart->StartReset();
+    Knx._state = RESET_ONGOING;
   }
 }
 
@@ -416,6 +1258,26 @@ byte targetedComObjIndex; // index of the Com Object targeted by the event
 void KnxDevice::TxTelegramAck(e_TpUartTxAck value)
 {
   Knx._state = IDLE;
+  // A failed write is retried according to the retry policy, its transaction remains pending
+  if (((value == ACK_RESPONSE) || !Knx.ScheduleRetry(Knx._sentAction)) && Knx._sentAction.transaction)
+  { // the handler is called later by task()
+    switch (value)
+    {
+      case ACK_RESPONSE : Knx.CompleteTransaction(Knx._sentAction.transaction, KNX_TX_ACK); break;
+      case NACK_RESPONSE : Knx.CompleteTransaction(Knx._sentAction.transaction, KNX_TX_NACK); break;
+      case NO_ANSWER_TIMEOUT : Knx.CompleteTransaction(Knx._sentAction.transaction, KNX_TX_NO_ANSWER); break;
+      default : Knx.CompleteTransaction(Knx._sentAction.transaction, KNX_TX_RESET); break;
+    }
+  }
+  Knx._sentAction.transaction = 0;
+  // The init reads are paused while the telegrams are not acknowledged (bus busy or disturbed)
+  if ((value == NACK_RESPONSE) || (value == NO_ANSWER_TIMEOUT))
+  {
+    if (Knx._initBackoffMillis < KNX_DEVICE_INIT_BACKOFF_MIN_MILLIS) Knx._initBackoffMillis = KNX_DEVICE_INIT_BACKOFF_MIN_MILLIS;
+    else if (Knx._initBackoffMillis < KNX_DEVICE_INIT_BACKOFF_MAX_MILLIS) Knx._initBackoffMillis *= 2;
+    Knx._initBackoffStartMillis = millis();
+  }
+  else if (value == ACK_RESPONSE) Knx._initBackoffMillis = 0;
 #ifdef KNXDevice_DEBUG
   if(value != ACK_RESPONSE)
   {
@@ -19,7 +19,7 @@
 // File : KnxDevice.h
 // Author : Franck Marini
 // Description : KnxDevice Abstraction Layer
-// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxTpUart, ActionRingBuffer
+// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxPackedComObjects, KnxComObjectTable, KnxTpUart, ActionRingBuffer, SpscRingBuffer, KnxSnapshot, KnxTokenBucket
 
 #ifndef KNXDEVICE_H
 #define KNXDEVICE_H
@@ -27,8 +27,13 @@
 #include "Arduino.h"
 #include "KnxTelegram.h"
 #include "KnxComObject.h"
+#include "KnxPackedComObjects.h"
+#include "KnxComObjectTable.h"
 #include "ActionRingBuffer.h"
+#include "SpscRingBuffer.h"
 #include "KnxTpUart.h"
+#include "KnxSnapshot.h"
+#include "KnxTokenBucket.h"
 
 // !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
 // DEBUG :
@@ -42,22 +47,50 @@ enum e_KnxDeviceStatus {
 };
 
 // Macro functions for conversion of physical and 2/3 level group addresses
-inline word P_ADDR(byte area, byte line, byte busdevice)
+// NB : the functions are constexpr so that the com objects list can be initialized at compile time
+constexpr word P_ADDR(byte area, byte line, byte busdevice)
 { return (word) ( ((area&0xF)<<12) + ((line&0xF)<<8) + busdevice ); }
 
-inline word G_ADDR(byte maingrp, byte midgrp, byte subgrp)
+constexpr word G_ADDR(byte maingrp, byte midgrp, byte subgrp)
 { return (word) ( ((maingrp&0x1F)<<11) + ((midgrp&0x7)<<8) + subgrp ); }
 
-inline word G_ADDR(byte maingrp, byte subgrp)
+constexpr word G_ADDR(byte maingrp, byte subgrp)
 { return (word) ( ((maingrp&0x1F)<<11) + subgrp ); }
 
-#define ACTIONS_QUEUE_SIZE 16
+#define ACTIONS_QUEUE_SIZE 16     // Size of the NORMAL priority TX actions queue
+#define ACTIONS_PRIO_QUEUE_SIZE 4 // Size of each SYSTEM, ALARM and HIGH priority TX actions queue
+
+// TX action queues ("lanes"), ordered by decreasing KNX priority
+// The NORMAL priority lane is the _txActionList queue
+enum e_KnxDeviceTxLane {
+  TX_LANE_SYSTEM = 0,
+  TX_LANE_ALARM,
+  TX_LANE_HIGH,
+  TX_LANE_PRIO_NB // Nb of lanes with priority higher than NORMAL
+};
+
+// Init reads of the com objects having Init Read attribute
+#define KNX_DEVICE_INIT_READS_MAX_NB           4    // Max nb of init reads in flight
+#define KNX_DEVICE_INIT_READS_DEFAULT_NB       2    // Default nb of init reads in flight
+#define KNX_DEVICE_INIT_READ_TIMEOUT_MILLIS    1000 // Default time waited for the response to an init read
+#define KNX_DEVICE_INIT_BACKOFF_MIN_MILLIS     100  // Pause of the init reads when the bus is busy (NACK or no TPUART answer),
+#define KNX_DEVICE_INIT_BACKOFF_MAX_MILLIS     3200 // doubled on each new failure up to the max value
+
+// Time budget of the received telegrams dispatch (com objects updates and notifications) per task() execution
+#define KNX_DEVICE_DISPATCH_BUDGET_DEFAULT_MICROS 1000
+
+// Init read in flight
+typedef struct {
+  type_com_obj_index index; // Index of the read com object
+  word startTimeMillis; // Time (in msec) of the read request
+} type_init_read;
 
 // KnxDevice internal state
 enum e_KnxDeviceState {
   INIT,
   IDLE,
   TX_ONGOING,
+  RESET_ONGOING, // TPUART reset event received, the TPUART reset is being performed by task()
 };
 
 // Action types
@@ -67,25 +100,133 @@ enum e_KnxDeviceTxActionType {
   EIB_RESPONSE_REQUEST
 };
 
+// Max width of a value carried by a TX action : value of the longest supported DPT (4 bytes, U32/V32/F32 formats)
+// NB : the DPT IDs are sorted by length, the last one is the longest
+#define ACTION_VALUE_MAX_SIZE (KnxDPTLength((e_KnxDPT_ID) (sizeof(KnxDPTIdToFormat) - 1)) - 1)
+
+// NB : the actions are copied in each queue and retry slot (33 actions), they are kept small : 8 bytes on AVR with
+// 8 bits indexes. The action type and the priority share one byte (the enums are 2 bytes on AVR).
 struct struct_tx_action{
-  e_KnxDeviceTxActionType command; // Action type to be performed
-  byte index; // Index of the involved ComObject
+  e_KnxDeviceTxActionType command : 2; // Action type to be performed
+  e_KnxPriority priority : 4; // Priority of the telegram to be sent
+  type_com_obj_index index; // Index of the involved ComObject
+  byte transaction; // Slot (+1) of the tracking transaction in the transactions pool, 0 if the action is not tracked
+  byte attemptsNb; // Nb of failed sending attempts (see setRetryPolicy())
   union { // Value
     // Field used in case of short value (value width <= 1 byte)
-    struct {
-      byte byteValue;
-      byte notUsed;
-    };
-    byte *valuePtr; // Field used in case of long value (width > 1 byte), space is allocated dynamically
+    byte byteValue;
+    // Field used in case of long value (width > 1 byte), the value is stored inline
+    // so that no dynamic allocation is needed (no leak when the queue overwrites an action)
+    byte longValue[ACTION_VALUE_MAX_SIZE];
   };
 };// type_tx_action;
 
 typedef struct struct_tx_action type_tx_action;
 
+// Writes done by the interrupt routines (see writeFromIsr())
+#define KNX_DEVICE_ISR_WRITES_NB 8 // Nb of writes waiting for task() (power of 2)
+
+// Write done by an interrupt routine, waiting for task()
+typedef struct {
+  type_com_obj_index index;          // Index of the com object
+  byte value[ACTION_VALUE_MAX_SIZE]; // Short value (value[0]), or DPT value of a long object
+} type_isr_write;
+
+// Tracked writes and updates (see writeTracked()) : the transactions are pooled in fixed storage
+#define KNX_DEVICE_TX_TRANSACTIONS_NB 4 // Nb of transactions tracked at the same time (8 max)
+#define KNX_TX_HANDLE_NONE 0            // No handle (transaction not tracked)
+
+// Handle of a transaction : slot in the pool (3 bits) and generation (5 bits, never 0)
+// A handle is not valid anymore once its completion is read (polling), or notified (handler)
+typedef byte type_knx_tx_handle;
+
+// Status of a transaction
+enum e_KnxTxStatus {
+  KNX_TX_PENDING = 0, // Action queued, or telegram being sent
+  KNX_TX_ACK,         // Telegram acknowledged on the bus
+  KNX_TX_LOCAL,       // Value updated locally, no telegram sent (com object without TRANSMIT attribute)
+  KNX_TX_NACK,        // Telegram not acknowledged (NACK)
+  KNX_TX_NO_ANSWER,   // No answer from the TPUART
+  KNX_TX_RESET,       // TPUART reset during the sending, or device stopped
+  KNX_TX_SUPERSEDED,  // Write merged into a newer write (write coalescing), its value has not been sent
+  KNX_TX_DROPPED,     // Action dropped by its full TX queue (overwritten by a newer action)
+  KNX_TX_UNKNOWN      // Unknown handle (never allocated, or completion already read)
+};
+
+// Completion handler of a transaction : handle, com object index, status, and latency (in usec) from the
+// writeTracked()/updateTracked() call to the completion
+typedef void (*type_knx_tx_handler)(type_knx_tx_handle handle, type_com_obj_index objectIndex, e_KnxTxStatus status,
+                                    unsigned long latencyMicros);
+
+// Transaction of the pool
+typedef struct {
+  type_knx_tx_handle handle;  // Handle (KNX_TX_HANDLE_NONE : free slot)
+  e_KnxTxStatus status;       // Status
+  type_com_obj_index index;   // Index of the com object
+  type_knx_tx_handler handler;// Completion handler (NULL : completion polled with getTxStatus())
+  unsigned long timeMicros;   // Start time while pending, then latency
+} type_tx_transaction;
+
+
+// Retries of the failed writes (NACK, no TPUART answer, TPUART reset)
+#define KNX_DEVICE_RETRIES_NB                       4    // Nb of failed writes waiting for their retry at the same time
+#define KNX_DEVICE_RETRY_DEFAULT_ATTEMPTS_NB        1    // Default max nb of sending attempts (1 : no retry)
+#define KNX_DEVICE_RETRY_DEFAULT_BACKOFF_MILLIS     100  // Default delay before the 1st retry,
+#define KNX_DEVICE_RETRY_DEFAULT_MAX_BACKOFF_MILLIS 3200 // doubled on each new failure up to the max value
+
+// Failed write waiting for its retry
+typedef struct {
+  type_tx_action action; // Action to be queued again (attemptsNb = 0 : free slot)
+  word startTimeMillis;  // Time (in msec) of the failure
+  word delayMillis;      // Delay (in msec) before the retry, jitter included
+} type_tx_retry;
+
+
+// Rate limits of the sent telegrams (see setTxRateLimit() and setGroupRateLimit())
+#define KNX_DEVICE_TX_GROUP_LIMITS_NB 4 // Nb of group addresses with their own rate limit
+
+// Rate limit of the telegrams sent to a group address
+typedef struct {
+  word addr;             // Group address
+  KnxTokenBucket bucket; // Token bucket of the group address
+} type_tx_group_limit;
+
+
+// Send policy of a com object (see attachSendPolicies())
+// The configuration fields are set by the application, e.g. { TEMP, 0.5, false, 5000, 600, 3600 }
+typedef struct {
+  type_com_obj_index index;     // Index of the com object
+  float deadband;               // Change from the last sent value that triggers the sending (0 : any change)
+  boolean relativeDeadband;     // True when the deadband is a percentage of the last sent value
+  word minIntervalMillis;       // Min time between 2 sendings (0 : none)
+  word maxIntervalSec;          // Max time a change below the deadband waits before being sent (0 : not sent)
+  word heartbeatSec;            // Period of the cyclic sending, the value being changed or not (0 : no cyclic sending)
+  // Internal state, initialized by attachSendPolicies()
+  byte state;                   // KNX_SEND_POLICY_xxx flags
+  float sentValue;              // Last sent value (decoded)
+  unsigned long sentTimeMillis; // Time (in msec) of the last sending
+} type_knx_send_policy;
+
+// Send policy state flags
+#define KNX_SEND_POLICY_SENT    0x01 // A value has been sent
+#define KNX_SEND_POLICY_CHANGED 0x02 // The com object has been written since the last evaluation
+#define KNX_SEND_POLICY_DRIFTED 0x04 // The value differs from the sent one, by less than the deadband
+
 
 // Callback function to catch and treat KNX events
 // The definition shall be provided by the end-user
-extern void knxEvents(byte);
+// NB : the parameter is the index of the updated com object (a word when KNX_COM_OBJ_16BIT_INDEX flag is on)
+extern void knxEvents(type_com_obj_index);
+
+// Handler of the updates of a com object (see attachHandlers()), the parameter is the com object index
+typedef void (*type_knx_com_obj_handler)(type_com_obj_index);
+
+// Handler of the batched updates (see setBatchedEvents()) : bitset of the updated com objects (1 bit per com object)
+// and nb of updated com objects
+typedef void (*type_knx_batch_handler)(const byte changedBits[], type_com_obj_index changedNb);
+
+// Size of a com objects bitset (e.g. batched updates bitset)
+#define KNX_DEVICE_BITSET_SIZE(comObjectsNb) (((comObjectsNb) + 7) / 8)
 
 
 // --------------- Definition of the functions for DPT translation --------------------
@@ -99,22 +240,75 @@ template <typename T> e_KnxDeviceStatus ConvertToDpt(T value, byte dpt[], byte d
 
 
 class KnxDevice {
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+    static KnxPackedComObjects _comObjectsList;     // Packed table of Com Objects attached to the KNX Device
+                                                    // The definition shall be provided by the end-user
+                                                    // (with KNX_DEVICE_COM_OBJECTS(), see KnxComObjectTable.h)
+#else
     static KnxComObject _comObjectsList[];          // List of Com Objects attached to the KNX Device
                                                     // The definition shall be provided by the end-user
-    static const byte _comObjectsNb;                // Nb of attached Com Objects
+                                                    // (by hand or with KNX_DEVICE_COM_OBJECTS(), see KnxComObjectTable.h)
+#endif
+    static const type_com_obj_index _comObjectsNb;  // Nb of attached Com Objects
                                                     // The value shall be provided by the end-user
     e_KnxDeviceState _state;                        // Current KnxDevice state
     KnxTpUart *_tpuart;                             // TPUART associated to the KNX Device
-    ActionRingBuffer<type_tx_action, ACTIONS_QUEUE_SIZE> _txActionList; // Queue of transmit actions to be performed
+    ActionRingBuffer<type_tx_action, ACTIONS_QUEUE_SIZE> _txActionList; // Queue of NORMAL priority transmit actions to be performed
+    ActionRingBuffer<type_tx_action, ACTIONS_PRIO_QUEUE_SIZE> _txPrioActionLists[TX_LANE_PRIO_NB]; // Queues of higher priority transmit actions
+    SpscRingBuffer<type_isr_write, KNX_DEVICE_ISR_WRITES_NB> _isrWrites; // Writes done by the interrupt routines (producer),
+                                                    // done by task() (consumer)
+    boolean _writeCoalescing;                       // True when a pending write is updated in place by a new write on the same object
+    word _mergedWritesNb;                           // Nb of writes merged into a pending write
+    KnxSnapshot *_snapshot;                         // Snapshot of the com objects values (NULL if none)
+    byte *_longValuesArena;                         // Data space of the long values, when not attached at compile time
+                                                    // (allocated once, NULL if not needed)
     boolean _initCompleted;                         // True when all the Com Object with Init attr have been initialized
-    byte _initIndex;                                // Index to the last initiated object
-    word _lastInitTimeMillis;                       // Time (in msec) of the last init (read) request on the bus
+    byte *_initPendingBits;                         // Bitset of the com objects waiting for their init read (1 bit per object)
+    type_com_obj_index _initPendingNb;              // Nb of bits set in _initPendingBits
+    type_com_obj_index _initCursor;                 // Index of the com object where the search of the next init read starts
+    type_init_read _initReads[KNX_DEVICE_INIT_READS_MAX_NB]; // Init reads in flight
+    byte _initReadsNb;                              // Nb of init reads in flight
+    byte _initReadsMaxNb;                           // Max nb of init reads in flight
+    word _initReadTimeoutMillis;                    // Time waited for the response to an init read
+    word _initBackoffMillis;                        // Current pause of the init reads (0 when the bus is not busy)
+    word _initBackoffStartMillis;                   // Time (in msec) of the pause start
+    unsigned long _beginTimeMillis;                 // Time (in msec) of the begin() execution
+    unsigned long _initDurationMillis;              // Time (in msec) taken from begin() to the validity of all the com objects
+    type_knx_com_obj_handler *_handlers;            // Handlers of the com objects updates (one per com object, NULL if none)
+    byte *_changedBits;                             // Bitset of the com objects updated since the last batch (NULL : no batch)
+    type_com_obj_index _changedNb;                  // Nb of bits set in _changedBits
+    type_knx_batch_handler _batchHandler;           // Handler of the batched updates
+    word _dispatchBudgetMicros;                     // Time budget of the received telegrams dispatch per task() execution
+    word _deferredDispatchesNb;                     // Nb of task() executions ending the dispatch with telegrams still queued
+    unsigned long _maxHandlerMicros;                // Longest execution of an update handler (knxEvents() included)
+    unsigned long _handlersMicros;                  // Total execution time of the update handlers
+    type_tx_transaction _txTransactions[KNX_DEVICE_TX_TRANSACTIONS_NB]; // Pool of the tracked transactions
+    byte _txHandleGeneration;                       // Generation of the last allocated handle
+    byte _newActionTransaction;                     // Transaction of the action being built by write()/update()
+    type_tx_action _sentAction;                     // Action of the telegram being sent (retried in case of failure)
+    type_tx_retry _retries[KNX_DEVICE_RETRIES_NB];  // Failed writes waiting for their retry
+    byte _retryAttemptsNb;                          // Max nb of sending attempts of a write
+    word _retryBackoffMillis;                       // Delay before the 1st retry
+    word _retryMaxBackoffMillis;                    // Max delay before a retry
+    word _retryJitterSeed;                          // State of the pseudo random generator of the retries jitter
+    word _retriesNb;                                // Nb of retried writes
+    word _giveUpsNb;                                // Nb of failed writes not retried anymore (attempts exhausted or no free slot)
+    word _resetAnswerTimeoutMillis;                 // TPUART reset policy (see setResetPolicy()), kept through
+    word _resetBackoffMillis;                       // the TPUART deletions and creations by end() and begin()
+    byte _resetAttemptsNb;
+    KnxTokenBucket _txBucket;                       // Rate limit of the sent telegrams (device wide)
+    type_tx_group_limit _txGroupLimits[KNX_DEVICE_TX_GROUP_LIMITS_NB]; // Rate limits of the telegrams sent to group addresses
+    byte _txGroupLimitsNb;                          // Nb of group addresses with a rate limit
+    type_knx_send_policy *_sendPolicies;            // Send policies of com objects (NULL if none)
+    byte _sendPoliciesNb;                           // Nb of send policies
+    word _policyWritesNb;                           // Nb of writes absorbed by the send policies
+    word _policySendsNb;                            // Nb of telegrams sent by the send policies
     word _lastRXTimeMicros;                         // Time (in msec) of the last Tpuart Rx activity;
     word _lastTXTimeMicros;                         // Time (in msec) of the last Tpuart Tx activity;
     KnxTelegram _txTelegram;                        // Telegram object used for telegrams sending
-    KnxTelegram *_rxTelegram;                       // Reference to the telegram received by the TPUART
+    KnxTelegram *_rxTelegram;                       // Received telegram being processed (in the TPUART RX queue)
 #if defined(KNXDEVICE_DEBUG_INFO)
-    byte _nbOfInits;                                // Nb of Initialized Com Objects
+    type_com_obj_index _nbOfInits;                  // Nb of Initialized Com Objects
     String *_debugStrPtr;
     static const char _debugInfoText[];
 #endif
@@ -133,22 +327,32 @@ class KnxDevice {
     e_KnxDeviceStatus begin(HardwareSerial& serial, word physicalAddr);
 
     // Stop the KNX Device
+    // The "InitRead" objects get invalid : their value is read on the bus again by the next begin()
+    // NB : begin() called again without end() restarts the device (end() is executed first)
     void end();
 
     // KNX device execution task
     // This function shall be called in the "loop()" Arduino function
     void task(void);
 
+#if defined(KNXTPUART_RX_INTERRUPT)
+    // UART RX interrupt hook (RX INTERRUPT mode, see KnxTpUart::RXInterrupt())
+    // This function shall be called for each byte received from the TPUART, by the interrupt routine reading
+    // the serial port (see KnxDevice_RxInterrupt example). The interrupt routine shall be started before begin()
+    // (the TPUART reset indication is received through it). The bytes received out of begin()/end() are ignored.
+    void rxInterrupt(byte data);
+#endif
+
     // Quick method to read a short (<=1 byte) com object
     // NB : The returned value will be hazardous in case of use with long objects
-    byte read(byte objectIndex);  
+    byte read(type_com_obj_index objectIndex);  
 
     // Read an usual format com object
     // Supported DPT formats are short com object, U16, V16, U32, V32, F16 and F32
-    template <typename T>  e_KnxDeviceStatus read(byte objectIndex, T& returnedValue);
+    template <typename T>  e_KnxDeviceStatus read(type_com_obj_index objectIndex, T& returnedValue);
 
     // Read any type of com object (DPT value provided as is)
-    e_KnxDeviceStatus read(byte objectIndex, byte returnedValue[]);
+    e_KnxDeviceStatus read(type_com_obj_index objectIndex, byte returnedValue[]);
 
     // Update com object functions :
     // For all the update functions, the com object value is updated locally
@@ -156,20 +360,204 @@ class KnxDevice {
 
     // Update an usual format com object
     // Supported DPT types are short com object, U16, V16, U32, V32, F16 and F32
-    template <typename T>  e_KnxDeviceStatus write(byte objectIndex, T value);
+    template <typename T>  e_KnxDeviceStatus write(type_com_obj_index objectIndex, T value);
+
+    // Same as above, but the telegram is sent with the given priority instead of the com object one
+    template <typename T>  e_KnxDeviceStatus write(type_com_obj_index objectIndex, T value, e_KnxPriority priority);
 
     // Update any type of com object (rough DPT value shall be provided)
-    e_KnxDeviceStatus write(byte objectIndex, byte valuePtr[]);
+    e_KnxDeviceStatus write(type_com_obj_index objectIndex, byte valuePtr[]);
+
+    // Same as above, but the telegram is sent with the given priority instead of the com object one
+    e_KnxDeviceStatus write(type_com_obj_index objectIndex, byte valuePtr[], e_KnxPriority priority);
+
+    // Update a com object from an interrupt routine (or from another thread on a host) : the write is queued without
+    // lock (KNX_DEVICE_ISR_WRITES_NB writes max), and done by task() like a write() call. The value is the short
+    // value (objects up to 1 byte), or the rough DPT value (long objects, see above).
+    // The queued writes are done as long as their TX queue has room : when the bus is slower than the interrupts,
+    // the writes are refused instead of dropping the oldest TX actions.
+    // Return KNX_DEVICE_ERROR when the write queue is full or the com object is unknown (nothing written),
+    // else KNX_DEVICE_OK
+    // NB : a single interrupt routine (or thread) shall call these functions
+    e_KnxDeviceStatus writeFromIsr(type_com_obj_index objectIndex, byte value);
+    e_KnxDeviceStatus writeFromIsr(type_com_obj_index objectIndex, const byte valuePtr[]);
     
 
     // Com Object EIB Bus Update request
     // Request the local object to be updated with the value from the bus
     // NB : the function is asynchroneous, the update completion is notified by the knxEvents() callback
-    void update(byte objectIndex);
+    void update(type_com_obj_index objectIndex);
+
+    // Same as above, but the read request is sent with the given priority instead of the com object one
+    void update(type_com_obj_index objectIndex, e_KnxPriority priority);
+
+    // Tracked write/update : same as write()/update(), and return the handle of a transaction tracking
+    // the telegram sending. The completion is polled with getTxStatus(), or notified to the handler
+    // (called by task(), out of the TPUART callbacks). The transactions are pooled (KNX_DEVICE_TX_TRANSACTIONS_NB) :
+    // when the pool is full, a polled transaction already completed but not read yet is dropped (its handle gets
+    // KNX_TX_UNKNOWN), else the write/update is done without tracking and KNX_TX_HANDLE_NONE is returned.
+    // KNX_TX_HANDLE_NONE is also returned when the write fails (value translation error).
+    // NB : an update completes when its read request is sent (the response is notified by knxEvents())
+    template <typename T> type_knx_tx_handle writeTracked(type_com_obj_index objectIndex, T value,
+                                                          type_knx_tx_handler handler = NULL);
+    type_knx_tx_handle writeTracked(type_com_obj_index objectIndex, byte valuePtr[], type_knx_tx_handler handler = NULL);
+    type_knx_tx_handle updateTracked(type_com_obj_index objectIndex, type_knx_tx_handler handler = NULL);
+
+    // Get the status of a tracked transaction (polling)
+    // Once the transaction is completed (status other than KNX_TX_PENDING), the latency (in usec) is given
+    // when latencyMicros is not NULL, and the handle is released (KNX_TX_UNKNOWN is returned afterwards)
+    e_KnxTxStatus getTxStatus(type_knx_tx_handle handle, unsigned long *latencyMicros = NULL);
+
+    // Set the policy of the retries of the failed writes (NACK, no TPUART answer, TPUART reset)
+    // A failed write is sent again, up to attemptsNb attempts in all (1 : no retry, the default).
+    // The delay before a retry is backoffMillis doubled on each new failure up to maxBackoffMillis, with jitter
+    // (a random half of the delay) so that devices failing together do not retry together.
+    // The transaction of a tracked write remains pending during the retries.
+    // A retry is cancelled (transaction completed as KNX_TX_SUPERSEDED) when the com object is written again,
+    // by the application or by the bus.
+    // NB : KNX_DEVICE_RETRIES_NB failed writes wait for their retry at the same time, a write failing
+    // when all the slots are used is not retried
+    void setRetryPolicy(byte attemptsNb, word backoffMillis, word maxBackoffMillis);
+
+    // Return the nb of retried writes since the device start
+    word getRetriesNb(void) const;
+
+    // Return the nb of failed writes not retried anymore (attempts exhausted or no free slot) since the device start
+    word getGiveUpsNb(void) const;
+
+    // Limit the rate of the sent telegrams (token bucket) : one telegram every periodMillis on the long term,
+    // and up to burst telegrams in a row after a quiet time. A 0 period removes the limit (the default).
+    // A TX action held by the limit stays queued, with write coalescing enabled a newer write on the same
+    // com object is merged into it so that the latest value is sent.
+    // NB : a TP line carries about 50 telegrams per second
+    void setTxRateLimit(word periodMillis, byte burst);
+
+    // Same as above, for the telegrams sent to a given group address (on top of the device wide limit)
+    // The actions held by the limit of their group address do not delay the other actions.
+    // A 0 period removes the limit of the group address.
+    // Return KNX_DEVICE_ERROR when KNX_DEVICE_TX_GROUP_LIMITS_NB group addresses are already limited, else KNX_DEVICE_OK
+    e_KnxDeviceStatus setGroupRateLimit(word groupAddr, word periodMillis, byte burst);
+
+    // Return the nb of telegrams seen on the bus since begin() (addressed or not, the device telegrams included)
+    unsigned long getBusTelegramsNb(void) const;
+
+    // Return the nb of telegrams sent by the device seen on the bus since begin()
+    unsigned long getOwnTelegramsNb(void) const;
+
+    // Return the share (in %) of the bus telegrams sent by the device since begin()
+    // NB : a share over a given time window is computed from the differences of the 2 counters above
+    byte getBusShare(void) const;
+
+    // Attach a table of send policies (no heap use : the table is provided by the application)
+    // A write on a com object having a send policy updates the com object value at once, and task() sends
+    // the value when :
+    // - it is the first written value,
+    // - or it differs from the last sent value by the deadband (absolute, or relative in %) or more,
+    // - or it differs from the last sent value by less than the deadband since maxIntervalSec,
+    // - or the last sending is heartbeatSec old (cyclic sending),
+    // and in any case the last sending is minIntervalMillis old at least (the latest value is then evaluated).
+    // The values are compared decoded : short values, U16, V16, F16, U32 and V32 formats are supported.
+    // A tracked write (writeTracked()) is sent at once, and the policy restarts from its value. The same goes for a
+    // write done while a tracked write of the com object is queued (the tracked value is sent as is).
+    // Return KNX_DEVICE_ERROR when a com object index is out of range or its format is not supported (table not
+    // attached), else KNX_DEVICE_OK. A NULL table detaches the policies.
+    e_KnxDeviceStatus attachSendPolicies(type_knx_send_policy policies[], byte policiesNb);
+
+    // Return the nb of writes absorbed by the send policies, and the nb of telegrams sent by the send policies
+    // since the device start
+    word getPolicyWritesNb(void) const;
+    word getPolicySendsNb(void) const;
 
     // The function returns true if there is rx/tx activity ongoing, else false
     boolean isActive(void) const;
 
+    // Return true while the TPUART is being reset following a TPUART reset event (bus power failure...)
+    // NB : the reset is performed by task() calls, the TX actions remain queued till the reset completion
+    boolean isResetOngoing(void) const;
+
+    // Return the duration (in msec) of the last TPUART reset, from the reset event to the reset completion
+    // (retries included, see KnxTpUart::GetLastResetDuration())
+    unsigned long getLastResetDuration(void) const;
+
+    // Set the policy of the TPUART resets performed after begin() (see KnxTpUart::SetResetPolicy())
+    // The policy may be set before begin(), it is kept by the next end() and begin() calls
+    // NB : a failed reset is started again by task(), so that the device recovers whenever the TPUART answers
+    void setResetPolicy(word answerTimeoutMillisec, word backoffMillisec, byte attemptsNb);
+
+    // Set the policy of the init reads (com objects having Init Read attribute)
+    // The next read is started as soon as the response to a previous one is received, within the limit of
+    // readsNb reads in flight (1 to KNX_DEVICE_INIT_READS_MAX_NB). A read not answered within timeoutMillis
+    // after its sending (the time spent in the TX queues is not counted) is retried later. The init reads are
+    // paused when the bus is busy.
+    void setInitReadPolicy(byte readsNb, word timeoutMillis);
+
+    // Return the time (in msec) taken from begin() to the validity of all the com objects, 0 while not completed
+    unsigned long getInitDuration(void) const;
+
+    // Attach a snapshot of the com objects values (fast warm restart)
+    // The values saved in the snapshot storage are restored immediately : the restored "InitRead" objects
+    // are valid and skip their init read. The changed values are then saved periodically by task().
+    // The function shall be called before begin()
+    // Return the nb of restored com objects
+    type_com_obj_index attachSnapshot(KnxSnapshot& snapshot);
+
+    // Enable/disable the coalescing of the writes (disabled by default)
+    // When enabled, a write on a com object having a write still pending in the TX queues
+    // updates the pending write value in place (latest value wins) instead of queuing a new write.
+    // The pending write keeps its queue position and its priority.
+    void setWriteCoalescing(boolean enable);
+
+    // Return the nb of writes merged into a pending write since the device start
+    word getMergedWritesNb(void) const;
+
+    // Return the RAM used by the com objects (list and long values data space)
+    // NB : the long values of a list declared with KNX_DEVICE_COM_OBJECTS() are in an arena sized at compile time
+    // (no heap use), otherwise they are attached to a single block allocated by begin() or attachSnapshot()
+    // With KNX_COM_OBJ_PACKED_TABLE flag on, the RAM used by the packed table is returned
+    unsigned long getComObjectsRamSize(void) const;
+
+    // Return the nb of received telegrams lost because the TPUART RX queue was full
+    // (see TPUART_RX_QUEUE_SIZE in KnxTpUart.h)
+    word getRxOverflowsNb(void) const;
+
+    // Set the time budget (in usec) of the received telegrams dispatch per task() execution
+    // (KNX_DEVICE_DISPATCH_BUDGET_DEFAULT_MICROS by default)
+    // The received telegrams are dispatched at the end of task() (com objects updates and notifications) :
+    // at least one telegram is dispatched per task() execution, the next ones as long as the budget is not spent.
+    // The remaining telegrams wait in the TPUART RX queue for the next task() execution.
+    void setDispatchBudget(word budgetMicros);
+
+    // Return the nb of task() executions ending the dispatch with telegrams still queued (budget spent)
+    word getDeferredDispatchesNb(void) const;
+
+    // Return the longest execution time (in usec) of an update handler (knxEvents(), com object handler or
+    // batched updates handler)
+    unsigned long getMaxHandlerDuration(void) const;
+
+    // Return the total execution time (in usec) of the update handlers since the device start
+    unsigned long getHandlersDuration(void) const;
+
+    // Attach a table of handlers, one per com object (no heap use : the table is provided by the application)
+    // The handler of a com object is called in place of knxEvents() when the com object is updated by the bus,
+    // knxEvents() is still called for the com objects without handler (NULL entry)
+    // NB : the table has _comObjectsNb entries, it may be initialized statically or with setHandler()
+    void attachHandlers(type_knx_com_obj_handler handlers[]);
+
+    // Set the handler of a com object in the attached handlers table (NULL : knxEvents() is called)
+    // Return KNX_DEVICE_ERROR when no table is attached or when the index is out of range, else KNX_DEVICE_OK
+    e_KnxDeviceStatus setHandler(type_com_obj_index objectIndex, type_knx_com_obj_handler handler);
+
+    // Enable the batched updates notification (disabled by default, NULL bitset to disable)
+    // The updates done by the bus are not notified one by one anymore : the bits of the updated com objects
+    // are set in the changedBits bitset (KNX_DEVICE_BITSET_SIZE(_comObjectsNb) bytes, provided by the application),
+    // and the handler is called once per task() execution when at least one com object has been updated.
+    // A com object updated several times during the same task() execution is notified once.
+    // The bitset is cleared when the handler returns (unless the handler calls setBatchedEvents()).
+    void setBatchedEvents(byte changedBits[], type_knx_batch_handler handler);
+
+    // Return true when the bit of a com object is set in a bitset (e.g. in the batched updates handler)
+    static boolean isComObjectSet(const byte bits[], type_com_obj_index objectIndex);
+
     // Inline Debug function (definition later in this file)
     // Set the string used for debug traces
 #if defined(KNXDEVICE_DEBUG_INFO)
@@ -177,6 +565,105 @@ class KnxDevice {
 #endif
 
   private:
+  // Private INLINED functions (see definitions later in this file)
+    // Set the TPUART pointer, atomically in RX INTERRUPT mode (the pointer is used by the RX interrupt hook)
+    void SetTpUart(KnxTpUart *tpuart);
+
+    // Build the telegram of a TX action from the com object pre-encoded header, and start its sending
+    void SendComObjectTelegram(const type_tx_action& action, e_KnxCommand command);
+
+    // Attach the long values without data space to a single block allocated once
+    // Return KNX_DEVICE_ERROR in case of memory allocation failure, else KNX_DEVICE_OK
+    e_KnxDeviceStatus AttachLongValues(void);
+
+    // Add a TX action in the queue matching its priority
+    void AppendTxAction(const type_tx_action& action);
+
+    // Find the action of a given command (e.g. WRITE) pending for a given com object in the TX queues
+    // Return NULL if there is no such pending action for this object
+    type_tx_action* FindPendingAction(type_com_obj_index objectIndex, e_KnxDeviceTxActionType command);
+
+    // Queue a WRITE action, or merge it into the pending one in case of write coalescing
+    void AppendWriteAction(const type_tx_action& action);
+
+    // Pop the next TX action to be performed, from the highest priority non-empty queue
+    // Return TRUE when an action is available, otherwise FALSE
+    boolean PopTxAction(type_tx_action& action);
+
+    // Same as above, for the next TX action allowed by the rate limits
+    boolean PopAllowedTxAction(type_tx_action& action);
+
+    // Apply the send policy of the com object of a WRITE action
+    // Return TRUE when the action is absorbed by the policy (not to be queued)
+    boolean ApplySendPolicy(const type_tx_action& action);
+
+    // Queue the values of the com objects having a send policy, when the policy requires it
+    void SendPoliciesTask(void);
+
+    // Decode the DPT value of a com object
+    // Return KNX_DEVICE_OK, or the ConvertFromDpt() error when the format is not supported
+    e_KnxDeviceStatus DecodeValue(type_com_obj_index objectIndex, const byte dptValue[], float& value);
+
+    // Take the tokens needed to send the telegram of an action (device and group address limits)
+    // Return FALSE when the action is held by a rate limit (no token taken)
+    boolean TakeTxTokens(const type_tx_action& action, boolean deviceTokenAvailable, unsigned long nowTimeMillis);
+
+    // Return the nb of TX actions waiting in all the queues
+    byte TxActionsNb(void) const;
+
+    // Return TRUE when the TX queue of a priority is full
+    boolean TxQueueFull(e_KnxPriority priority) const;
+
+    // Do the writes queued by the interrupt routines, as long as their TX queue has room
+    void IsrWritesTask(void);
+
+    // Init reads scheduling : release the answered or timed out reads, and start the new ones
+    void InitTask(void);
+
+    // Process the telegrams waiting in the TPUART RX queue
+    void RxTask(void);
+
+    // Notify the update of a com object by the bus : batched updates bitset, com object handler or knxEvents()
+    void NotifyUpdate(type_com_obj_index objectIndex);
+
+    // Record the execution time of an update handler started at startTimeMicros
+    void RecordHandlerDuration(unsigned long startTimeMicros);
+
+    // Allocate a transaction in the pool for a com object, the next action built by write()/update() is tracked
+    // Return the handle, KNX_TX_HANDLE_NONE if the pool is full
+    type_knx_tx_handle NewTransaction(type_com_obj_index objectIndex, type_knx_tx_handler handler);
+
+    // End the tracking of the actions built by write()/update(), the transaction is released when not used
+    type_knx_tx_handle EndNewTransaction(type_knx_tx_handle handle, boolean used);
+
+    // Complete the transaction of a pool slot (+1) with a given status
+    void CompleteTransaction(byte transaction, e_KnxTxStatus status);
+
+    // Call the handlers of the completed transactions, and release them
+    void TransactionsTask(void);
+
+    // Schedule the retry of a failed action
+    // Return FALSE when the action is not retried
+    boolean ScheduleRetry(const type_tx_action& action);
+
+    // Queue again the failed actions whose retry delay is elapsed
+    void RetryTask(void);
+
+    // Cancel the retries of a given com object (waiting for their backoff or queued again), return TRUE when a
+    // retry is cancelled
+    boolean SupersedeRetry(type_com_obj_index objectIndex);
+
+    // Call the batched updates handler when com objects have been updated, and clear the bitset
+    void BatchTask(void);
+
+    // Find the next com object waiting for its init read, from the cursor position
+    // Return FALSE when no com object is waiting
+    boolean NextInitPending(type_com_obj_index& index);
+
+    // Set/clear the bit of a com object in the init reads bitset
+    void SetInitPending(type_com_obj_index index);
+    void ClearInitPending(type_com_obj_index index);
+
     // Static GetTpUartEvents() function called by the KnxTpUart layer (callback)
     static void GetTpUartEvents(e_KnxTpUartEvent event);
 
@@ -189,6 +676,152 @@ class KnxDevice {
 #endif
 };
 
+// Update an usual format com object, the telegram is sent with the com object priority
+template <typename T> inline e_KnxDeviceStatus KnxDevice::write(type_com_obj_index objectIndex, T value)
+{ return write(objectIndex, value, _comObjectsList[objectIndex].GetPriority()); }
+
+// Update any type of com object, the telegram is sent with the com object priority
+inline e_KnxDeviceStatus KnxDevice::write(type_com_obj_index objectIndex, byte valuePtr[])
+{ return write(objectIndex, valuePtr, _comObjectsList[objectIndex].GetPriority()); }
+
+// Enable/disable the coalescing of the writes
+inline void KnxDevice::setWriteCoalescing(boolean enable) { _writeCoalescing = enable; }
+
+// Return the nb of writes merged into a pending write since the device start
+inline word KnxDevice::getMergedWritesNb(void) const { return _mergedWritesNb; }
+
+// Return the RAM used by the com objects
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+inline unsigned long KnxDevice::getComObjectsRamSize(void) const { return _comObjectsList.GetRamSize(); }
+#else
+inline unsigned long KnxDevice::getComObjectsRamSize(void) const
+{ return (_comObjectsNb * sizeof(KnxComObject)) + KnxComObject::GetLongValuesSize(_comObjectsList, _comObjectsNb); }
+#endif
+
+#if defined(KNXTPUART_RX_INTERRUPT)
+// Give a byte received by the serial RX interrupt to the TPUART
+// The RX interrupt is not nested in the main context : the TPUART is not deleted meanwhile (see SetTpUart())
+inline void KnxDevice::rxInterrupt(byte data) { if (_tpuart) _tpuart->RXInterrupt(data); }
+#endif
+
+inline void KnxDevice::SetTpUart(KnxTpUart *tpuart)
+{
+#if defined(KNXTPUART_RX_INTERRUPT)
+  noInterrupts();
+  _tpuart = tpuart;
+  interrupts();
+#else
+  _tpuart = tpuart;
+#endif
+}
+
+// Return the nb of received telegrams lost because the TPUART RX queue was full
+inline word KnxDevice::getRxOverflowsNb(void) const { return (_tpuart ? _tpuart->GetRxOverflowsNb() : 0); }
+
+// Attach a table of handlers, one per com object
+inline void KnxDevice::attachHandlers(type_knx_com_obj_handler handlers[]) { _handlers = handlers; }
+
+// Set the handler of a com object in the attached handlers table
+inline e_KnxDeviceStatus KnxDevice::setHandler(type_com_obj_index objectIndex, type_knx_com_obj_handler handler)
+{
+  if (!_handlers || (objectIndex >= _comObjectsNb)) return KNX_DEVICE_ERROR;
+  _handlers[objectIndex] = handler;
+  return KNX_DEVICE_OK;
+}
+
+// Return true when the bit of a com object is set in a bitset
+inline boolean KnxDevice::isComObjectSet(const byte bits[], type_com_obj_index objectIndex)
+{ return (bits[objectIndex >> 3] >> (objectIndex & 7)) & 1; }
+
+// Tracked write of an usual format com object
+template <typename T> inline type_knx_tx_handle KnxDevice::writeTracked(type_com_obj_index objectIndex, T value,
+                                                                        type_knx_tx_handler handler)
+{
+  type_knx_tx_handle handle = NewTransaction(objectIndex, handler);
+  return EndNewTransaction(handle, write(objectIndex, value) == KNX_DEVICE_OK);
+}
+
+// Tracked write of any type of com object
+inline type_knx_tx_handle KnxDevice::writeTracked(type_com_obj_index objectIndex, byte valuePtr[], type_knx_tx_handler handler)
+{
+  type_knx_tx_handle handle = NewTransaction(objectIndex, handler);
+  return EndNewTransaction(handle, write(objectIndex, valuePtr) == KNX_DEVICE_OK);
+}
+
+// Tracked update request
+inline type_knx_tx_handle KnxDevice::updateTracked(type_com_obj_index objectIndex, type_knx_tx_handler handler)
+{
+  type_knx_tx_handle handle = NewTransaction(objectIndex, handler);
+  update(objectIndex);
+  return EndNewTransaction(handle, true);
+}
+
+// Set the time budget of the received telegrams dispatch per task() execution
+inline void KnxDevice::setDispatchBudget(word budgetMicros) { _dispatchBudgetMicros = budgetMicros; }
+
+// Return the nb of task() executions ending the dispatch with telegrams still queued
+inline word KnxDevice::getDeferredDispatchesNb(void) const { return _deferredDispatchesNb; }
+
+// Return the longest execution time of an update handler
+inline unsigned long KnxDevice::getMaxHandlerDuration(void) const { return _maxHandlerMicros; }
+
+// Return the total execution time of the update handlers
+inline unsigned long KnxDevice::getHandlersDuration(void) const { return _handlersMicros; }
+
+// Return the nb of retried writes
+inline word KnxDevice::getRetriesNb(void) const { return _retriesNb; }
+
+// Return the nb of failed writes not retried anymore
+inline word KnxDevice::getGiveUpsNb(void) const { return _giveUpsNb; }
+
+// Limit the rate of the sent telegrams
+inline void KnxDevice::setTxRateLimit(word periodMillis, byte burst) { _txBucket.SetRate(periodMillis, burst, millis()); }
+
+// Return the nb of telegrams seen on the bus
+inline unsigned long KnxDevice::getBusTelegramsNb(void) const { return (_tpuart ? _tpuart->GetBusTelegramsNb() : 0); }
+
+// Return the nb of telegrams sent by the device seen on the bus
+inline unsigned long KnxDevice::getOwnTelegramsNb(void) const { return (_tpuart ? _tpuart->GetOwnTelegramsNb() : 0); }
+
+// Return the share of the bus telegrams sent by the device
+inline byte KnxDevice::getBusShare(void) const
+{ return (getBusTelegramsNb() ? (byte)((getOwnTelegramsNb() * 100) / getBusTelegramsNb()) : 0); }
+
+// Return the nb of writes absorbed by the send policies
+inline word KnxDevice::getPolicyWritesNb(void) const { return _policyWritesNb; }
+
+// Return the nb of telegrams sent by the send policies
+inline word KnxDevice::getPolicySendsNb(void) const { return _policySendsNb; }
+
+// Set the policy of the init reads
+inline void KnxDevice::setInitReadPolicy(byte readsNb, word timeoutMillis)
+{
+  if (readsNb < 1) readsNb = 1;
+  if (readsNb > KNX_DEVICE_INIT_READS_MAX_NB) readsNb = KNX_DEVICE_INIT_READS_MAX_NB;
+  _initReadsMaxNb = readsNb; _initReadTimeoutMillis = timeoutMillis;
+}
+
+// Return the time taken from begin() to the validity of all the com objects
+inline unsigned long KnxDevice::getInitDuration(void) const { return _initDurationMillis; }
+
+// Return true while the TPUART is being reset
+inline boolean KnxDevice::isResetOngoing(void) const { return (_state == RESET_ONGOING); }
+
+// Return the duration of the last TPUART reset
+inline unsigned long KnxDevice::getLastResetDuration(void) const { return _tpuart ? _tpuart->GetLastResetDuration() : 0; }
+
+// Set the policy of the TPUART resets performed after begin(), forwarded to the TPUART when it exists
+inline void KnxDevice::setResetPolicy(word answerTimeoutMillisec, word backoffMillisec, byte attemptsNb)
+{
+  _resetAnswerTimeoutMillis = answerTimeoutMillisec; _resetBackoffMillis = backoffMillisec; _resetAttemptsNb = attemptsNb;
+  if (_tpuart) _tpuart->SetResetPolicy(answerTimeoutMillisec, backoffMillisec, attemptsNb);
+}
+
+// Com Object EIB Bus Update request, the read request is sent with the com object priority
+inline void KnxDevice::update(type_com_obj_index objectIndex)
+{ update(objectIndex, _comObjectsList[objectIndex].GetPriority()); }
+
+
 #if defined(KNXDEVICE_DEBUG_INFO)
 // Set the string used for debug traces
 inline void KnxDevice::SetDebugString(String *strPtr) {_debugStrPtr = strPtr;}
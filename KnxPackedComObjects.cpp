@@ -0,0 +1,87 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxPackedComObjects.cpp
+// Author : Franck Marini
+// Description : Com objects table in "structure of arrays" layout (attributes in flash, packed values in RAM)
+// Module dependencies : KnxTelegram, KnxComObject
+
+#include "KnxPackedComObjects.h"
+
+// Get the com obj value (short and long value cases)
+void KnxPackedComObject::GetValue(byte dest[]) const
+{
+byte length = GetLength();
+  if (length <= 2) dest[0] = GetValue(); // short value case
+  else for (byte i = 0; i < length - 1; i++) dest[i] = _table._values[GetValuePos() + i]; // long value case
+}
+
+
+// Update the com obj value (short and long value cases)
+byte KnxPackedComObject::UpdateValue(const byte ori[])
+{
+byte length = GetLength();
+  if (length <= 2) return UpdateValue(ori[0]); // short value case
+  // long value case
+  byte *value = _table._values + GetValuePos();
+  for (byte i = 0; i < length - 1; i++) value[i] = ori[i];
+  SetBit(_table._validityBits, _index, true);
+  return KNX_COM_OBJECT_OK;
+}
+
+
+// Update the com obj value with the telegram payload content
+byte KnxPackedComObject::UpdateValue(const KnxTelegram& ori)
+{
+byte length = GetLength();
+byte value;
+  if (ori.GetPayloadLength() != length) return KNX_COM_OBJECT_ERROR; // Error : telegram payload length differs from com obj one
+  if (length == 1) UpdateValue(ori.GetFirstPayloadByte());
+  else if (length == 2) { ori.GetLongPayload(&value, 1); UpdateValue(value); }
+  else
+  {
+    ori.GetLongPayload(_table._values + GetValuePos(), length - 1);
+    SetBit(_table._validityBits, _index, true);
+  }
+  return KNX_COM_OBJECT_OK;
+}
+
+
+// Build a whole telegram
+// The header is encoded from the flash attributes (same encoding as the KnxComObject pre-encoded header)
+void KnxPackedComObject::CopyToTelegram(KnxTelegram& dest, e_KnxCommand command) const
+{
+byte header[KNX_TELEGRAM_HEADER_SIZE];
+byte length = GetLength();
+word addr = GetAddr();
+byte value;
+
+  header[0] = (CONTROL_FIELD_DEFAULT_VALUE & ~CONTROL_FIELD_PRIORITY_MASK) | GetPriority();
+  header[1] = (byte)(_table._sourceAddr >> 8); header[2] = (byte) _table._sourceAddr;
+  header[3] = (byte)(addr >> 8); header[4] = (byte) addr;
+  header[5] = (ROUTING_FIELD_DEFAULT_VALUE & ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK) | length;
+  byte headerXorSum = header[0] ^ header[1] ^ header[2] ^ header[3] ^ header[4] ^ header[5];
+
+  if (command == KNX_COMMAND_VALUE_READ) dest.BuildFromHeader(header, headerXorSum, command, 0, NULL);
+  else if (length == 1) dest.BuildFromHeader(header, headerXorSum, command, GetValue(), NULL);
+  else if (length == 2) { value = GetValue(); dest.BuildFromHeader(header, headerXorSum, command, 0, &value); }
+  else dest.BuildFromHeader(header, headerXorSum, command, 0, _table._values + GetValuePos());
+}
+
+//EOF
@@ -0,0 +1,257 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxPackedComObjects.h
+// Author : Franck Marini
+// Description : Com objects table in "structure of arrays" layout (attributes in flash, packed values in RAM)
+// Module dependencies : KnxTelegram, KnxComObject
+
+#ifndef KNXPACKEDCOMOBJECTS_H
+#define KNXPACKEDCOMOBJECTS_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+#include "KnxComObject.h"
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// By default, the KnxDevice com objects list is an array of KnxComObject (defined by hand or with KNX_DEVICE_COM_OBJECTS())
+// turn KNX_COM_OBJ_PACKED_TABLE flag on to get a packed table instead (see below) : the list shall then be
+// declared with KNX_DEVICE_COM_OBJECTS() (see KnxComObjectTable.h)
+// #define KNX_COM_OBJ_PACKED_TABLE
+
+// Value position flag : the value is a bit of the B1 values bitset (the position is the bit nb)
+#define KNX_PACKED_COM_OBJ_B1_VALUE 0x8000
+
+
+/* A KnxComObject stores its constant attributes (header, DPT, indicator, length) in RAM beside its value,
+   i.e. 13 bytes per object on AVR. The packed table splits the com objects in parallel arrays :
+   - the constant attributes (address, DPT, indicator, length, priority, value position) are in flash memory
+     (PROGMEM arrays built at compile time by KNX_DEVICE_COM_OBJECTS())
+   - the validity flags are packed in a bitset (1 bit per object)
+   - the B1 values (DPT 1.xxx) are packed in another bitset (1 bit per B1 object)
+   - the other values are packed in a single arena (1 byte for a short value, length-1 bytes for a long value)
+   So a B1 object takes 2 bits of RAM, a 1 byte object 1 byte + 1 bit, a F16 object 2 bytes + 1 bit.
+   The telegram header is built on the fly from the flash attributes when a telegram is sent.
+   table[index] gives a KnxPackedComObject, with the same functions as KnxComObject, so that the upper layers
+   handle both lists in the same way. */
+
+class KnxPackedComObject;
+
+class KnxPackedComObjects {
+    // Attributes in flash memory : PROGMEM arrays, one entry per com object
+    const word *_addr;        // Group addresses
+    const byte *_dptId;       // Datapoint types
+    const byte *_indicator;   // C/R/W/T/U/I indicators
+    const byte *_length;      // Lengths (calculated in the same way as telegram payload length)
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+    const byte *_prio;        // Priorities
+#endif
+    const word *_valuePos;    // Value positions : offset in _values, or B1 flag | bit nb in _b1Bits
+
+    // Values in RAM
+    byte *_validityBits;      // Validity bitset (1 bit per com object)
+    byte *_b1Bits;            // Values of the B1 com objects (1 bit per B1 com object)
+    byte *_values;            // Values of the other com objects
+    word _valuesSize;         // Size of _values
+    byte _b1BitsSize;         // Size of _b1Bits
+    type_com_obj_index _nb;   // Nb of com objects
+
+    word _sourceAddr;         // Source address of the sent telegrams (i.e. the physical address of the device)
+
+    friend class KnxPackedComObject;
+
+  public:
+    // Constructor : the arrays are provided by KNX_DEVICE_COM_OBJECTS(), see KnxComObjectTable.h
+    // The constructor is "constexpr" : the table is initialized at compile time
+    constexpr KnxPackedComObjects(const word addr[], const byte dptId[], const byte indicator[], const byte length[],
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+                                  const byte prio[],
+#endif
+                                  const word valuePos[], byte validityBits[], byte b1Bits[], byte b1BitsSize,
+                                  byte values[], word valuesSize, type_com_obj_index nb);
+
+  // INLINED functions (see definitions later in this file)
+    // Get the com object of a given index
+    KnxPackedComObject operator[](type_com_obj_index index);
+
+    // Get the nb of com objects
+    type_com_obj_index GetNb(void) const;
+
+    // Get the RAM used by the table (table object, bitsets and values)
+    unsigned long GetRamSize(void) const;
+
+    // Set the source address of the sent telegrams (i.e. the physical address of the device)
+    void SetSourceAddress(word addr);
+};
+
+
+// Com object of a packed table (table reference and index)
+// NB : the object is passed by value, the functions are the KnxComObject ones
+class KnxPackedComObject {
+    KnxPackedComObjects& _table;
+    type_com_obj_index _index;
+
+    // Value position in the table (see _valuePos)
+    word GetValuePos(void) const;
+
+    // Bit of the object in a bitset
+    static boolean GetBit(const byte bits[], word bitNb);
+    static void SetBit(byte bits[], word bitNb, boolean value);
+
+  public:
+    KnxPackedComObject(KnxPackedComObjects& table, type_com_obj_index index);
+
+  // INLINED functions (see definitions later in this file)
+    word GetAddr(void) const;
+
+    byte GetDptId(void) const;
+
+    e_KnxPriority GetPriority(void) const;
+
+    byte GetIndicator(void) const;
+
+    boolean GetValidity(void) const;
+
+    byte GetLength(void) const;
+
+    // Return the com obj value (short value case only)
+    byte GetValue(void) const;
+
+    // Update the com obj value (short value case only)
+    // Return ERROR if the com obj is long value (invalid use case), else return OK
+    // NB : a B1 value is stored as its bit 0
+    byte UpdateValue(byte newVal);
+
+    // Clear the validity of a com object having "InitRead" indicator (no effect on the other ones)
+    void ClearValidity(void);
+
+    // Toggle the binary value (for com objs with "B1" format)
+    // NB : the function does not change the validity.
+    void ToggleValue(void);
+
+    // Set the source address of the sent telegrams (same address for all the objects of the table)
+    void SetSourceAddress(word addr);
+
+  // functions NOT INLINED :
+    // Get the com obj value (short and long value cases)
+    void GetValue(byte dest[]) const;
+
+    // Update the com obj value (short and long value cases)
+    // Return OK (the data space of the value is always in the table)
+    byte UpdateValue(const byte ori[]);
+
+    // Update the com obj value with a telegram payload content
+    // Return ERROR if the telegram payload length differs from com obj one, else return OK
+    byte UpdateValue(const KnxTelegram& ori);
+
+    // Build a whole telegram (with checksum) with the given command : the com obj value is copied
+    // for WRITE and RESPONSE commands, the payload is cleared for READ command
+    void CopyToTelegram(KnxTelegram& dest, e_KnxCommand command) const;
+};
+
+
+// Com object reference used by the upper layers (KnxDevice, KnxSnapshot) : KnxComObject, or packed com object
+// when KNX_COM_OBJ_PACKED_TABLE flag is on
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+typedef KnxPackedComObject KnxComObjectRef;
+#else
+typedef KnxComObject& KnxComObjectRef;
+#endif
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline constexpr KnxPackedComObjects::KnxPackedComObjects(const word addr[], const byte dptId[], const byte indicator[],
+                                                          const byte length[],
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+                                                          const byte prio[],
+#endif
+                                                          const word valuePos[], byte validityBits[], byte b1Bits[],
+                                                          byte b1BitsSize, byte values[], word valuesSize, type_com_obj_index nb)
+: _addr(addr), _dptId(dptId), _indicator(indicator), _length(length),
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+  _prio(prio),
+#endif
+  _valuePos(valuePos), _validityBits(validityBits), _b1Bits(b1Bits), _values(values), _valuesSize(valuesSize),
+  _b1BitsSize(b1BitsSize), _nb(nb), _sourceAddr(0) {}
+
+inline KnxPackedComObject KnxPackedComObjects::operator[](type_com_obj_index index) { return KnxPackedComObject(*this, index); }
+
+inline type_com_obj_index KnxPackedComObjects::GetNb(void) const { return _nb; }
+
+inline unsigned long KnxPackedComObjects::GetRamSize(void) const
+{ return sizeof(KnxPackedComObjects) + ((_nb + 7UL) / 8) + _b1BitsSize + _valuesSize; }
+
+inline void KnxPackedComObjects::SetSourceAddress(word addr) { _sourceAddr = addr; }
+
+
+inline KnxPackedComObject::KnxPackedComObject(KnxPackedComObjects& table, type_com_obj_index index) : _table(table), _index(index) {}
+
+inline word KnxPackedComObject::GetValuePos(void) const { return pgm_read_word(&_table._valuePos[_index]); }
+
+inline boolean KnxPackedComObject::GetBit(const byte bits[], word bitNb) { return (bits[bitNb >> 3] >> (bitNb & 7)) & 1; }
+
+inline void KnxPackedComObject::SetBit(byte bits[], word bitNb, boolean value)
+{ if (value) bits[bitNb >> 3] |= (1 << (bitNb & 7)); else bits[bitNb >> 3] &= ~(1 << (bitNb & 7)); }
+
+inline word KnxPackedComObject::GetAddr(void) const { return pgm_read_word(&_table._addr[_index]); }
+
+inline byte KnxPackedComObject::GetDptId(void) const { return pgm_read_byte(&_table._dptId[_index]); }
+
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+inline e_KnxPriority KnxPackedComObject::GetPriority(void) const { return (e_KnxPriority) pgm_read_byte(&_table._prio[_index]); }
+#else
+inline e_KnxPriority KnxPackedComObject::GetPriority(void) const { return KNX_PRIORITY_NORMAL_VALUE; }
+#endif
+
+inline byte KnxPackedComObject::GetIndicator(void) const { return pgm_read_byte(&_table._indicator[_index]); }
+
+inline boolean KnxPackedComObject::GetValidity(void) const { return GetBit(_table._validityBits, _index); }
+
+inline void KnxPackedComObject::ClearValidity(void)
+{ if (GetIndicator() & KNX_COM_OBJ_I_INDICATOR) SetBit(_table._validityBits, _index, false); }
+
+inline byte KnxPackedComObject::GetLength(void) const { return pgm_read_byte(&_table._length[_index]); }
+
+inline byte KnxPackedComObject::GetValue(void) const
+{
+  word pos = GetValuePos();
+  if (pos & KNX_PACKED_COM_OBJ_B1_VALUE) return GetBit(_table._b1Bits, pos & ~KNX_PACKED_COM_OBJ_B1_VALUE);
+  return _table._values[pos];
+}
+
+inline byte KnxPackedComObject::UpdateValue(byte newValue)
+{
+  word pos = GetValuePos();
+  if (pos & KNX_PACKED_COM_OBJ_B1_VALUE) SetBit(_table._b1Bits, pos & ~KNX_PACKED_COM_OBJ_B1_VALUE, newValue & 1);
+  else if (GetLength() > 2) return KNX_COM_OBJECT_ERROR;
+  else _table._values[pos] = newValue;
+  SetBit(_table._validityBits, _index, true);
+  return KNX_COM_OBJECT_OK;
+}
+
+inline void KnxPackedComObject::ToggleValue(void)
+{
+  word pos = GetValuePos();
+  if (pos & KNX_PACKED_COM_OBJ_B1_VALUE) SetBit(_table._b1Bits, pos & ~KNX_PACKED_COM_OBJ_B1_VALUE, !GetValue());
+  else _table._values[pos] = !_table._values[pos];
+}
+
+inline void KnxPackedComObject::SetSourceAddress(word addr) { _table.SetSourceAddress(addr); }
+
+#endif // KNXPACKEDCOMOBJECTS_H
@@ -0,0 +1,231 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxSnapshot.cpp
+// Author : Franck Marini
+// Description : Snapshot of the com objects values in a non volatile storage (fast warm restart)
+// Module dependencies : KnxComObject, KnxPackedComObjects, KnxStorage
+
+#include "KnxSnapshot.h"
+
+// Max width of a com object value (14 bytes for A112 DPT format)
+#define SNAPSHOT_VALUE_MAX_SIZE (KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2)
+
+
+// Constructor
+KnxSnapshot::KnxSnapshot(KnxStorage& storage, const word rulesTable[], word defaultRule)
+: _storage(storage), _rulesTable(rulesTable), _defaultRule(defaultRule)
+{
+  _comObjectsList = NULL;
+  _comObjectsNb = 0;
+  _signature = 0;
+  _savePeriodSec = KNX_SNAPSHOT_DEFAULT_SAVE_PERIOD_SEC;
+  _lastSaveTimeMillis = 0;
+  _saveOngoing = false;
+  _saveIndex = 0;
+  _saveOffset = KNX_SNAPSHOT_HEADER_SIZE;
+  _changedBits = NULL;
+  _headerChanged = false;
+  _restoredObjectsNb = 0;
+  _savedRecordsNb = 0;
+}
+
+
+// Destructor
+KnxSnapshot::~KnxSnapshot() { free(_changedBits); }
+
+
+// Attach the list of com objects and restore the values saved in the storage
+// Return the nb of restored objects
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+type_com_obj_index KnxSnapshot::Restore(KnxPackedComObjects& comObjectsList, type_com_obj_index comObjectsNb)
+#else
+type_com_obj_index KnxSnapshot::Restore(KnxComObject comObjectsList[], type_com_obj_index comObjectsNb)
+#endif
+{
+byte value[SNAPSHOT_VALUE_MAX_SIZE];
+unsigned long nowTime, saveTime, ageMinutes = 0;
+boolean ageKnown;
+word offset = KNX_SNAPSHOT_HEADER_SIZE, rule;
+type_com_obj_index i;
+byte j, valueSize;
+word bitsSize;
+
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+  _comObjectsList = &comObjectsList;
+#else
+  _comObjectsList = comObjectsList;
+#endif
+  _comObjectsNb = comObjectsNb;
+  _signature = ComputeSignature();
+  _saveOngoing = false;
+  _lastSaveTimeMillis = millis();
+  _restoredObjectsNb = 0;
+
+  // All the objects are marked as changed, the restored ones are cleared below
+  // NB : when the allocation fails, each save cycle goes through all the objects
+  bitsSize = (_comObjectsNb + 7) >> 3;
+  free(_changedBits); // Restore() executed again
+  _changedBits = (byte *) malloc(bitsSize);
+  if (_changedBits) memset(_changedBits, 0xFF, bitsSize);
+  _headerChanged = false;
+
+  // Check that the storage content matches the com objects table
+  if ( (((word)_storage.Read(0) << 8 | _storage.Read(1)) != KNX_SNAPSHOT_MAGIC)
+       || (((word)_storage.Read(KNX_SNAPSHOT_SIGNATURE_OFFSET) << 8 | _storage.Read(KNX_SNAPSHOT_SIGNATURE_OFFSET+1)) != _signature) )
+  { // the header is written by the first save cycle
+    _headerChanged = true;
+    return 0;
+  }
+
+  // Evaluate the snapshot age
+  saveTime = 0;
+  for (i = 0; i < 4; i++) saveTime = (saveTime << 8) | _storage.Read(KNX_SNAPSHOT_TIME_OFFSET + i);
+  nowTime = _storage.GetTime();
+  ageKnown = (nowTime != 0) && (saveTime != 0) && (nowTime >= saveTime);
+  if (ageKnown) ageMinutes = (nowTime - saveTime) / 60;
+
+  for (i = 0; i < _comObjectsNb; i++)
+  {
+    rule = GetRule(i);
+    if (rule == KNX_SNAPSHOT_NOT_PERSISTENT) { ClearChanged(i); continue; } // no record for this object
+    if ( (_storage.Read(offset) & KNX_SNAPSHOT_RECORD_VALID)
+         && ( (rule == KNX_SNAPSHOT_NO_EXPIRY) || (ageKnown && (ageMinutes <= rule)) ) )
+    { // fresh value : the object gets valid and skips the init read
+      valueSize = RecordSize(i) - 1;
+      for (j = 0; j < valueSize; j++) value[j] = _storage.Read(offset + 1 + j);
+      ComObject(i).UpdateValue(value);
+      _restoredObjectsNb++;
+      ClearChanged(i); // the saved record is current
+    }
+    offset += RecordSize(i);
+  }
+  return _restoredObjectsNb;
+}
+
+
+// Start a save cycle immediately
+void KnxSnapshot::StartSave(void)
+{
+  _saveOngoing = true;
+  _saveIndex = 0;
+  _saveOffset = KNX_SNAPSHOT_HEADER_SIZE;
+}
+
+
+// Snapshot task
+// A save cycle goes through the changed com objects one by one, and ends with the header writing
+void KnxSnapshot::Task(void)
+{
+byte value[SNAPSHOT_VALUE_MAX_SIZE];
+unsigned long nowTime;
+byte i, valueSize;
+boolean recordChanged;
+
+  if (_comObjectsList == NULL) return; // Restore() not executed yet
+
+  if (!_saveOngoing)
+  { // no save cycle ongoing, we wait for the period end
+    if ((millis() - _lastSaveTimeMillis) < (unsigned long)_savePeriodSec * 1000) return;
+    if (!_headerChanged && !AnyChanged())
+    { // no object changed, no cycle
+      _lastSaveTimeMillis = millis();
+      return;
+    }
+    StartSave();
+  }
+
+  // Skip the non persistent objects, and the persistent ones not changed since their last save
+  while ((_saveIndex < _comObjectsNb) && ((GetRule(_saveIndex) == KNX_SNAPSHOT_NOT_PERSISTENT) || !IsChanged(_saveIndex)))
+  {
+    if (GetRule(_saveIndex) != KNX_SNAPSHOT_NOT_PERSISTENT) _saveOffset += RecordSize(_saveIndex);
+    else ClearChanged(_saveIndex); // no record
+    _saveIndex++;
+  }
+
+  if (_saveIndex < _comObjectsNb)
+  { // save one object record
+    KnxComObjectRef comObject = ComObject(_saveIndex);
+    ClearChanged(_saveIndex); // cleared first : a change occurring from now on is saved by the next cycle
+    if (comObject.GetValidity())
+    {
+      recordChanged = UpdateByte(_saveOffset, KNX_SNAPSHOT_RECORD_VALID);
+      valueSize = RecordSize(_saveIndex) - 1;
+      comObject.GetValue(value);
+      for (i = 0; i < valueSize; i++) recordChanged |= UpdateByte(_saveOffset + 1 + i, value[i]);
+    }
+    else recordChanged = UpdateByte(_saveOffset, 0); // the value is not saved
+    if (recordChanged) { _savedRecordsNb++; _headerChanged = true; }
+    _saveOffset += RecordSize(_saveIndex);
+    _saveIndex++;
+    return;
+  }
+
+  // All the changed records are saved, we end the cycle with the header when a record changed
+  // The save time tells the values were still current at this time
+  if (_headerChanged)
+  {
+    UpdateByte(0, (byte)(KNX_SNAPSHOT_MAGIC >> 8));
+    UpdateByte(1, (byte) KNX_SNAPSHOT_MAGIC);
+    UpdateByte(KNX_SNAPSHOT_SIGNATURE_OFFSET, (byte)(_signature >> 8));
+    UpdateByte(KNX_SNAPSHOT_SIGNATURE_OFFSET+1, (byte) _signature);
+    nowTime = _storage.GetTime();
+    for (i = 0; i < 4; i++) UpdateByte(KNX_SNAPSHOT_TIME_OFFSET + i, (byte)(nowTime >> (24 - 8*i)));
+    _storage.Commit();
+    _headerChanged = false;
+  }
+  _saveOngoing = false;
+  _lastSaveTimeMillis = millis();
+}
+
+
+// Return true when at least one object changed since its last save
+boolean KnxSnapshot::AnyChanged(void) const
+{
+word i;
+  if (_changedBits == NULL) return true;
+  for (i = 0; i < (word)((_comObjectsNb + 7) >> 3); i++) if (_changedBits[i]) return true;
+  return false;
+}
+
+
+// Compute the signature of the com objects table
+word KnxSnapshot::ComputeSignature(void) const
+{
+word signature = _comObjectsNb;
+type_com_obj_index i;
+  for (i = 0; i < _comObjectsNb; i++)
+  { // rotate and add the object attributes
+    signature = (signature << 3 | signature >> 13) + ComObject(i).GetAddr();
+    signature = (signature << 3 | signature >> 13) + ((word)ComObject(i).GetDptId() << 8 | ComObject(i).GetIndicator());
+    signature = (signature << 3 | signature >> 13) + GetRule(i);
+  }
+  return signature;
+}
+
+
+// Write a byte in the storage when its content differs
+boolean KnxSnapshot::UpdateByte(word offset, byte value)
+{
+  if (_storage.Read(offset) == value) return false;
+  _storage.Write(offset, value);
+  return true;
+}
+
+//EOF
@@ -0,0 +1,179 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxSnapshot.h
+// Author : Franck Marini
+// Description : Snapshot of the com objects values in a non volatile storage (fast warm restart)
+// Module dependencies : KnxComObject, KnxPackedComObjects, KnxStorage
+
+#ifndef KNXSNAPSHOT_H
+#define KNXSNAPSHOT_H
+
+#include "Arduino.h"
+#include "KnxComObject.h"
+#include "KnxPackedComObjects.h"
+#include "KnxStorage.h"
+
+// Per-object staleness rules :
+// The rules table gives, for each com object, the max age (in minutes) of its saved value.
+// A saved value older than its max age is stale : it is not restored and the object is initialized as usual.
+// Beside a max age, a rule can take one of the following values :
+#define KNX_SNAPSHOT_NOT_PERSISTENT  0x0000 // the object value is not saved
+#define KNX_SNAPSHOT_NO_EXPIRY       0xFFFF // the saved value never gets stale
+// NB : the age is evaluated with the storage backend clock (see KnxStorage::GetTime()). Without clock,
+// only the NO_EXPIRY values are restored.
+// Without rules table, all the persistent objects get the default rule given to the constructor :
+#define KNX_SNAPSHOT_DEFAULT_MAX_AGE_MIN      60 // default rule : a clockless storage (e.g. EEPROM) restores nothing,
+                                                 // NO_EXPIRY shall be chosen explicitly
+
+#define KNX_SNAPSHOT_DEFAULT_SAVE_PERIOD_SEC  600 // period of the save cycles (EEPROM wear : ~100k cycles per cell)
+
+// Storage layout :
+// HEADER : magic (2 bytes), com objects table signature (2 bytes), time of the last save (4 bytes)
+// then one RECORD per persistent com object : flags (1 byte), value (1 byte for short values, length-1 bytes else)
+// Only the records of the objects changed since their last save are written, and the header is written only when
+// a record changed : all the saved values are current at the header time (their age is never underestimated).
+#define KNX_SNAPSHOT_MAGIC             0x4B53 // "KS"
+#define KNX_SNAPSHOT_HEADER_SIZE       8
+#define KNX_SNAPSHOT_SIGNATURE_OFFSET  2
+#define KNX_SNAPSHOT_TIME_OFFSET       4
+#define KNX_SNAPSHOT_RECORD_VALID      0x01 // the saved value is valid
+
+
+class KnxSnapshot {
+    KnxStorage& _storage;              // Storage backend
+    const word *_rulesTable;           // Table (in PROGMEM) of the com objects staleness rules, NULL = default rule
+    const word _defaultRule;           // Staleness rule of all the objects when there's no rules table
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+    KnxPackedComObjects *_comObjectsList; // Attached packed table of com objects
+#else
+    KnxComObject *_comObjectsList;     // Attached list of com objects
+#endif
+    type_com_obj_index _comObjectsNb;  // Nb of attached com objects
+    word _signature;                   // Signature of the attached com objects table
+    word _savePeriodSec;               // Period of the save cycles (in sec)
+    unsigned long _lastSaveTimeMillis; // Time of the last save cycle end
+    boolean _saveOngoing;              // True when a save cycle is ongoing
+    type_com_obj_index _saveIndex;     // Index of the next com object to be saved
+    word _saveOffset;                  // Storage offset of the next record to be saved
+    byte *_changedBits;                // Bitset of the objects changed since their last save (1 bit per object)
+    boolean _headerChanged;            // True when the header shall be written at the end of the cycle
+    type_com_obj_index _restoredObjectsNb; // Nb of com objects restored by Restore()
+    word _savedRecordsNb;              // Nb of records written in the storage (changed records only)
+
+  public:
+    // Constructor
+    // The rules table, if any, shall be defined with PROGMEM attribute and have one entry per com object
+    // Without rules table, all the objects get the default rule (max age, NO_EXPIRY or NOT_PERSISTENT)
+    KnxSnapshot(KnxStorage& storage, const word rulesTable[] = NULL, word defaultRule = KNX_SNAPSHOT_DEFAULT_MAX_AGE_MIN);
+
+    // Destructor
+    ~KnxSnapshot();
+
+  // INLINED functions (see definitions later in this file)
+    // Set the period of the save cycles (in sec)
+    void SetSavePeriod(word savePeriodSec);
+
+    // Get the nb of com objects restored by Restore()
+    type_com_obj_index GetRestoredObjectsNb(void) const;
+
+    // Get the nb of records written in the storage since the start
+    word GetSavedRecordsNb(void) const;
+
+    // Mark a com object as changed : its record is written by the next save cycle (KnxDevice does it on each
+    // com object update)
+    void SetChanged(type_com_obj_index index);
+
+  // Functions NOT INLINED
+    // Attach the list of com objects and restore the values saved in the storage
+    // The restored objects get valid, so the init read of the "InitRead" objects is skipped
+    // Nothing is restored when the storage content does not match the com objects table (first start, table change)
+    // Return the nb of restored objects
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+    type_com_obj_index Restore(KnxPackedComObjects& comObjectsList, type_com_obj_index comObjectsNb);
+#else
+    type_com_obj_index Restore(KnxComObject comObjectsList[], type_com_obj_index comObjectsNb);
+#endif
+
+    // Start a save cycle immediately (e.g. before a planned shutdown)
+    void StartSave(void);
+
+    // Snapshot task, shall be called periodically (KnxDevice::task() does it)
+    // A cycle is started at the end of each save period, unless no object changed. Each call saves one changed
+    // com object at most, the storage is written only when the record content differs
+    void Task(void);
+
+  private:
+    // Return true when the object changed since its last save (true for all the objects when the bitset
+    // could not be allocated)
+    boolean IsChanged(type_com_obj_index index) const;
+
+    // Clear the changed bit of an object
+    void ClearChanged(type_com_obj_index index);
+
+    // Return true when at least one object changed since its last save
+    boolean AnyChanged(void) const;
+
+    // Get an attached com object
+    KnxComObjectRef ComObject(type_com_obj_index index) const;
+
+    // Get the staleness rule of a com object
+    word GetRule(type_com_obj_index index) const;
+
+    // Size of the record of a com object
+    byte RecordSize(type_com_obj_index index) const;
+
+    // Compute the signature of the com objects table (addresses, DPTs, indicators and rules)
+    word ComputeSignature(void) const;
+
+    // Write a byte in the storage when its content differs
+    // Return true if the byte has been written
+    boolean UpdateByte(word offset, byte value);
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline void KnxSnapshot::SetSavePeriod(word savePeriodSec) { _savePeriodSec = savePeriodSec; }
+
+inline type_com_obj_index KnxSnapshot::GetRestoredObjectsNb(void) const { return _restoredObjectsNb; }
+
+inline word KnxSnapshot::GetSavedRecordsNb(void) const { return _savedRecordsNb; }
+
+inline void KnxSnapshot::SetChanged(type_com_obj_index index)
+{ if (_changedBits && (index < _comObjectsNb)) _changedBits[index >> 3] |= (byte)(1 << (index & 0x07)); }
+
+inline boolean KnxSnapshot::IsChanged(type_com_obj_index index) const
+{ return (_changedBits == NULL) || (_changedBits[index >> 3] & (1 << (index & 0x07))); }
+
+inline void KnxSnapshot::ClearChanged(type_com_obj_index index)
+{ if (_changedBits) _changedBits[index >> 3] &= (byte)~(1 << (index & 0x07)); }
+
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+inline KnxComObjectRef KnxSnapshot::ComObject(type_com_obj_index index) const { return (*_comObjectsList)[index]; }
+#else
+inline KnxComObjectRef KnxSnapshot::ComObject(type_com_obj_index index) const { return _comObjectsList[index]; }
+#endif
+
+inline word KnxSnapshot::GetRule(type_com_obj_index index) const
+{ return (_rulesTable == NULL) ? _defaultRule : pgm_read_word(&_rulesTable[index]); }
+
+inline byte KnxSnapshot::RecordSize(type_com_obj_index index) const
+{ return (ComObject(index).GetLength() <= 2) ? 2 : ComObject(index).GetLength(); } // flags + value
+
+#endif // KNXSNAPSHOT_H
@@ -0,0 +1,72 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxStorage.h
+// Author : Franck Marini
+// Description : Non volatile storage backends (used by KnxSnapshot)
+// Module dependencies : EEPROM (AVR only)
+
+#ifndef KNXSTORAGE_H
+#define KNXSTORAGE_H
+
+#include "Arduino.h"
+#if defined(__AVR__)
+#include <EEPROM.h>
+#endif
+
+
+// Storage backend interface
+// The storage is seen as a byte array, the bytes never written read 0xFF (as an erased EEPROM)
+class KnxStorage {
+  public:
+    virtual ~KnxStorage() {}
+
+    // Read the byte stored at the given offset
+    virtual byte Read(word offset) = 0;
+
+    // Write a byte at the given offset
+    virtual void Write(word offset, byte value) = 0;
+
+    // Make the written bytes persistent (when the backend buffers the writes)
+    virtual void Commit(void) {}
+
+    // Return the current time in seconds (e.g. unix time from an RTC), or 0 if the backend has no clock
+    // NB : the time allows to evaluate the age of the saved values
+    virtual unsigned long GetTime(void) { return 0; }
+};
+
+
+#if defined(__AVR__)
+// EEPROM backend : the storage starts at the given EEPROM address
+// The EEPROM has no clock, derive the class and override GetTime() when an RTC is available
+class KnxEepromStorage : public KnxStorage {
+    const word _baseAddr; // EEPROM address of the storage start
+
+  public:
+    KnxEepromStorage(word baseAddr = 0) : _baseAddr(baseAddr) {}
+
+    byte Read(word offset) { return EEPROM.read(_baseAddr + offset); }
+
+    // NB : the EEPROM cell is written only when its content changes (EEPROM wear)
+    void Write(word offset, byte value) { EEPROM.update(_baseAddr + offset, value); }
+};
+
+#endif
+
+#endif // KNXSTORAGE_H
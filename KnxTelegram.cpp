@@ -34,19 +34,20 @@ void KnxTelegram::ClearTelegram(void)
 // multicast, routing counter = 6, payload length = 1
   for (byte i =0; i < KNX_TELEGRAM_MAX_SIZE; i++) _telegram[i] = 0; 
   _controlField = CONTROL_FIELD_DEFAULT_VALUE ; _routing= ROUTING_FIELD_DEFAULT_VALUE;
+  _dataXorSum = CONTROL_FIELD_DEFAULT_VALUE ^ ROUTING_FIELD_DEFAULT_VALUE; // the other bytes are 0
 }
 
    
 void KnxTelegram::SetLongPayload(const byte origin[], byte nbOfBytes) 
 {
   if (nbOfBytes > KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2) nbOfBytes = KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2;
-  for(byte i=0; i < nbOfBytes; i++) _payloadChecksum[i] = origin[i];
+  for(byte i=0; i < nbOfBytes; i++) WriteByte(KNX_TELEGRAM_HEADER_SIZE + 2 + i, origin[i]);
 }
 
 
 void KnxTelegram::ClearLongPayload(void)
 {
-  for(byte i=0; i < KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1; i++) _payloadChecksum[i] = 0;
+  for(byte i=0; i < KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1; i++) WriteByte(KNX_TELEGRAM_HEADER_SIZE + 2 + i, 0);
 }
 
 
@@ -57,21 +58,32 @@ void KnxTelegram::GetLongPayload(byte destination[], byte nbOfBytes) const
 };
     
 
+void KnxTelegram::BuildFromHeader(const byte header[], byte headerXorSum, e_KnxCommand cmd, byte firstPayloadByte, const byte longPayload[])
+{
+  byte i, length;
+  for (i = 0; i < KNX_TELEGRAM_HEADER_SIZE; i++) _telegram[i] = header[i];
+  _commandH = (cmd >> 2) & COMMAND_FIELD_HIGH_COMMAND_MASK;
+  _commandL = (cmd << 6) | (firstPayloadByte & COMMAND_FIELD_LOW_DATA_MASK);
+  _dataXorSum = headerXorSum ^ _commandH ^ _commandL;
+  length = GetPayloadLength() - 1; // nb of payload bytes after the 1st one
+  for (i = 0; i < length; i++)
+  {
+    _payloadChecksum[i] = longPayload ? longPayload[i] : 0;
+    _dataXorSum ^= _payloadChecksum[i];
+  }
+  _payloadChecksum[length] = ~_dataXorSum; // checksum
+}
+
+
 byte KnxTelegram::CalculateChecksum(void) const
 {
-  byte indexChecksum, xorSum=0;  
-  indexChecksum = KNX_TELEGRAM_HEADER_SIZE + GetPayloadLength() + 1;
-  for (byte i = 0; i < indexChecksum ; i++)   xorSum ^= _telegram[i]; // XOR Sum of all the databytes
-  return (byte)(~xorSum); // Checksum equals 1's complement of databytes XOR sum
+  return (byte)(~_dataXorSum); // Checksum equals 1's complement of databytes XOR sum
 }
 
 
 void KnxTelegram::UpdateChecksum(void)
 {
-  byte indexChecksum, xorSum=0; 
-  indexChecksum = KNX_TELEGRAM_HEADER_SIZE + GetPayloadLength() + 1;
-  for (byte i = 0; i < indexChecksum ; i++)   xorSum ^= _telegram[i]; // XOR Sum of all the databytes
-  _telegram[indexChecksum] = ~xorSum; // Checksum equals 1's complement of databytes XOR sum
+  _telegram[GetDataLength()] = ~_dataXorSum; // Checksum equals 1's complement of databytes XOR sum
 }
 
 
@@ -79,12 +91,13 @@ void KnxTelegram::Copy(KnxTelegram& dest) const
 {
   byte length = GetTelegramLength();
   for (byte i=0; i<length ; i++)  dest._telegram[i] = _telegram[i];
+  dest._dataXorSum = _dataXorSum; // all the data bytes have been copied
 }
 
 
 void KnxTelegram::CopyHeader(KnxTelegram& dest) const
 {
-  for(byte i=0; i < KNX_TELEGRAM_HEADER_SIZE; i++) dest._telegram[i] = _telegram[i];
+  for(byte i=0; i < KNX_TELEGRAM_HEADER_SIZE; i++) dest.WriteRawByte(_telegram[i], i);
 }
 
 
@@ -63,6 +63,11 @@
 //     -from 20ms for 1 byte payload telegram (Bus temporisation + Telegram transmit + ACK)
 //     -up to 40ms for 15 bytes payload (Bus temporisation + Telegram transmit + ACK)
 //
+// => Checksum :
+//     The XOR sum of the data bytes (all the bytes before the checksum) is updated on each byte write
+//     (fields setters and WriteRawByte()), so that the checksum calculation and check take a constant time.
+//     A payload length change adds or removes the bytes entering or leaving the checksummed area.
+//
 
 // Define for lengths & offsets
 #define KNX_TELEGRAM_HEADER_SIZE        6
@@ -131,6 +136,7 @@ class KnxTelegram {
         byte _payloadChecksum[KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1]; // byte 8 to 22
       };
     };
+    byte _dataXorSum; // XOR sum of the data bytes (bytes 0 to telegram length - 2)
 
   public:
   // CONSTRUCTOR
@@ -193,6 +199,11 @@ class KnxTelegram {
     // Clear the whole payload except the 1st payload byte
     void ClearLongPayload(void);
 
+    // Build a whole telegram from a pre-encoded header (6 bytes) and the XOR sum of its bytes :
+    // the header is copied, the command and the payload are written and the checksum is updated in one pass.
+    // The payload length is given by the header routing field (shall not be 0), a NULL longPayload clears the payload
+    void BuildFromHeader(const byte header[], byte headerXorSum, e_KnxCommand cmd, byte firstPayloadByte, const byte longPayload[]);
+
     byte CalculateChecksum(void) const;
     // Let the class calculate and update the proper checksum value in the telegram
     void UpdateChecksum(void);
@@ -208,18 +219,33 @@ class KnxTelegram {
     void Info(String&) const; // copy telegram info into a string
     void InfoRaw(String&) const; // copy raw data telegram into a string
     void InfoVerbose(String&) const; // copy verbose telegram info into a string
+
+  private:
+  // Private INLINED functions (defined later in this file)
+    // Nb of data bytes (i.e. position of the checksum)
+    byte GetDataLength(void) const;
+
+    // Write a byte (except the routing field) and update the data bytes XOR sum
+    void WriteByte(byte byteIndex, byte data);
+
+    // Write a header or command field and update the data bytes XOR sum
+    void WriteField(byte& field, byte data);
+
+    // Write the routing field and update the data bytes XOR sum, including the bytes entering
+    // or leaving the data area when the payload length changes
+    void WriteRoutingField(byte data);
 };
 
 
 // --------------- Definition of the INLINED functions : -----------------
 inline void KnxTelegram::ChangePriority(e_KnxPriority priority)
-{ _controlField &= ~CONTROL_FIELD_PRIORITY_MASK; _controlField |= priority & CONTROL_FIELD_PRIORITY_MASK;}
+{ WriteField(_controlField, (_controlField & ~CONTROL_FIELD_PRIORITY_MASK) | (priority & CONTROL_FIELD_PRIORITY_MASK)); }
     
 inline e_KnxPriority KnxTelegram::GetPriority(void) const 
 {return (e_KnxPriority)(_controlField & CONTROL_FIELD_PRIORITY_MASK);}
 
 inline void KnxTelegram::SetRepeated(void ) 
-{ CONTROL_FIELD_SET_REPEATED(_controlField);};
+{ byte controlField = _controlField; CONTROL_FIELD_SET_REPEATED(controlField); WriteField(_controlField, controlField); };
     
 inline boolean KnxTelegram::IsRepeated(void) const 
 {if (_controlField & CONTROL_FIELD_REPEATED_MASK ) return false; else return true ; }
@@ -227,7 +253,7 @@ inline boolean KnxTelegram::IsRepeated(void) const
 inline void KnxTelegram::SetSourceAddress(word addr) { 
   // WARNING : works with little endianness only
   // The adresses within KNX telegram are big endian
-  _sourceAddrL = (byte) addr; _sourceAddrH = byte(addr>>8);}
+  WriteField(_sourceAddrL, (byte) addr); WriteField(_sourceAddrH, byte(addr>>8));}
 
 inline word KnxTelegram::GetSourceAddress(void) const {
   // WARNING : works with little endianness only
@@ -237,7 +263,7 @@ inline word KnxTelegram::GetSourceAddress(void) const {
 inline void KnxTelegram:: SetTargetAddress(word addr) { 
   // WARNING : works with little endianness only
   // The adresses within KNX telegram are big endian
-  _targetAddrL = (byte) addr; _targetAddrH = byte(addr>>8);}
+  WriteField(_targetAddrL, (byte) addr); WriteField(_targetAddrH, byte(addr>>8));}
 
 inline word KnxTelegram::GetTargetAddress(void) const {
  // WARNING : endianess sensitive!! Code below is for LITTLE ENDIAN chip
@@ -248,17 +274,17 @@ inline boolean KnxTelegram::IsMulticast(void) const
 {return (_routing & ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK);}
 
 inline void KnxTelegram::SetMulticast(boolean mode)
-{ if (mode) _routing|= ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK;
-  else _routing &= ~ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK; }
+{ if (mode) WriteRoutingField(_routing | ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK);
+  else WriteRoutingField(_routing & ~ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK); }
  
 inline void KnxTelegram::ChangeRoutingCounter(byte counter) 
-{ counter <<= 4; _routing &= ~ROUTING_FIELD_COUNTER_MASK; _routing |= (counter & ROUTING_FIELD_COUNTER_MASK); }
+{ counter <<= 4; WriteRoutingField((_routing & ~ROUTING_FIELD_COUNTER_MASK) | (counter & ROUTING_FIELD_COUNTER_MASK)); }
 
 inline byte KnxTelegram::GetRoutingCounter(void) const 
 { return ((_routing & ROUTING_FIELD_COUNTER_MASK)>>4); }
 
 inline void KnxTelegram::SetPayloadLength(byte length) 
-{ _routing&= ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK ; _routing |= length & ROUTING_FIELD_PAYLOAD_LENGTH_MASK; }
+{ WriteRoutingField((_routing & ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK) | (length & ROUTING_FIELD_PAYLOAD_LENGTH_MASK)); }
 
 inline byte KnxTelegram::GetPayloadLength(void) const 
 {return (_routing & ROUTING_FIELD_PAYLOAD_LENGTH_MASK);}
@@ -267,17 +293,17 @@ inline byte KnxTelegram::GetTelegramLength(void) const
 { return (KNX_TELEGRAM_LENGTH_OFFSET + GetPayloadLength());}
 
 inline void KnxTelegram::SetCommand(e_KnxCommand cmd) {
-  _commandH &= ~COMMAND_FIELD_HIGH_COMMAND_MASK; _commandH |= (cmd >> 2);
-  _commandL &= ~COMMAND_FIELD_LOW_COMMAND_MASK;  _commandL |= (cmd << 6);}
+  WriteField(_commandH, (_commandH & ~COMMAND_FIELD_HIGH_COMMAND_MASK) | (cmd >> 2));
+  WriteField(_commandL, (_commandL & ~COMMAND_FIELD_LOW_COMMAND_MASK) | (cmd << 6));}
 
 inline e_KnxCommand KnxTelegram::GetCommand(void) const 
 {return (e_KnxCommand)(((_commandL & COMMAND_FIELD_LOW_COMMAND_MASK)>>6) + ((_commandH & COMMAND_FIELD_HIGH_COMMAND_MASK)<<2)); };
     
 inline void KnxTelegram::SetFirstPayloadByte(byte data) 
-{ _commandL &= ~COMMAND_FIELD_LOW_DATA_MASK ; _commandL |= data & COMMAND_FIELD_LOW_DATA_MASK; }
+{ WriteField(_commandL, (_commandL & ~COMMAND_FIELD_LOW_DATA_MASK) | (data & COMMAND_FIELD_LOW_DATA_MASK)); }
 
 inline void KnxTelegram::ClearFirstPayloadByte(void)
-{ _commandL &= ~COMMAND_FIELD_LOW_DATA_MASK;}
+{ WriteField(_commandL, _commandL & ~COMMAND_FIELD_LOW_DATA_MASK); }
 
 inline byte KnxTelegram::GetFirstPayloadByte(void) const 
 { return (_commandL & COMMAND_FIELD_LOW_DATA_MASK);}
@@ -286,12 +312,33 @@ inline byte KnxTelegram::ReadRawByte(byte byteIndex) const
 { return _telegram[byteIndex];}
 
 inline void KnxTelegram::WriteRawByte(byte data, byte byteIndex)
-{ _telegram[byteIndex] = data;}
+{ if (byteIndex == KNX_TELEGRAM_HEADER_SIZE - 1) WriteRoutingField(data); else WriteByte(byteIndex, data); }
 
 inline byte KnxTelegram::GetChecksum(void) const 
 { return (_payloadChecksum[GetPayloadLength() - 1]);}
 
 inline boolean KnxTelegram::IsChecksumCorrect(void) const 
-{ return (GetChecksum()==CalculateChecksum());}
+{ return (GetChecksum() == (byte)(~_dataXorSum));}
+
+inline byte KnxTelegram::GetDataLength(void) const
+{ return (KNX_TELEGRAM_HEADER_SIZE + GetPayloadLength() + 1);}
+
+inline void KnxTelegram::WriteByte(byte byteIndex, byte data)
+{ // the checksum and the bytes after it are not part of the XOR sum
+  if (byteIndex < GetDataLength()) _dataXorSum ^= _telegram[byteIndex] ^ data;
+  _telegram[byteIndex] = data; }
+
+inline void KnxTelegram::WriteField(byte& field, byte data)
+{ WriteByte((byte)(&field - _telegram), data); }
+
+inline void KnxTelegram::WriteRoutingField(byte data)
+{
+  byte start = GetDataLength(), end;
+  _dataXorSum ^= _routing ^ data; _routing = data;
+  end = GetDataLength();
+  if (start > end) { byte tmp = start; start = end; end = tmp; }
+  // the bytes between the old and new data lengths enter or leave the XOR sum
+  for (byte i = start; i < end; i++) _dataXorSum ^= _telegram[i];
+}
 
 #endif // KNXTELEGRAM_H
@@ -0,0 +1,100 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTokenBucket.h
+// Author : Franck Marini
+// Description : Token bucket rate limiter (transmitted telegrams rate)
+// Module dependencies : none
+
+#ifndef KNXTOKENBUCKET_H
+#define KNXTOKENBUCKET_H
+
+#include "Arduino.h"
+
+// A token is earned every "period", up to "burst" tokens, and each sent telegram spends a token.
+// So the long term rate is 1 telegram per period, and up to "burst" telegrams may be sent in a row
+// after a quiet time. A bucket with a 0 period does not limit anything.
+// The time is given by the caller (millis() value), so that the bucket can run on a simulated time.
+// NB : the tokens are earned on integer periods (no fixed point arithmetic), the fraction of period
+// elapsed since the last earned token is kept for the next call.
+
+class KnxTokenBucket {
+    word _periodMillis;              // Time (in msec) to earn a token, 0 : no limit
+    byte _burst;                     // Max nb of tokens
+    byte _tokens;                    // Nb of tokens available
+    unsigned long _refillTimeMillis; // Time (in msec) the last token was earned
+
+  public:
+    // Constructor : no limit
+    KnxTokenBucket();
+
+  // INLINED functions (see definitions later in this file)
+    // Set the rate : a token earned every periodMillis, up to burst tokens (1 min)
+    // A 0 period removes the limit. The bucket is full after the change.
+    void SetRate(word periodMillis, byte burst, unsigned long nowTimeMillis);
+
+    // Return true when the bucket limits the rate (period not 0)
+    boolean IsLimited(void) const;
+
+    // Get the period (in msec) and the burst
+    word GetPeriod(void) const;
+    byte GetBurst(void) const;
+
+    // Earn the tokens since the last call
+    // Return true when a token is available (always true when the bucket does not limit the rate)
+    boolean Available(unsigned long nowTimeMillis);
+
+    // Spend a token (nothing done when no token is available)
+    void Take(void);
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline KnxTokenBucket::KnxTokenBucket() : _periodMillis(0), _burst(1), _tokens(1), _refillTimeMillis(0) {}
+
+inline void KnxTokenBucket::SetRate(word periodMillis, byte burst, unsigned long nowTimeMillis)
+{
+  _periodMillis = periodMillis;
+  _burst = (burst ? burst : 1);
+  _tokens = _burst;
+  _refillTimeMillis = nowTimeMillis;
+}
+
+inline boolean KnxTokenBucket::IsLimited(void) const { return (_periodMillis != 0); }
+
+inline word KnxTokenBucket::GetPeriod(void) const { return _periodMillis; }
+
+inline byte KnxTokenBucket::GetBurst(void) const { return _burst; }
+
+inline boolean KnxTokenBucket::Available(unsigned long nowTimeMillis)
+{
+  if (!_periodMillis) return true;
+  if (_tokens >= _burst) _refillTimeMillis = nowTimeMillis; // full bucket, no token earned meanwhile
+  else
+  {
+    unsigned long earnedNb = (nowTimeMillis - _refillTimeMillis) / _periodMillis;
+    if (earnedNb >= (unsigned long)(_burst - _tokens)) { _tokens = _burst; _refillTimeMillis = nowTimeMillis; }
+    else { _tokens += earnedNb; _refillTimeMillis += earnedNb * _periodMillis; }
+  }
+  return (_tokens != 0);
+}
+
+inline void KnxTokenBucket::Take(void) { if (_tokens) _tokens--; }
+
+#endif // KNXTOKENBUCKET_H
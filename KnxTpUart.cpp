@@ -20,7 +20,7 @@
 // File : KnxTpUart.cpp
 // Author : Franck Marini
 // Description : Communication with TPUART
-// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject
+// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxAddressIndex, SpscRingBuffer
 
 #include "KnxTpUart.h"
 
@@ -40,17 +40,40 @@ KnxTpUart::KnxTpUart(HardwareSerial& serial, word physicalAddr, type_KnxTpUartMo
 : _serial(serial), _physicalAddr(physicalAddr), _mode(mode)
 {
   _rx.state = RX_RESET;
-  _rx.addressedComObjectIndex = 0;
+  _rx.head = 0;
+  _rx.tail = 0;
+  _rx.queuedMaxNb = 0;
+  _rx.overflowsNb = 0;
+  _rx.busTelegramsNb = 0;
+  _rx.ownTelegramsNb = 0;
+  _rx.readBytesNb = 0;
+  _rx.expectedBytesNb = 0;
+  _rx.lastByteRxTimeMicrosec = 0;
+#if defined(KNXTPUART_RX_INTERRUPT)
+  _rxIsr.readBytesNb = 0;
+  _rxIsr.expectedBytesNb = 0;
+  _rxIsr.lastByteRxTimeMicrosec = 0;
+  _rxIsr.txWriting = false;
+  _rxIsr.ackService = 0;
+  _rxIsr.lostBytesNb = 0;
+#endif
   _tx.state = TX_RESET;
   _tx.sentTelegram = NULL;
   _tx.ackFctPtr = NULL;
   _tx.nbRemainingBytes = 0;
   _tx.txByteIndex = 0;
+  _tx.uartFreeMax = 0;
+  _reset.status = TPUART_RESET_STATUS_IDLE;
+  _reset.answerTimeoutMillisec = TPUART_RESET_ANSWER_TIMEOUT_MILLISEC;
+  _reset.initialBackoffMillisec = 0;
+  _reset.attemptsNb = TPUART_RESET_ATTEMPTS_NB;
+  _reset.remainingAttemptsNb = 0;
+  _reset.backoffMillisec = 0;
+  _reset.stepTimeMillisec = 0;
+  _reset.startTimeMillisec = 0;
+  _reset.lastDurationMillisec = 0;
   _stateIndication = 0;
   _evtCallbackFct = NULL;
-  _comObjectsList = NULL;
-  _assignedComObjectsNb = 0;
-  _orderedIndexTable = NULL;
   _stateIndication = 0;
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
   _debugStrPtr = NULL;
@@ -61,7 +84,6 @@ KnxTpUart::KnxTpUart(HardwareSerial& serial, word physicalAddr, type_KnxTpUartMo
 // Destructor
 KnxTpUart::~KnxTpUart()
 {
-  if (_orderedIndexTable) free(_orderedIndexTable);
   // close the serial communication if opened
   if ( (_rx.state > RX_RESET) || (_tx.state > TX_RESET) ) 
   {
@@ -80,9 +102,18 @@ KnxTpUart::~KnxTpUart()
 // Return KNX_TPUART_ERROR in case of TPUART Reset failure
 byte KnxTpUart::Reset(void)
 {
-word startTime, nowTime;
-byte attempts = 10;
+e_TpUartResetStatus status;
+
+  StartReset();
+  do status = ResetTask();
+  while ((status != TPUART_RESET_STATUS_DONE) && (status != TPUART_RESET_STATUS_FAILED));
+  return (status == TPUART_RESET_STATUS_DONE) ? KNX_TPUART_OK : KNX_TPUART_ERROR;
+}
 
+
+// Start a non-blocking reset of the Arduino UART port and the TPUART device
+void KnxTpUart::StartReset(boolean restart)
+{
   if ( (_rx.state > RX_RESET) || (_tx.state > TX_RESET) ) 
   { // HOT RESET case
     _serial.end(); // stop the serial communication before restarting it
@@ -90,110 +121,114 @@ byte attempts = 10;
   }
 
   // CONFIGURATION OF THE ARDUINO USART WITH CORRECT FRAME FORMAT (19200, 8 bits, parity even, 1 stop bit)
-  _serial.begin(19200,SERIAL_8E1);
+  _serial.begin(TPUART_SERIAL_BAUDRATE,SERIAL_8E1);
   //_serial.begin(19200);
   //UCSR1C = UCSR1C | B00100000; // Even Parity
-  
-  while(attempts--)
-  { // we send a RESET REQUEST and wait for the reset indication answer
-    // the sequence is repeated every sec as long as we do not get the reset indication 
-    _serial.write(TPUART_RESET_REQ); // send RESET REQUEST
 
-    for (nowTime = startTime = (word) millis() ; TimeDeltaWord(nowTime,startTime) < 1000 /* 1 sec */ ; nowTime = (word)millis())
-    {
-      if (_serial.available() > 0) 
+  SerialWrite(TPUART_RESET_REQ); // send the first RESET REQUEST
+  _reset.status = TPUART_RESET_STATUS_ONGOING;
+  _reset.remainingAttemptsNb = _reset.attemptsNb;
+  _reset.backoffMillisec = _reset.initialBackoffMillisec;
+  _reset.stepTimeMillisec = (word) millis();
+  if (!restart) _reset.startTimeMillisec = millis();
+}
+
+
+// Reset task
+// Wait for the reset indication answer, the RESET REQUEST is repeated as long as we do not get it
+e_TpUartResetStatus KnxTpUart::ResetTask(void)
+{
+word nowTime;
+byte rxByte, bytesNb;
+
+  switch (_reset.status)
+  {
+    case TPUART_RESET_STATUS_ONGOING :
+      for (bytesNb = 0; (bytesNb < TPUART_RESET_MAX_BYTES_PER_TASK) && ReadRxByte(rxByte); bytesNb++)
       {
-        if (_serial.read() == TPUART_RESET_INDICATION)
+        if (rxByte == TPUART_RESET_INDICATION)
         {
           _rx.state = RX_INIT; _tx.state = TX_INIT;
+          _reset.status = TPUART_RESET_STATUS_DONE;
+          _reset.lastDurationMillisec = millis() - _reset.startTimeMillisec;
 #if defined(KNXTPUART_DEBUG_INFO)
           DebugInfo("Reset successful\n");
 #endif
-          return KNX_TPUART_OK;
+          return _reset.status;
         }
       }
-    } // 1 sec ellapsed
-  } // while(attempts--)
-  _serial.end();
+      nowTime = (word) millis();
+      if (TimeDeltaWord(nowTime, _reset.stepTimeMillisec) < _reset.answerTimeoutMillisec) break; // keep waiting
+      // No answer to the RESET REQUEST
+      if (_reset.attemptsNb && !(--_reset.remainingAttemptsNb))
+      { // all the attempts failed
+        _serial.end();
+        _reset.status = TPUART_RESET_STATUS_FAILED;
 #if defined(KNXTPUART_DEBUG_ERROR)
-  DebugError("Reset failed, no answer from TPUART device\n");
+        DebugError("Reset failed, no answer from TPUART device\n");
 #endif
-  return KNX_TPUART_ERROR;
+        break;
+      }
+      _reset.stepTimeMillisec = nowTime;
+      if (_reset.backoffMillisec) _reset.status = TPUART_RESET_STATUS_BACKOFF;
+      else SerialWrite(TPUART_RESET_REQ); // immediate retry
+      break;
+
+    case TPUART_RESET_STATUS_BACKOFF :
+      nowTime = (word) millis();
+      if (TimeDeltaWord(nowTime, _reset.stepTimeMillisec) < _reset.backoffMillisec) break; // keep waiting
+      SerialWrite(TPUART_RESET_REQ); // new attempt
+      _reset.stepTimeMillisec = nowTime;
+      _reset.status = TPUART_RESET_STATUS_ONGOING;
+      // the next backoff is doubled
+      if (_reset.backoffMillisec <= TPUART_RESET_BACKOFF_MAX_MILLISEC / 2) _reset.backoffMillisec *= 2;
+      else _reset.backoffMillisec = TPUART_RESET_BACKOFF_MAX_MILLISEC;
+      break;
+
+    default : break;
+  }
+  return _reset.status;
 }
 
 
 // Attach a list of com objects
 // NB1 : only the objects with "communication" attribute are considered by the TPUART
-// NB2 : In case of objects with identical address, the object with highest index only is considered
+// NB2 : Objects with identical address are all targeted by the telegrams sent to this address
 // return KNX_TPUART_ERROR_NOT_INIT_STATE (254) if the TPUART is not in Init state
 // The function must be called prior to Init() execution
-byte KnxTpUart::AttachComObjectsList(KnxComObject comObjectsList[], byte listSize)
+byte KnxTpUart::AttachComObjectsList(KnxComObject comObjectsList[], type_com_obj_index listSize,
+                                     const type_address_index_table *addressIndex)
 {
-#define IS_COM(index) (comObjectsList[index].GetIndicator() & KNX_COM_OBJ_C_INDICATOR)
-#define ADDR(index) (comObjectsList[index].GetAddr())
-
   if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_TPUART_ERROR_NOT_INIT_STATE;
 
-  if (_orderedIndexTable)
-  {  // a list is already attached, we detach it
-    free(_orderedIndexTable);
-    _orderedIndexTable = NULL;
-    _comObjectsList = NULL;
-    _assignedComObjectsNb = 0;
-  }
-  if ((!comObjectsList) || (!listSize))
+  // a list may be already attached, the index is rebuilt
+  _rx.head = _rx.tail; // the queued telegrams refer to the previous index
+  if (((!comObjectsList) && (!addressIndex)) || (!listSize))
   {
+    _addressIndex.Clear();
 #if defined(KNXTPUART_DEBUG_INFO)
     DebugInfo("AttachComObjectsList : warning : empty object list!\n");
 #endif
     return  KNX_TPUART_OK;
   }
-  // Count all the com objects with communication indicator
-  for (byte i=0; i < listSize ; i++) if (IS_COM(i)) _assignedComObjectsNb++;
-  if (!_assignedComObjectsNb)
+  if (addressIndex) _addressIndex.Attach(*addressIndex); // index built at compile time
+  else if (_addressIndex.Build(comObjectsList, listSize) != KNX_ADDRESS_INDEX_OK)
+  {
+#if defined(KNXTPUART_DEBUG_ERROR)
+    DebugError("AttachComObjectsList : not enough memory!\n");
+#endif
+    return KNX_TPUART_ERROR;
+  }
+  if (!_addressIndex.GetEntriesNb())
   {
 #if defined(KNXTPUART_DEBUG_INFO)
     DebugInfo("AttachComObjectsList : warning : no object with com attribute in the list!\n");
 #endif
     return  KNX_TPUART_OK;    
   }
-  // Deduct the duplicate addresses
-  for (byte i=0; i < listSize ; i++)
-  {
-    if (!IS_COM(i)) continue;
-    for (byte j=0; j < listSize ; j++)
-    {
-      if ( (i!=j) && (ADDR(j) == ADDR(i)) && (IS_COM(j)) )
-      { // duplicate address found
-        if (j<i) break; // duplicate address already treated
-        else 
-        {
-          _assignedComObjectsNb--;
 #if defined(KNXTPUART_DEBUG_INFO)
-          DebugInfo("AttachComObjectsList : warning : duplicate address found!\n");
+  if (_addressIndex.GetDuplicatesNb()) DebugInfo("AttachComObjectsList : info : address shared by several objects found\n");
 #endif
-        }
-      }
-    }
-  }
-  _comObjectsList = comObjectsList;
-  // Creation of the ordered index table
-  _orderedIndexTable = (byte*) malloc(_assignedComObjectsNb);
-  word minMin = 0x0000;   // minimum min value searched  
-  word foundMin = 0xFFFF; // min value found so far
-  for (byte i=0; i < _assignedComObjectsNb; i++)
-  {
-    for (byte j=0; j < listSize ; j++) 
-    {
-      if ( (IS_COM(j)) && (ADDR(j)>=minMin) && (ADDR(j)<=foundMin) )
-      {
-        foundMin = ADDR(j);
-        _orderedIndexTable[i] = j;
-      }
-    }
-    minMin = foundMin + 1;
-    foundMin = 0xFFFF;
-  }
 #if defined(KNXTPUART_DEBUG_INFO)
   DebugInfo("AttachComObjectsList successful\n");
 #endif
@@ -213,7 +248,7 @@ byte KnxTpUart::Init(void)
   // BUS MONITORING MODE in case it is selected
   if (_mode == BUS_MONITOR)
   {
-    _serial.write(TPUART_ACTIVATEBUSMON_REQ); // Send bus monitoring activation request
+    SerialWrite(TPUART_ACTIVATEBUSMON_REQ); // Send bus monitoring activation request
 #if defined(KNXTPUART_DEBUG_INFO)
     DebugInfo("Init : Monitoring mode started\n");
 #endif
@@ -221,7 +256,7 @@ byte KnxTpUart::Init(void)
   else // NORMAL mode by default
   {
 #if defined(KNXTPUART_DEBUG_INFO)
-    if (_comObjectsList == NULL)  DebugInfo("Init : warning : empty object list!\n");
+    if (!_addressIndex.GetEntriesNb())  DebugInfo("Init : warning : empty object list!\n");
 #endif
     if (_evtCallbackFct == NULL) return KNX_TPUART_ERROR_NULL_EVT_CALLBACK_FCT;
     if (_tx.ackFctPtr == NULL) return KNX_TPUART_ERROR_NULL_ACK_CALLBACK_FCT;
@@ -230,10 +265,10 @@ byte KnxTpUart::Init(void)
     tpuartCmd[0] = TPUART_SET_ADDR_REQ;
     tpuartCmd[1] = (byte)(_physicalAddr>>8);
     tpuartCmd[2] = (byte)_physicalAddr;
-    _serial.write(tpuartCmd,3);
+    SerialWrite(tpuartCmd,3);
   
     // Call U_State.request-Service in order to have the field _stateIndication up-to-date
-    _serial.write(TPUART_STATE_REQ);
+    SerialWrite(TPUART_STATE_REQ);
 
     _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
     _tx.state = TX_IDLE;
@@ -269,60 +304,155 @@ byte KnxTpUart::SendTelegram(KnxTelegram& sentTelegram)
 // This function shall be called periodically in order to allow a correct reception of the EIB bus data
 // Assuming the TPUART speed is configured to 19200 baud, a character (8 data + 1 start + 1 parity + 1 stop)
 // is transmitted in 0,58ms.
-// In order not to miss any End Of Packets (i.e. a gap from 2 to 2,5ms), the function shall be called at a max period of 0,5ms.
+// All the bytes available in the UART RX buffer are processed at each call. The arrival time of each byte
+// is estimated from the baud rate, so that a late call (loop jitter) does not look like an End Of Packet :
+// - the end of a telegram is detected as soon as its last byte is received (the length is given by the routing field)
+// - an End Of Packet gap (from 2 to 2,5ms) is only detected when the RX buffer remains empty during that time
 // Typical calling period is 400 usec.
 void KnxTpUart::RXTask(void)
 {
-byte incomingByte;
-word nowTime;
-static byte readBytesNb; // Nb of read bytes during an EIB telegram reception
-static KnxTelegram telegram; // telegram being received
-static byte addressedComObjectIndex; // index of the com object targeted by the received telegram
-static word lastByteRxTimeMicrosec;
+#if defined(KNXTPUART_RX_INTERRUPT)
+type_tpuart_rx_byte rxByte;
+
+  // Process the bytes stored by RXInterrupt(), with their real arrival time
+  while (_rxRing.Pop(rxByte))
+  {
+    if ( (_rx.state >= RX_EIB_TELEGRAM_RECEPTION_STARTED)
+         && (TimeDeltaWord(rxByte.timeMicrosec, _rx.lastByteRxTimeMicrosec) > TPUART_EOP_GAP_MICROSEC) )
+    { // EOP gap found before this byte, the telegram reception is completed
+      RXEndOfPacket();
+    }
+    _rx.lastByteRxTimeMicrosec = rxByte.timeMicrosec;
+    RXByte(rxByte.data);
+    if (_rx.state <= RX_STOPPED) return; // TPUART reset, the remaining bytes are meaningless
+  }
+  // Check EOP in case a Telegram is being received
+  // NB : the time is read after the ring is found empty, so that a byte received meanwhile has a later time
+  if ( (_rx.state >= RX_EIB_TELEGRAM_RECEPTION_STARTED)
+       && (TimeDeltaWord((word) micros(), _rx.lastByteRxTimeMicrosec) > TPUART_EOP_GAP_MICROSEC) )
+  { // No byte received for more than 2ms : EOP detected, the telegram reception is completed
+    RXEndOfPacket();
+  }
+#else
+word nowTime, byteRxTime;
+int availableBytesNb;
+
+  nowTime = (word) micros(); // word cast because a 65ms looping counter is long enough
+  availableBytesNb = _serial.available();
 
 // === STEP 1 : Check EOP in case a Telegram is being received ===
-  if (_rx.state >= RX_EIB_TELEGRAM_RECEPTION_STARTED)
-  { // a telegram reception is ongoing
-    nowTime = (word) micros(); // word cast because a 65ms looping counter is long enough
-    if(TimeDeltaWord(nowTime,lastByteRxTimeMicrosec) > 2000 /* 2 ms */ )
-    { // EOP detected, the telegram reception is completed
+  if (availableBytesNb <= 0)
+  {
+    if ( (_rx.state >= RX_EIB_TELEGRAM_RECEPTION_STARTED)
+         && (TimeDeltaWord(nowTime, _rx.lastByteRxTimeMicrosec) > TPUART_EOP_GAP_MICROSEC) )
+    { // No byte received for more than 2ms : EOP detected, the telegram reception is completed
+      RXEndOfPacket();
+    }
+    return;
+  }
 
-      switch (_rx.state)
-      {
-        case RX_EIB_TELEGRAM_RECEPTION_STARTED : // we are not supposed to get EOP now, the telegram is incomplete
-        case RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID :
-          _evtCallbackFct(TPUART_EVENT_EIB_TELEGRAM_RECEPTION_ERROR); // Notify telegram reception error
-          break;
+// === STEP 2 : Get New RX Data ===
+  // Estimate the arrival time of the oldest available byte :
+  // The available bytes have been received back to back, the latest one arrived before now.
+  // NB : the estimated times are kept even after a loop stall : the last byte time shall remain close to the real
+  // one, otherwise STEP 1 would see a false EOP gap at the next call while the telegram is still being received.
+  // The gap before the oldest byte is not evaluated (the bytes may have stopped arriving during the stall),
+  // the telegram end is given by its length.
+  byteRxTime = nowTime - (word)((availableBytesNb - 1) * TPUART_CHAR_TIME_MICROSEC);
+
+  while (availableBytesNb-- > 0)
+  {
+    _rx.lastByteRxTimeMicrosec = byteRxTime;
+    byteRxTime += TPUART_CHAR_TIME_MICROSEC;
+    RXByte((byte)(_serial.read()));
+    if (_rx.state <= RX_STOPPED) return; // TPUART reset, the remaining bytes are meaningless
+  }
+#endif // KNXTPUART_RX_INTERRUPT
+}
 
-        case RX_EIB_TELEGRAM_RECEPTION_ADDRESSED :
-          if (telegram.IsChecksumCorrect())
-          { // checksum correct, let's update the _rx struct with the received telegram and correct index
-        	telegram.Copy(_rx.receivedTelegram);
-            _rx.addressedComObjectIndex  = addressedComObjectIndex;
-            _evtCallbackFct(TPUART_EVENT_RECEIVED_EIB_TELEGRAM); // Notify the new received telegram
-          }
-          else
-          {  // checksum incorrect, notify error
-            _evtCallbackFct(TPUART_EVENT_EIB_TELEGRAM_RECEPTION_ERROR); // Notify telegram reception error
-          }
-          break;
 
-        // case RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED : break; // nothing to do!
-      
-        default : break; 
-      } // end of switch
+#if defined(KNXTPUART_RX_INTERRUPT)
+// UART RX interrupt hook (RX INTERRUPT mode)
+// Store the byte with its arrival time, and evaluate the ACK service as soon as the routing field is received
+// The ACK service is written here, unless the main context is writing the UART (see SerialWrite())
+void KnxTpUart::RXInterrupt(byte data)
+{
+type_tpuart_rx_byte rxByte;
+type_com_obj_index firstEntry, nb;
+byte ackService;
 
-      // we move state back to RX IDLE in any case
-      _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
-    } // end EOP detected
+  rxByte.data = data;
+  rxByte.timeMicrosec = (word) micros();
+  if (!_rxRing.TryAppend(rxByte)) _rxIsr.lostBytesNb++;
+
+  // Address evaluation is performed in NORMAL mode only, once the TPUART is initialized
+  if ((_mode != NORMAL) || (_rx.state < RX_IDLE_WAITING_FOR_CTRL_FIELD)) return;
+
+  if (TimeDeltaWord(rxByte.timeMicrosec, _rxIsr.lastByteRxTimeMicrosec) > TPUART_EOP_GAP_MICROSEC)
+    _rxIsr.readBytesNb = 0; // EOP, a new packet starts
+  _rxIsr.lastByteRxTimeMicrosec = rxByte.timeMicrosec;
+
+  if (!_rxIsr.readBytesNb)
+  { // only an EIB control field can start a telegram, the other bytes are TPUART services
+    if ((data & EIB_CONTROL_FIELD_PATTERN_MASK) != EIB_CONTROL_FIELD_VALID_PATTERN) return;
+    _rxIsr.expectedBytesNb = 0;
   }
-  
-// === STEP 2 : Get New RX Data ===
-  if (_serial.available() > 0) 
+  if (_rxIsr.readBytesNb < KNX_TELEGRAM_HEADER_SIZE) _rxIsr.header[_rxIsr.readBytesNb] = data;
+  _rxIsr.readBytesNb++;
+
+  if (_rxIsr.readBytesNb == KNX_TELEGRAM_HEADER_SIZE)
+  { // We have just read the routing field containing the address type and the payload length
+    _rxIsr.expectedBytesNb = KNX_TELEGRAM_LENGTH_OFFSET + (data & ROUTING_FIELD_PAYLOAD_LENGTH_MASK);
+    // No ACK for a telegram coming from us (i.e. telegram is sent by the TPUART itself)
+    if ( (word)((_rxIsr.header[1]<<8) + _rxIsr.header[2]) == _physicalAddr ) return;
+    // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
+    if (IsAddressAssigned((word)((_rxIsr.header[3]<<8) + _rxIsr.header[4]), firstEntry, nb))
+      ackService = TPUART_RX_ACK_SERVICE_ADDRESSED;
+    else ackService = TPUART_RX_ACK_SERVICE_NOT_ADDRESSED;
+    if (_rxIsr.txWriting) _rxIsr.ackService = ackService; // written at the end of the main context writing
+    else _serial.write(ackService);
+  }
+  else if (_rxIsr.readBytesNb == _rxIsr.expectedBytesNb) _rxIsr.readBytesNb = 0; // telegram end
+}
+
+
+// Write the ACK service left by RXInterrupt() during a main context writing (main context only)
+// The ACK is written with the interrupt writing disabled, an ACK left meanwhile is written by the next loop turn
+void KnxTpUart::SendPendingAck(void)
+{
+byte ackService;
+
+  while ((ackService = _rxIsr.ackService) != 0)
   {
-    incomingByte = (byte)(_serial.read());
-    lastByteRxTimeMicrosec = (word)micros();
-	
+    _rxIsr.txWriting = true;
+    _rxIsr.ackService = 0;
+    _serial.write(ackService);
+    _rxIsr.txWriting = false;
+  }
+}
+
+
+// Return true when the header of a telegram is being received by RXInterrupt() (its ACK is not evaluated yet)
+// NB : a header cut by an EOP gap is no longer considered, so that the transmission is not blocked till the next byte
+boolean KnxTpUart::IsIsrHeaderOngoing(void)
+{
+byte readBytesNb = _rxIsr.readBytesNb;
+word lastByteRxTime;
+
+  if ((!readBytesNb) || (readBytesNb >= KNX_TELEGRAM_HEADER_SIZE)) return false;
+  noInterrupts(); // the time is written by the interrupt
+  lastByteRxTime = _rxIsr.lastByteRxTimeMicrosec;
+  interrupts();
+  return (TimeDeltaWord((word) micros(), lastByteRxTime) <= TPUART_EOP_GAP_MICROSEC);
+}
+#endif // KNXTPUART_RX_INTERRUPT
+
+
+// Process a byte received from the TPUART
+void KnxTpUart::RXByte(byte incomingByte)
+{
+type_tpuart_rx_slot& slot = _rx.slots[_rx.tail & (TPUART_RX_QUEUE_SIZE - 1)]; // the telegram is received in its queue slot
+
     switch (_rx.state)
     {
       case RX_IDLE_WAITING_FOR_CTRL_FIELD:
@@ -330,7 +460,7 @@ static word lastByteRxTimeMicrosec;
           if ((incomingByte & EIB_CONTROL_FIELD_PATTERN_MASK) == EIB_CONTROL_FIELD_VALID_PATTERN)
           {
             _rx.state = RX_EIB_TELEGRAM_RECEPTION_STARTED; 
-            readBytesNb = 1; telegram.WriteRawByte(incomingByte,0);
+            _rx.readBytesNb = 1; _rx.expectedBytesNb = 0; slot.telegram.WriteRawByte(incomingByte,0);
           }
           // CASE OF TPUART_DATA_CONFIRM_SUCCESS NOTIFICATION
           else if (incomingByte == TPUART_DATA_CONFIRM_SUCCESS) 
@@ -385,54 +515,115 @@ static word lastByteRxTimeMicrosec;
             DebugError("Rx: Unknown Control Field received\n");
 #endif
           // else ignore "0" value sent on Reset by TPUART prior to TPUART_RESET_INDICATION
-          break;
+          return;
 
       case RX_EIB_TELEGRAM_RECEPTION_STARTED :
-          telegram.WriteRawByte(incomingByte,readBytesNb);
-          readBytesNb++;
+          slot.telegram.WriteRawByte(incomingByte,_rx.readBytesNb);
+          _rx.readBytesNb++;
 
-          if (readBytesNb==3) 
+          if (_rx.readBytesNb==3) 
           {  // We have just received the source address
              // we check whether the received EIB telegram is coming from us (i.e. telegram is sent by the TPUART itself)
-            if ( telegram.GetSourceAddress() == _physicalAddr )
+            if ( slot.telegram.GetSourceAddress() == _physicalAddr )
             { // the message is coming from us, we consider it as not addressed and we don't send any ACK service
               _rx.state = RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED;
             }
           }
-          else if (readBytesNb==6) // We have just read the routing field containing the address type and the payload length
+          else if (_rx.readBytesNb==6) // We have just read the routing field containing the address type and the payload length
           { // We check if the message is addressed to us in order to send the appropriate acknowledge
-            if(IsAddressAssigned(telegram.GetTargetAddress(), addressedComObjectIndex))
+            if(IsAddressAssigned(slot.telegram.GetTargetAddress(), slot.firstEntry, slot.comObjectsNb))
             { // Message addressed to us
               _rx.state = RX_EIB_TELEGRAM_RECEPTION_ADDRESSED;
+#if !defined(KNXTPUART_RX_INTERRUPT) // in RX INTERRUPT mode, the ACK has already been sent by RXInterrupt()
               //sent the correct ACK service now
               // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
-              _serial.write(TPUART_RX_ACK_SERVICE_ADDRESSED);
+              SerialWrite(TPUART_RX_ACK_SERVICE_ADDRESSED);
+#endif
             }
             else
             { // Message NOT addressed to us
               _rx.state = RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED;
+#if !defined(KNXTPUART_RX_INTERRUPT) // in RX INTERRUPT mode, the ACK has already been sent by RXInterrupt()
               //sent the correct ACK service now
               // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
-              _serial.write(TPUART_RX_ACK_SERVICE_NOT_ADDRESSED);
+              SerialWrite(TPUART_RX_ACK_SERVICE_NOT_ADDRESSED);
+#endif
             }
           } 
           break;
 
       case RX_EIB_TELEGRAM_RECEPTION_ADDRESSED :
-          if (readBytesNb == KNX_TELEGRAM_MAX_SIZE) _rx.state = RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID;
+          if (_rx.readBytesNb == KNX_TELEGRAM_MAX_SIZE) _rx.state = RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID;
           else
           {
-          telegram.WriteRawByte(incomingByte,readBytesNb);
-          readBytesNb++;
+          slot.telegram.WriteRawByte(incomingByte,_rx.readBytesNb);
+          _rx.readBytesNb++;
           }
           break;
 
+      case RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED : // if the message is not addressed, we only count the bytes till the telegram end
+          _rx.readBytesNb++;
+          if (_rx.readBytesNb==6) slot.telegram.WriteRawByte(incomingByte,5); // routing field of a telegram coming from us
+          break;
+
     //  case RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID : break; // if the message is too long, nothing to do except waiting for EOP
-    //  case RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED : break; // if the message is not addressed, nothing to do except waiting for EOP
 
-      default : break;
+      default : return;
     } // switch (_rx.state)
-  } // if (_serial.available() > 0)
+
+    // The routing field gives the telegram length : the telegram end is detected as soon as its last byte
+    // is received, without waiting for the EOP gap
+    if ((_rx.readBytesNb == 6) && (!_rx.expectedBytesNb)) _rx.expectedBytesNb = slot.telegram.GetTelegramLength();
+    if ((_rx.expectedBytesNb) && (_rx.readBytesNb >= _rx.expectedBytesNb)) RXEndOfPacket();
+}
+
+
+// Process an End Of Packet (end of the telegram being received)
+void KnxTpUart::RXEndOfPacket(void)
+{
+type_tpuart_rx_slot& slot = _rx.slots[_rx.tail & (TPUART_RX_QUEUE_SIZE - 1)];
+
+      switch (_rx.state)
+      {
+        case RX_EIB_TELEGRAM_RECEPTION_STARTED : // we are not supposed to get EOP now, the telegram is incomplete
+        case RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID :
+          _evtCallbackFct(TPUART_EVENT_EIB_TELEGRAM_RECEPTION_ERROR); // Notify telegram reception error
+          break;
+
+        case RX_EIB_TELEGRAM_RECEPTION_ADDRESSED :
+          if ((_rx.readBytesNb == _rx.expectedBytesNb) && (slot.telegram.IsChecksumCorrect()))
+          { // checksum correct, the slot is appended to the RX queue if another slot is free for the next telegram
+            _rx.busTelegramsNb++;
+            if ((byte)(_rx.tail - _rx.head) < TPUART_RX_QUEUE_SIZE - 1)
+            {
+              _rx.tail++;
+              if ((byte)(_rx.tail - _rx.head) > _rx.queuedMaxNb) _rx.queuedMaxNb = (byte)(_rx.tail - _rx.head);
+              _evtCallbackFct(TPUART_EVENT_RECEIVED_EIB_TELEGRAM); // Notify the new received telegram
+            }
+            else
+            { // RX queue full, the telegram is lost (its slot is reused by the next reception)
+              _rx.overflowsNb++;
+#if defined(KNXTPUART_DEBUG_ERROR)
+              DebugError("Rx: RX queue full, telegram lost!\n");
+#endif
+            }
+          }
+          else
+          {  // telegram incomplete or checksum incorrect, notify error
+            _evtCallbackFct(TPUART_EVENT_EIB_TELEGRAM_RECEPTION_ERROR); // Notify telegram reception error
+          }
+          break;
+
+        case RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED : // only counted (bus share statistics)
+          _rx.busTelegramsNb++;
+          if (slot.telegram.GetSourceAddress() == _physicalAddr) _rx.ownTelegramsNb++;
+          break;
+      
+        default : break; 
+      } // end of switch
+
+      // we move state back to RX IDLE in any case
+      _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
 }
 
 
@@ -441,12 +632,14 @@ static word lastByteRxTimeMicrosec;
 // Assuming the TP-Uart speed is configured to 19200 baud, a character (8 data + 1 start + 1 parity + 1 stop)
 // is transmitted in 0,58ms.
 // Sending one byte of a telegram consists in transmitting 2 characters (1,16ms)
-// Let's wait around 800us between each telegram piece sending so that the 64byte TX buffer remains almost empty.
+// Each call writes as many telegram pieces as the UART TX buffer can take, within the limit of
+// TPUART_TX_MAX_PENDING_CHARS waiting characters so that the RX ACK services are always sent in time.
 // Typical calling period is 800 usec.
 void KnxTpUart::TXTask(void)
 {
 word nowTime;
 byte txByte[2];
+int uartFree;
 static word sentMessageTimeMillisec;
 
   // STEP 1 : Manage Message Acknowledge timeout
@@ -468,33 +661,45 @@ static word sentMessageTimeMillisec;
     break;
 	
   case TX_TELEGRAM_SENDING_ONGOING :
-    // STEP 2 : send message if any to send
-    // In case a telegram reception has just started, and the ACK has not been sent yet,
-    // we block the transmission (for around 3,3ms) till the ACK is sent
-    // In that way, the TX buffer will remain empty and the ACK will be sent immediately
-    if (_rx.state != RX_EIB_TELEGRAM_RECEPTION_STARTED)
+    // STEP 2 : send message pieces as long as the UART TX buffer can take them
+    do
     {
+      // ACK priority rule : in case a telegram reception has just started, and the ACK has not been sent yet,
+      // we block the transmission (for around 3,3ms) till the ACK is sent
+      // In that way, the TX buffer will remain (almost) empty and the ACK will be sent immediately
+#if defined(KNXTPUART_RX_INTERRUPT)
+      if (IsIsrHeaderOngoing()) break; // the reception is tracked by RXInterrupt(), ahead of _rx
+#else
+      if (_rx.state == RX_EIB_TELEGRAM_RECEPTION_STARTED) break;
+#endif
+
+      uartFree = _serial.availableForWrite();
+      if (uartFree > _tx.uartFreeMax) _tx.uartFreeMax = uartFree;
+      if (_tx.uartFreeMax)
+      { // UART TX buffer free space is known
+        if (uartFree < 2) break; // no room for a piece
+        if ((_tx.uartFreeMax - uartFree) > (TPUART_TX_MAX_PENDING_CHARS - 2)) break; // enough characters waiting
+      }
+
+      if (_tx.nbRemainingBytes == 1)
+      { // We are sending the last byte, i.e checksum
+        txByte[0] = TPUART_DATA_END_REQ + _tx.txByteIndex;
+        txByte[1] = _tx.sentTelegram->ReadRawByte(_tx.txByteIndex);
+        SerialWrite(txByte,2); // write the UART control field and the data byte
+
+        // Message sending completed
+        sentMessageTimeMillisec = (word)millis(); // memorize sending time in order to manage ACK timeout
+        _tx.state = TX_WAITING_ACK;
+      }
+      else
       {
-        if (_tx.nbRemainingBytes == 1)
-        { // We are sending the last byte, i.e checksum
-          txByte[0] = TPUART_DATA_END_REQ + _tx.txByteIndex;
-          txByte[1] = _tx.sentTelegram->ReadRawByte(_tx.txByteIndex);
-          _serial.write(txByte,2); // write the UART control field and the data byte
-
-          // Message sending completed
-          sentMessageTimeMillisec = (word)millis(); // memorize sending time in order to manage ACK timeout
-	  _tx.state = TX_WAITING_ACK;
-        }
-        else
-        {
-          txByte[0] = TPUART_DATA_START_CONTINUE_REQ + _tx.txByteIndex;
-          txByte[1] = _tx.sentTelegram->ReadRawByte(_tx.txByteIndex);
-          _serial.write(txByte,2); // write the UART control field and the data byte
-          _tx.txByteIndex++;
-          _tx.nbRemainingBytes--;
-        }
+        txByte[0] = TPUART_DATA_START_CONTINUE_REQ + _tx.txByteIndex;
+        txByte[1] = _tx.sentTelegram->ReadRawByte(_tx.txByteIndex);
+        SerialWrite(txByte,2); // write the UART control field and the data byte
+        _tx.txByteIndex++;
+        _tx.nbRemainingBytes--;
       }
-    }
+    } while ((_tx.state == TX_TELEGRAM_SENDING_ONGOING) && (_tx.uartFreeMax)); // one piece per call if the UART free space is unknown
     break;
 	
   default : break;
@@ -525,9 +730,8 @@ static word lastByteRxTimeMicrosec;
     }
   }
   // STEP 2 : Get New RX Data
-  if (_serial.available() > 0) 
+  if (ReadRxByte(currentData.dataByte)) 
   {
-    currentData.dataByte = (byte)(_serial.read());
     currentData.isEOP = false;
     data= currentData;
     lastByteRxTimeMicrosec = (word) micros();
@@ -537,48 +741,42 @@ static word lastByteRxTimeMicrosec;
 }
 
 
-// Check if the target address is an assigned com object one
-// if yes, then update index parameter with the index (in the list) of the targeted com object and return true
-// else return false
-boolean KnxTpUart::IsAddressAssigned(word addr, byte &index) const
+// Write characters in the UART (main context only)
+// In RX INTERRUPT mode, the serial port writing is not reentrant : RXInterrupt() does not write the UART meanwhile,
+// and the ACK service it evaluated during the writing is written right after it (a few usec late at most)
+void KnxTpUart::SerialWrite(const byte data[], byte nb)
 {
-byte divisionCounter=0;
-byte i, searchIndexStart, searchIndexStop, searchIndexRange;
-
-  if (!_assignedComObjectsNb) return false; // in case of empty list, we return immediately
+#if defined(KNXTPUART_RX_INTERRUPT)
+  _rxIsr.txWriting = true;
+  _serial.write(data, nb);
+  _rxIsr.txWriting = false;
+  SendPendingAck();
+#else
+  _serial.write(data, nb);
+#endif
+}
 
-  // Define how many divisions by 2 shall be done in order to reduce the search list by 8 Addr max
-  // if _assignedComObjectsNb >= 16 => divisionCounter = 1
-  // if _assignedComObjectsNb >= 32 => divisionCounter = 2
-  // if _assignedComObjectsNb >= 64 => divisionCounter = 3
-  // if _assignedComObjectsNb >= 128 => divisionCounter = 4    
-  for (i=4; _assignedComObjectsNb >>i ; i++) divisionCounter++; 
 
-  // the starting point is to search on the whole address range (0 -> _assignedComObjectsNb -1)
-  searchIndexStart = 0; searchIndexStop = _assignedComObjectsNb - 1; searchIndexRange = _assignedComObjectsNb;
-  
-  // reduce the address range if needed
-  while(divisionCounter)
-  { 
-    searchIndexRange>>=1; // Divide range width by 2
-    if ( addr >= _comObjectsList[_orderedIndexTable[searchIndexStart+searchIndexRange]].GetAddr())
-      searchIndexStart += searchIndexRange ;
-    else searchIndexStop-=searchIndexRange;
-    divisionCounter --;
-  }
-  
-  // search the address value and index in the reduced range
-  for (i = searchIndexStart; ((_comObjectsList[_orderedIndexTable[i]].GetAddr() != addr) && (i <= searchIndexStop)); i++);
-  if (i > searchIndexStop) return false; // Address is NOT part of the assigned addresses
-  // Address is part of the assigned addresses
-  index = _orderedIndexTable[i];
+// Get a byte received from the TPUART (from the RX ring in RX interrupt mode, else from the UART)
+// Return false when no byte is available
+boolean KnxTpUart::ReadRxByte(byte& data)
+{
+#if defined(KNXTPUART_RX_INTERRUPT)
+type_tpuart_rx_byte rxByte;
+  if (!_rxRing.Pop(rxByte)) return false;
+  data = rxByte.data;
   return true;
+#else
+  if (_serial.available() <= 0) return false;
+  data = (byte)(_serial.read());
+  return true;
+#endif
 }
 
 
 // DEBUG purpose functions
-void KnxTpUart::DEBUG_SendResetCommand() { _serial.write(TPUART_RESET_REQ); }
+void KnxTpUart::DEBUG_SendResetCommand() { SerialWrite(TPUART_RESET_REQ); }
 
-void KnxTpUart::DEBUG_SendStateReqCommand() { _serial.write(TPUART_STATE_REQ); }
+void KnxTpUart::DEBUG_SendStateReqCommand() { SerialWrite(TPUART_STATE_REQ); }
 
 //EOF
@@ -20,7 +20,7 @@
 // File : KnxTpUart.h
 // Author : Franck Marini
 // Description : Communication with TPUART
-// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject
+// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxAddressIndex, SpscRingBuffer
 
 // This library supports both TPUART version 1 and 2
 // The Siemens KNX TPUART version 1 datasheet is available at :
@@ -35,12 +35,45 @@
 #include "HardwareSerial.h"
 #include "KnxTelegram.h"
 #include "KnxComObject.h"
+#include "KnxAddressIndex.h"
+#include "SpscRingBuffer.h"
 
 // !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
 // DEBUG :
 // #define KNXTPUART_DEBUG_INFO   // Uncomment to activate info traces
 // #define KNXTPUART_DEBUG_ERROR  // Uncomment to activate error traces
-
+// RX INTERRUPT MODE :
+// #define KNXTPUART_RX_INTERRUPT // Uncomment when the received bytes are provided by the UART RX interrupt (see RXInterrupt())
+
+
+// TPUART serial link : 19200 baud, a character is 11 bits long (8 data + 1 start + 1 parity + 1 stop)
+#define TPUART_SERIAL_BAUDRATE           19200
+#define TPUART_CHAR_TIME_MICROSEC        (11 * 1000000UL / TPUART_SERIAL_BAUDRATE) // around 0,57ms
+#define TPUART_EOP_GAP_MICROSEC          2000 // a gap from 2 to 2,5ms marks an End Of Packet
+
+// Max nb of characters waiting in the UART TX buffer during a telegram transmission.
+// An RX ACK service is written when the routing field (6th byte) of a telegram is received. Since the TX
+// writing stops as soon as a telegram reception starts, the waiting characters are sent during the reception
+// of the 5 first bytes, and the ACK service is never delayed beyond its 1,7ms deadline.
+#define TPUART_TX_MAX_PENDING_CHARS      6
+
+// TPUART reset default policy : each RESET REQUEST attempt waits 1 sec for the reset indication,
+// and 10 attempts are done before the reset is declared failed (see SetResetPolicy())
+#define TPUART_RESET_ANSWER_TIMEOUT_MILLISEC  1000
+#define TPUART_RESET_ATTEMPTS_NB              10
+#define TPUART_RESET_BACKOFF_MAX_MILLISEC     30000 // the backoff between 2 attempts is doubled up to this value
+#define TPUART_RESET_MAX_BYTES_PER_TASK       16 // max nb of received bytes inspected by each ResetTask() call
+
+// Size of the ring of timestamped received bytes (RX interrupt mode only), shall be a power of 2
+#define TPUART_RX_RING_SIZE              64
+
+// Nb of telegram slots of the RX queue, shall be a power of 2 (up to 128)
+// One slot is always kept for the telegram being received : up to (TPUART_RX_QUEUE_SIZE - 1) received telegrams
+// wait for their processing. Each slot costs 26 bytes of RAM.
+#define TPUART_RX_QUEUE_SIZE             4
+#if (TPUART_RX_QUEUE_SIZE < 2) || (TPUART_RX_QUEUE_SIZE > 128) || (TPUART_RX_QUEUE_SIZE & (TPUART_RX_QUEUE_SIZE - 1))
+#error "TPUART_RX_QUEUE_SIZE shall be a power of 2"
+#endif
 
 // Values returned by the KnxTpUart member functions :
 #define KNX_TPUART_OK                            0
@@ -88,7 +121,7 @@ enum type_KnxTpUartMode { NORMAL,
 // Definition of the TP-UART events sent to the application layer
 enum e_KnxTpUartEvent { 
   TPUART_EVENT_RESET = 0,                    // reset received from the TPUART device
-  TPUART_EVENT_RECEIVED_EIB_TELEGRAM,        // a new addressed EIB Telegram has been received
+  TPUART_EVENT_RECEIVED_EIB_TELEGRAM,        // a new addressed EIB Telegram has been received and appended to the RX queue
   TPUART_EVENT_EIB_TELEGRAM_RECEPTION_ERROR, // a new addressed EIB telegram reception failed
   TPUART_EVENT_STATE_INDICATION              // new TPUART state indication received
  };
@@ -96,6 +129,28 @@ enum e_KnxTpUartEvent {
 // Typedef for events callback function
 typedef void (*type_EventCallbackFctPtr) (e_KnxTpUartEvent);
 
+// --- Definitions for the RESET part ----
+// Reset status
+enum e_TpUartResetStatus {
+  TPUART_RESET_STATUS_IDLE = 0,   // No reset requested yet
+  TPUART_RESET_STATUS_ONGOING,    // RESET REQUEST sent, waiting for the reset indication
+  TPUART_RESET_STATUS_BACKOFF,    // No answer to the last attempt, waiting before the next one
+  TPUART_RESET_STATUS_DONE,       // Reset indication received, the TPUART is awaiting Init() execution
+  TPUART_RESET_STATUS_FAILED      // All the attempts failed, the serial port is closed
+};
+
+typedef struct {
+  e_TpUartResetStatus status;         // Current reset status
+  word answerTimeoutMillisec;         // Time waited for the reset indication after each RESET REQUEST
+  word initialBackoffMillisec;        // Time waited after the first unanswered attempt (0 = immediate retry)
+  byte attemptsNb;                    // Nb of attempts before the reset is declared failed (0 = unlimited)
+  byte remainingAttemptsNb;           // Nb of attempts remaining for the current reset
+  word backoffMillisec;               // Time to wait after the current unanswered attempt
+  word stepTimeMillisec;              // Time of the last RESET REQUEST sending (or backoff start)
+  unsigned long startTimeMillisec;    // Time of the current reset start (first StartReset() call)
+  unsigned long lastDurationMillisec; // Duration of the last successful reset
+} type_tpuart_reset;
+
 // --- Definitions for the RECEPTION part ----
 // RX states
 enum e_TpUartRxState {
@@ -109,14 +164,49 @@ enum e_TpUartRxState {
   RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED   // Tegram reception ongoing but not addressed
 };
 
+// RX queue slot : received telegram with the com objects it targets
+typedef struct {
+  KnxTelegram telegram;         // Received telegram
+  type_com_obj_index firstEntry;   // First address index entry of the com objects targeted by the telegram
+  type_com_obj_index comObjectsNb; // Nb of com objects targeted by the telegram
+} type_tpuart_rx_slot;
+
 typedef struct {
   e_TpUartRxState state;        // Current TPUART RX state
-  KnxTelegram receivedTelegram; // Where each received telegram is stored (the content is overwritten on each telegram reception)
-                                // A TPUART_EVENT_RECEIVED_EIB_TELEGRAM event notifies each content change
-  byte addressedComObjectIndex; // Where the index to the targeted com object is stored (the value is overwritten on each telegram reception)
-                                // A TPUART_EVENT_RECEIVED_EIB_TELEGRAM event notifies each content change
+  type_tpuart_rx_slot slots[TPUART_RX_QUEUE_SIZE]; // RX queue slots, used circularly
+  byte head;                    // Slot of the oldest queued telegram (free running counter)
+  byte tail;                    // Slot of the telegram being received (free running counter)
+                                // The queued telegrams are the slots from head to tail-1 : the telegram is received
+                                // directly in its queue slot, and is queued without any copy
+  byte queuedMaxNb;             // Max nb of queued telegrams
+  word overflowsNb;             // Nb of received telegrams lost because the RX queue was full
+  unsigned long busTelegramsNb; // Nb of telegrams seen on the bus (addressed or not, the telegrams sent by us included)
+  unsigned long ownTelegramsNb; // Nb of telegrams sent by us seen on the bus
+  byte readBytesNb;             // Nb of read bytes during an EIB telegram reception
+  byte expectedBytesNb;         // Length of the telegram being received (known once the routing field is received, else 0)
+  word lastByteRxTimeMicrosec;  // (Estimated) arrival time of the last received byte
 } type_tpuart_rx;
 
+#if defined(KNXTPUART_RX_INTERRUPT)
+// Byte received by the UART RX interrupt, with its arrival time
+typedef struct {
+  byte data;
+  word timeMicrosec;
+} type_tpuart_rx_byte;
+
+// Telegram header tracking performed in the UART RX interrupt, in order to send the ACK in time
+typedef struct {
+  byte header[KNX_TELEGRAM_HEADER_SIZE]; // Header of the telegram being received
+  volatile byte readBytesNb;             // Nb of read bytes of the telegram being received (0 = waiting for a control field)
+  byte expectedBytesNb;                  // Length of the telegram being received (known once the routing field is received)
+  word lastByteRxTimeMicrosec;           // Arrival time of the last received byte
+  volatile boolean txWriting;            // True while the main context writes the UART (the interrupt does not write then)
+  volatile byte ackService;              // ACK service evaluated by the interrupt during a main context writing, written
+                                         // by the main context at the end of its writing (0 = none)
+  word lostBytesNb;                      // Nb of bytes lost because the RX ring was full
+} type_tpuart_rx_isr;
+#endif
+
 // --- Definitions for the TRANSMISSION  part ----
 // Transmission states
 enum e_TpUartTxState {
@@ -145,6 +235,7 @@ typedef struct tpuart_tx {
   type_AckCallbackFctPtr ackFctPtr; // Pointer to callback function for TX ack
   byte nbRemainingBytes;            // Nb of bytes remaining to be transmitted
   byte txByteIndex;                 // Index of the byte to be sent
+  int uartFreeMax;                  // Max free space ever seen in the UART TX buffer (i.e. free space of the empty buffer)
 } type_tpuart_tx;
 
 
@@ -161,11 +252,14 @@ class KnxTpUart {
     const type_KnxTpUartMode _mode;           // TpUart working Mode (Normal/Bus Monitor)
     type_tpuart_rx _rx;                       // Reception structure
     type_tpuart_tx _tx;                       // Transmission structure
+    type_tpuart_reset _reset;                 // Reset structure
     type_EventCallbackFctPtr _evtCallbackFct; // Pointer to the EVENTS callback function
-    KnxComObject *_comObjectsList;            // Attached list of com objects
-    byte _assignedComObjectsNb;               // Nb of assigned com objects
-    byte *_orderedIndexTable;                 // Table containing the assigned com objects indexes ordered by increasing @
+    KnxAddressIndex _addressIndex;            // Index of the assigned com objects addresses
     byte _stateIndication;                    // Value of the last received state indication
+#if defined(KNXTPUART_RX_INTERRUPT)
+    SpscRingBuffer<type_tpuart_rx_byte, TPUART_RX_RING_SIZE> _rxRing; // Bytes received by the UART RX interrupt
+    type_tpuart_rx_isr _rxIsr;                // Telegram tracking performed in the UART RX interrupt
+#endif
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
     String *_debugStrPtr;
 #endif
@@ -203,12 +297,48 @@ static const char _debugErrorText[];
     // NB : every state indication value change is notified by a "TPUART_EVENT_STATE_INDICATION" event
     byte GetStateIndication(void) const;
 
-    // Get the reference to the telegram received by the TPUART
-    // NB : every received telegram content change is notified by a "TPUART_EVENT_RECEIVED_EIB_TELEGRAM" event
-    KnxTelegram& GetReceivedTelegram(void);
+    // Get the nb of received telegrams waiting in the RX queue
+    // NB : every telegram appended to the queue is notified by a "TPUART_EVENT_RECEIVED_EIB_TELEGRAM" event
+    byte GetReceivedTelegramsNb(void) const;
+
+    // Get the oldest received telegram of the RX queue (NULL when the queue is empty)
+    // The telegram is handed over without copy : it remains valid till ReleaseReceivedTelegram() call
+    KnxTelegram* GetReceivedTelegram(void);
+
+    // Release the oldest received telegram, its slot is given back to the reception
+    void ReleaseReceivedTelegram(void);
 
-    // Get the index of the com object targeted by the last received telegram
-    byte GetTargetedComObjectIndex(void) const;
+    // Get the nb of com objects targeted by the oldest received telegram
+    // NB : several com objects may share the same group address (fan-out)
+    type_com_obj_index GetTargetedComObjectsNb(void) const;
+
+    // Get the index of a com object targeted by the oldest received telegram
+    // rank goes from 0 to GetTargetedComObjectsNb()-1, the targeted objects are given by increasing index
+    type_com_obj_index GetTargetedComObjectIndex(type_com_obj_index rank = 0) const;
+
+    // Get the nb of received telegrams lost because the RX queue was full
+    word GetRxOverflowsNb(void) const;
+
+    // Get the max nb of telegrams simultaneously waiting in the RX queue
+    byte GetRxQueueMaxNb(void) const;
+
+    // Get the nb of telegrams seen on the bus (addressed or not), and the nb of them sent by us
+    // NB : the TPUART repeats on its RX line every telegram of the bus, the ones it sends included
+    unsigned long GetBusTelegramsNb(void) const;
+    unsigned long GetOwnTelegramsNb(void) const;
+
+    // Set the reset policy : time waited for the reset indication after each RESET REQUEST,
+    // backoff time before the second attempt (doubled on each following attempt, up to TPUART_RESET_BACKOFF_MAX_MILLISEC)
+    // and nb of attempts before the reset is declared failed (0 = unlimited)
+    // The policy is applied by the next StartReset() call
+    void SetResetPolicy(word answerTimeoutMillisec, word backoffMillisec, byte attemptsNb);
+
+    // Get the status of the last started reset
+    e_TpUartResetStatus GetResetStatus(void) const;
+
+    // Get the duration (in msec) of the last successful reset, from the first StartReset() call to reset indication
+    // reception (the restarts following a failed reset are included)
+    unsigned long GetLastResetDuration(void) const;
 
     // returns true if there is an activity ongoing (RX/TX) on the TPUART
     // false when there's no activity or when the tpuart is not initialized
@@ -222,14 +352,35 @@ static const char _debugErrorText[];
   // Functions NOT INLINED
     // Reset the Arduino UART port and the TPUART device
     // Return KNX_TPUART_ERROR in case of TPUART reset failure
+    // NB : the function is blocking till the reset completion (StartReset() and ResetTask() calls),
+    // it shall not be used with an unlimited nb of attempts
+    // In RX INTERRUPT mode, the reset indication is read from the RX ring : RXInterrupt() shall already be called
+    // by the UART RX interrupt routine
     byte Reset(void);
 
+    // Start a non-blocking reset of the Arduino UART port and the TPUART device
+    // The first RESET REQUEST is sent immediately, the reset is then completed by ResetTask() calls
+    // restart shall be true when the reset is started again after a FAILED status : the start time of the
+    // first attempt is kept so that GetLastResetDuration() includes the failed resets
+    void StartReset(boolean restart = false);
+
+    // Reset task
+    // This function shall be called periodically as long as the reset status is ONGOING or BACKOFF.
+    // Each call inspects at most TPUART_RESET_MAX_BYTES_PER_TASK received bytes and sends at most one RESET REQUEST.
+    // Return the reset status : when DONE, Init() shall be executed ; when FAILED, the serial port is closed
+    // and a new reset may be started
+    e_TpUartResetStatus ResetTask(void);
+
     // Attach a list of com objects
     // NB1 : only the objects with "communication" attribute are considered by the TPUART
-    // NB2 : In case of objects with identical address, the object with highest index only is considered
+    // NB2 : Objects with identical address are all targeted by the telegrams sent to this address
+    // NB3 : when an address index built at compile time is given (see KnxComObjectTable.h), it is used as is,
+    //       otherwise the index is built from the list
+    // NB4 : the list may be NULL when an address index is given (packed table, see KnxPackedComObjects.h)
     // return KNX_TPUART_ERROR_NOT_INIT_STATE (254) if the TPUART is not in Init state
     // The function must be called prior to Init() execution
-    byte AttachComObjectsList(KnxComObject KnxComObjectsList[], byte listSize);
+    byte AttachComObjectsList(KnxComObject KnxComObjectsList[], type_com_obj_index listSize,
+                              const type_address_index_table *addressIndex = NULL);
 
     // Init
     // returns ERROR (255) if the TP-UART is not in INIT state, else returns OK (0)
@@ -245,16 +396,42 @@ static const char _debugErrorText[];
     // This function shall be called periodically in order to allow a correct reception of the EIB bus data
     // Assuming the TPUART speed is configured to 19200 baud, a character (8 data + 1 start + 1 parity + 1 stop)
     // is transmitted in 0,58ms.
-    // In order not to miss any End Of Packets (i.e. a gap from 2 to 2,5ms), the function shall be called at a max period of 0,5ms.
+    // All the bytes available in the UART RX buffer are processed at each call. The arrival time of each byte
+    // is estimated from the baud rate, and the end of a telegram is detected from its length field, so that
+    // the reception is not disturbed when the calling period is temporarily longer (loop jitter).
+    // NB : the ACK of an addressed telegram shall be sent latest 1,7ms after the reception of the routing field,
+    // so the calling period shall remain around 0,5ms in order to acknowledge the telegrams in time.
     // Typical calling period is 400 usec.
+    // In RX INTERRUPT mode, the bytes are taken from the RX ring filled by RXInterrupt() with their real arrival time :
+    // the End Of Packets are detected whatever the calling period, and the ACK is written by RXInterrupt() itself,
+    // so the telegrams are acknowledged in time even when the calling period is temporarily much longer.
     void RXTask(void);
 
+#if defined(KNXTPUART_RX_INTERRUPT)
+    // UART RX interrupt hook (RX INTERRUPT mode)
+    // This function shall be called for each byte received from the TPUART, from an interrupt routine reading
+    // the serial port (e.g. a timer interrupt draining the UART RX buffer, see KnxDevice_RxInterrupt example),
+    // and not from the main context. It is called from the reset on : the reset indication is received through it.
+    // The byte is stored with its arrival time in a lock-free ring, then processed by RXTask() :
+    // the End Of Packets are thus detected from the real gaps between the bytes, whatever the RXTask() calling period.
+    // The function also evaluates the address of the telegram being received as soon as the routing field is
+    // received, and writes the ACK service at once, whatever the RXTask()/TXTask() calling period. The serial port
+    // writing is not reentrant : when the interrupt occurs while the main context writes the UART (see
+    // SerialWrite()), the ACK service is written by the main context right at the end of its writing.
+    void RXInterrupt(byte data);
+
+    // Get the nb of bytes lost because the RX ring was full (RXTask() not called often enough)
+    word GetRxLostBytesNb(void) const;
+#endif
+
     // Transmission task
     // This function shall be called periodically in order to allow a correct transmission of the EIB bus data
     // Assuming the TP-Uart speed is configured to 19200 baud, a character (8 data + 1 start + 1 parity + 1 stop)
     // is transmitted in 0,58ms.
     // Sending one byte of a telegram consists in transmitting 2 characters (1,16ms)
-    // Let's wait around 800us between each telegram piece sending so that the 64byte TX buffer remains almost empty.
+    // Each call writes as many telegram pieces as the UART TX buffer can take, within the limit of
+    // TPUART_TX_MAX_PENDING_CHARS waiting characters so that the RX ACK services are always sent in time.
+    // (one piece per call when the UART does not report its free TX space)
     // Typical calling period is 800 usec.
     void TXTask(void);
 
@@ -279,10 +456,37 @@ static const char _debugErrorText[];
 #endif
 
   // Private NOT INLINED functions 
-    // Check if the target address points to an assigned com object (i.e. the target address equals a com object address)
-    // if yes, then update index parameter with the index (in the list) of the targeted com object and return true
+    // Write characters in the UART (main context only)
+    // In RX INTERRUPT mode, RXInterrupt() does not write the UART meanwhile, the ACK service it evaluated during the
+    // writing is written right after it
+    void SerialWrite(const byte data[], byte nb);
+
+#if defined(KNXTPUART_RX_INTERRUPT)
+    // Write the ACK service left by RXInterrupt() during a main context writing (main context only)
+    void SendPendingAck(void);
+
+    // Return true when the header of a telegram is being received by RXInterrupt() (its ACK is not evaluated yet)
+    boolean IsIsrHeaderOngoing(void);
+#endif
+
+    // Get a byte received from the TPUART (from the RX ring in RX interrupt mode, else from the UART)
+    // Return false when no byte is available
+    boolean ReadRxByte(byte& data);
+
+    // Process a byte received from the TPUART
+    void RXByte(byte incomingByte);
+
+    // Process an End Of Packet (end of the telegram being received)
+    void RXEndOfPacket(void);
+
+  // Private INLINED functions (see definitions later in this file)
+    // Write a character in the UART (main context only), see above
+    void SerialWrite(byte data);
+
+    // Check if the target address points to assigned com objects (i.e. the target address equals a com object address)
+    // if yes, then update firstEntry and nb parameters with the address index run of the targeted com objects and return true
     // else return false
-    boolean IsAddressAssigned(word addr, byte &index) const;
+    boolean IsAddressAssigned(word addr, type_com_obj_index &firstEntry, type_com_obj_index &nb) const;
 };
 
 
@@ -306,12 +510,60 @@ inline byte KnxTpUart::SetAckCallback(type_AckCallbackFctPtr ackFctPtr)
 
 inline byte KnxTpUart::GetStateIndication(void) const { return _stateIndication; }
 
-inline KnxTelegram& KnxTpUart::GetReceivedTelegram(void)
-{ return _rx.receivedTelegram; }
+inline byte KnxTpUart::GetReceivedTelegramsNb(void) const { return (byte)(_rx.tail - _rx.head); }
+
+
+inline KnxTelegram* KnxTpUart::GetReceivedTelegram(void)
+{
+  if (_rx.head == _rx.tail) return NULL; // RX queue empty
+  return &_rx.slots[_rx.head & (TPUART_RX_QUEUE_SIZE - 1)].telegram;
+}
+
+
+inline void KnxTpUart::ReleaseReceivedTelegram(void) { if (_rx.head != _rx.tail) _rx.head++; }
+
+
+inline type_com_obj_index KnxTpUart::GetTargetedComObjectsNb(void) const
+{ return _rx.slots[_rx.head & (TPUART_RX_QUEUE_SIZE - 1)].comObjectsNb; } // nb of com objects addressed by the oldest received telegram
+
+
+inline type_com_obj_index KnxTpUart::GetTargetedComObjectIndex(type_com_obj_index rank) const
+{ return _addressIndex.GetComObjectIndex(_rx.slots[_rx.head & (TPUART_RX_QUEUE_SIZE - 1)].firstEntry + rank); }
+
+
+inline word KnxTpUart::GetRxOverflowsNb(void) const { return _rx.overflowsNb; }
+
+
+inline byte KnxTpUart::GetRxQueueMaxNb(void) const { return _rx.queuedMaxNb; }
+
+
+inline unsigned long KnxTpUart::GetBusTelegramsNb(void) const { return _rx.busTelegramsNb; }
+
+
+inline unsigned long KnxTpUart::GetOwnTelegramsNb(void) const { return _rx.ownTelegramsNb; }
+
+
+#if defined(KNXTPUART_RX_INTERRUPT)
+inline word KnxTpUart::GetRxLostBytesNb(void) const { return _rxIsr.lostBytesNb; }
+#endif
+
+
+inline void KnxTpUart::SetResetPolicy(word answerTimeoutMillisec, word backoffMillisec, byte attemptsNb)
+{
+  _reset.answerTimeoutMillisec = answerTimeoutMillisec;
+  _reset.initialBackoffMillisec = backoffMillisec;
+  _reset.attemptsNb = attemptsNb;
+}
+
+inline e_TpUartResetStatus KnxTpUart::GetResetStatus(void) const { return _reset.status; }
+
+inline unsigned long KnxTpUart::GetLastResetDuration(void) const { return _reset.lastDurationMillisec; }
+
 
+inline void KnxTpUart::SerialWrite(byte data) { SerialWrite(&data, 1); }
 
-inline byte KnxTpUart::GetTargetedComObjectIndex(void) const
-{ return _rx.addressedComObjectIndex; } // return the index of the adress addressed by the received KNX Telegram
+inline boolean KnxTpUart::IsAddressAssigned(word addr, type_com_obj_index &firstEntry, type_com_obj_index &nb) const
+{ nb = _addressIndex.Find(addr, firstEntry); return (nb != 0); }
 
 
 inline boolean KnxTpUart::IsActive(void) const
@@ -0,0 +1,378 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTpUartSim.h
+// Author : Franck Marini
+// Description : Simulated TPUART serial link (unit tests and benchmarks without TPUART device)
+// Module dependencies : HardwareSerial, KnxTelegram, KnxTpUart
+
+// The simulated link is given to KnxTpUart (or to Knx.begin()) in place of the serial port connected to the TPUART.
+// It is not included by KnxDevice.h : the sketches using it include KnxTpUartSim.h.
+// RX side : the test injects bytes or telegrams, each byte is timestamped with its arrival time on the line
+// (the bytes of a telegram are spaced by one character time). A byte is available to the reader once its arrival
+// time is reached. With an RX hook (KNXTPUART_RX_INTERRUPT mode), the arrived bytes are handed to the hook instead,
+// as the UART RX interrupt would do, each time Task() is called (Task() is also called when the link is used, e.g.
+// during a write() : the interrupt occurs while the host writes the UART). The hook is not nested in itself.
+// TX side : the TPUART services written by the host are decoded :
+// - RESET REQUEST is answered at once by a reset indication (unless muted, see SetResetMuted()), STATE REQUEST by a
+//   state indication
+// - the RX ACK services are counted, with the delay since the routing field arrival of the last received telegram
+// - a write() made during another write() (i.e. by the RX hook) is counted : the serial port writing is not reentrant
+// - a sent telegram is assembled from the data services, then repeated on the RX line (as the TPUART does for
+//   every telegram of the bus) and confirmed with the configured confirmation (see SetConfirm())
+// The UART TX buffer is emptied at the line speed : availableForWrite() gives the free space, GetTxEndTime() the time
+// the last written character leaves the UART.
+
+#ifndef KNXTPUARTSIM_H
+#define KNXTPUARTSIM_H
+
+#include "Arduino.h"
+#include "HardwareSerial.h"
+#if defined(__AVR__)
+#include "HardwareSerial_private.h" // definition of the HardwareSerial constructor (inlined in the AVR core)
+#endif
+#include "KnxTelegram.h"
+#include "KnxTpUart.h"
+
+#define KNX_TPUART_SIM_RX_SIZE        64 // Max nb of injected bytes waiting for their reading
+#define KNX_TPUART_SIM_TX_BUFFER_SIZE 63 // Free space of the empty UART TX buffer (AVR core value)
+#define KNX_TPUART_SIM_TELEGRAM_GAP   (TPUART_EOP_GAP_MICROSEC + 500) // Default gap before an injected telegram
+
+// Typedef for RX hook function (UART RX interrupt emulation)
+typedef void (*type_SimRxHookFctPtr) (byte);
+
+// Injected byte with its arrival time
+typedef struct {
+  byte data;
+  boolean isRoutingField;   // True for the routing field (6th byte) of an injected telegram
+  unsigned long timeMicros; // Arrival time
+} type_tpuart_sim_byte;
+
+class KnxTpUartSim : public HardwareSerial {
+#if defined(__AVR__)
+    volatile uint8_t _dummyRegisters[6];    // UART registers given to the AVR HardwareSerial (never used)
+#endif
+    type_tpuart_sim_byte _rxBytes[KNX_TPUART_SIM_RX_SIZE]; // Injected bytes, used circularly
+    byte _rxHead;                           // Oldest injected byte (free running counter)
+    byte _rxTail;                           // Next injected byte (free running counter)
+    unsigned long _rxLastTimeMicros;        // Arrival time of the last injected byte
+    type_SimRxHookFctPtr _rxHook;           // RX hook, NULL in polling mode
+    boolean _inRxHook;                      // True while the RX hook is executed
+    boolean _writing;                       // True while write() is executed
+    unsigned long _routingFieldTimeMicros;  // Arrival time of the last delivered routing field
+    unsigned long _txEndTimeMicros;         // Time the last written character leaves the UART
+    byte _txConfirm;                        // Confirmation of the sent telegrams (0 = no answer)
+    byte _resetMutedNb;                     // Nb of next RESET REQUESTs left unanswered
+    byte _txService;                        // Pending data service (telegram byte expected next), else 0
+    byte _txArgsNb;                         // Nb of arguments expected by the pending SET ADDRESS service
+    KnxTelegram _txTelegram;                // Telegram being sent, then last sent telegram
+    word _txCharsNb;                        // Nb of characters written by the host
+    word _txTelegramsNb;                    // Nb of sent telegrams
+    word _resetsNb;                         // Nb of received RESET REQUESTs
+    word _acksNb[2];                        // Nb of RX ACK services (not addressed, addressed)
+    unsigned long _ackMaxDelayMicros;       // Max delay between a routing field arrival and its ACK service
+    word _nestedWritesNb;                   // Nb of write() calls made during another write()
+
+  public:
+    // Constructor
+    KnxTpUartSim();
+
+  // INLINED functions (see definitions later in this file)
+    // Set the RX hook (UART RX interrupt emulation, see Task()), NULL to come back to polling mode
+    void SetRxHook(type_SimRxHookFctPtr rxHook);
+
+    // Set the confirmation answered to the sent telegrams :
+    // TPUART_DATA_CONFIRM_SUCCESS (default), TPUART_DATA_CONFIRM_FAILED, or 0 (no answer)
+    void SetConfirm(byte confirm);
+
+    // Leave the next requestsNb RESET REQUESTs unanswered (TPUART not powered, e.g. bus off)
+    void SetResetMuted(byte requestsNb);
+
+    // Inject a byte arriving gapMicrosec after the previous injected one (or after now when it has already arrived)
+    void ReceiveByte(byte data, unsigned long gapMicrosec = TPUART_CHAR_TIME_MICROSEC);
+
+    // Inject a telegram : the first byte arrives gapMicrosec after the previous injected byte (or after now),
+    // the following ones are back to back
+    void ReceiveTelegram(const KnxTelegram& telegram, unsigned long gapMicrosec = KNX_TPUART_SIM_TELEGRAM_GAP);
+
+    // Get the nb of injected bytes not delivered yet (arrived or not)
+    byte GetRxPendingNb(void) const;
+
+    // Get the arrival time of the last injected byte
+    unsigned long GetRxLastTime(void) const;
+
+    // Get the nb of characters written by the host
+    word GetWrittenNb(void) const;
+
+    // Get the nb of sent telegrams, and the last sent telegram
+    word GetSentTelegramsNb(void) const;
+    const KnxTelegram& GetSentTelegram(void) const;
+
+    // Get the nb of received RESET REQUESTs
+    word GetResetsNb(void) const;
+
+    // Get the nb of RX ACK services received (addressed or not addressed ones)
+    word GetAcksNb(boolean addressed) const;
+
+    // Get the max delay (in usec) between the arrival of a routing field and the reception of its ACK service
+    unsigned long GetAckMaxDelay(void) const;
+
+    // Get the time the last written character leaves the UART TX buffer
+    unsigned long GetTxEndTime(void) const;
+
+    // Get the nb of write() calls made during another write() (non reentrant serial port writing broken)
+    word GetNestedWritesNb(void) const;
+
+    // Clear the statistics (written characters, sent telegrams, resets, ACK services, nested writes)
+    void ClearStats(void);
+
+    // Deliver the arrived bytes to the RX hook (UART RX interrupt emulation), nothing done in polling mode
+    void Task(void);
+
+  // HardwareSerial functions
+    virtual int available(void);
+    virtual int peek(void);
+    virtual int read(void);
+    virtual int availableForWrite(void);
+    virtual void flush(void);
+    virtual size_t write(uint8_t data);
+    using Print::write;
+
+  private:
+  // Private INLINED functions (see definitions later in this file)
+    // True when the oldest injected byte has arrived
+    boolean IsRxArrived(void) const;
+
+    // Pop the oldest injected byte
+    byte PopRxByte(void);
+
+    // Append a byte arriving at a given time (not before the previous injected byte)
+    void AppendRxByte(byte data, unsigned long timeMicros, boolean isRoutingField = false);
+
+    // Process a character written by the host
+    void TxService(byte data);
+};
+
+
+// ----- Definition of the INLINED functions :  ------------
+
+#if defined(__AVR__)
+inline KnxTpUartSim::KnxTpUartSim()
+: HardwareSerial(&_dummyRegisters[0], &_dummyRegisters[1], &_dummyRegisters[2], &_dummyRegisters[3],
+                 &_dummyRegisters[4], &_dummyRegisters[5])
+#else
+inline KnxTpUartSim::KnxTpUartSim()
+#endif
+{
+  _rxHead = 0;
+  _rxTail = 0;
+  _rxLastTimeMicros = micros();
+  _rxHook = NULL;
+  _inRxHook = false;
+  _writing = false;
+  _routingFieldTimeMicros = 0;
+  _txEndTimeMicros = _rxLastTimeMicros;
+  _txConfirm = TPUART_DATA_CONFIRM_SUCCESS;
+  _resetMutedNb = 0;
+  _txService = 0;
+  _txArgsNb = 0;
+  ClearStats();
+}
+
+inline void KnxTpUartSim::SetRxHook(type_SimRxHookFctPtr rxHook) { _rxHook = rxHook; }
+
+inline void KnxTpUartSim::SetConfirm(byte confirm) { _txConfirm = confirm; }
+
+inline void KnxTpUartSim::SetResetMuted(byte requestsNb) { _resetMutedNb = requestsNb; }
+
+inline void KnxTpUartSim::ReceiveByte(byte data, unsigned long gapMicrosec)
+{
+unsigned long nowTime = micros();
+
+  if ((_rxHead == _rxTail) && ((long)(nowTime - _rxLastTimeMicros) > 0)) _rxLastTimeMicros = nowTime;
+  AppendRxByte(data, _rxLastTimeMicros + gapMicrosec);
+}
+
+inline void KnxTpUartSim::ReceiveTelegram(const KnxTelegram& telegram, unsigned long gapMicrosec)
+{
+  ReceiveByte(telegram.ReadRawByte(0), gapMicrosec);
+  for (byte i = 1; i < telegram.GetTelegramLength(); i++)
+    AppendRxByte(telegram.ReadRawByte(i), _rxLastTimeMicros + TPUART_CHAR_TIME_MICROSEC,
+                 (i == KNX_TELEGRAM_HEADER_SIZE - 1));
+}
+
+inline byte KnxTpUartSim::GetRxPendingNb(void) const { return (byte)(_rxTail - _rxHead); }
+
+inline unsigned long KnxTpUartSim::GetRxLastTime(void) const { return _rxLastTimeMicros; }
+
+inline word KnxTpUartSim::GetWrittenNb(void) const { return _txCharsNb; }
+
+inline word KnxTpUartSim::GetSentTelegramsNb(void) const { return _txTelegramsNb; }
+
+inline const KnxTelegram& KnxTpUartSim::GetSentTelegram(void) const { return _txTelegram; }
+
+inline word KnxTpUartSim::GetResetsNb(void) const { return _resetsNb; }
+
+inline word KnxTpUartSim::GetAcksNb(boolean addressed) const { return _acksNb[addressed ? 1 : 0]; }
+
+inline unsigned long KnxTpUartSim::GetAckMaxDelay(void) const { return _ackMaxDelayMicros; }
+
+inline unsigned long KnxTpUartSim::GetTxEndTime(void) const { return _txEndTimeMicros; }
+
+inline word KnxTpUartSim::GetNestedWritesNb(void) const { return _nestedWritesNb; }
+
+inline void KnxTpUartSim::ClearStats(void)
+{
+  _txCharsNb = 0;
+  _txTelegramsNb = 0;
+  _resetsNb = 0;
+  _acksNb[0] = 0; _acksNb[1] = 0;
+  _ackMaxDelayMicros = 0;
+  _nestedWritesNb = 0;
+}
+
+inline void KnxTpUartSim::Task(void)
+{
+  if ((_rxHook == NULL) || _inRxHook) return; // an interrupt is not nested in itself
+  _inRxHook = true;
+  while (IsRxArrived()) _rxHook(PopRxByte());
+  _inRxHook = false;
+}
+
+inline int KnxTpUartSim::available(void)
+{
+byte nb = 0;
+
+  if (_rxHook) { Task(); return 0; } // the bytes are taken by the RX hook
+  while ((nb < (byte)(_rxTail - _rxHead))
+         && ((long)(micros() - _rxBytes[(byte)(_rxHead + nb) % KNX_TPUART_SIM_RX_SIZE].timeMicros) >= 0)) nb++;
+  return nb;
+}
+
+inline int KnxTpUartSim::peek(void)
+{
+  if (_rxHook || !IsRxArrived()) return -1;
+  return _rxBytes[_rxHead % KNX_TPUART_SIM_RX_SIZE].data;
+}
+
+inline int KnxTpUartSim::read(void)
+{
+  if (_rxHook || !IsRxArrived()) return -1;
+  return PopRxByte();
+}
+
+inline int KnxTpUartSim::availableForWrite(void)
+{
+long pendingMicros = (long)(_txEndTimeMicros - micros());
+
+  Task();
+  if (pendingMicros <= 0) return KNX_TPUART_SIM_TX_BUFFER_SIZE;
+  return KNX_TPUART_SIM_TX_BUFFER_SIZE - (int)((pendingMicros + TPUART_CHAR_TIME_MICROSEC - 1) / TPUART_CHAR_TIME_MICROSEC);
+}
+
+inline void KnxTpUartSim::flush(void) { while ((long)(_txEndTimeMicros - micros()) > 0); }
+
+inline size_t KnxTpUartSim::write(uint8_t data)
+{
+unsigned long nowTime = micros();
+
+  if (_writing) _nestedWritesNb++;
+  _writing = true;
+  // the character leaves the UART once the previous ones are sent
+  if ((long)(nowTime - _txEndTimeMicros) > 0) _txEndTimeMicros = nowTime;
+  _txEndTimeMicros += TPUART_CHAR_TIME_MICROSEC;
+  _txCharsNb++;
+  TxService(data);
+  Task(); // the RX interrupt occurs during the writing
+  _writing = false;
+  return 1;
+}
+
+inline boolean KnxTpUartSim::IsRxArrived(void) const
+{ return (_rxHead != _rxTail) && ((long)(micros() - _rxBytes[_rxHead % KNX_TPUART_SIM_RX_SIZE].timeMicros) >= 0); }
+
+inline byte KnxTpUartSim::PopRxByte(void)
+{
+type_tpuart_sim_byte& rxByte = _rxBytes[_rxHead % KNX_TPUART_SIM_RX_SIZE];
+
+  _rxHead++;
+  if (rxByte.isRoutingField) _routingFieldTimeMicros = rxByte.timeMicros;
+  return rxByte.data;
+}
+
+inline void KnxTpUartSim::AppendRxByte(byte data, unsigned long timeMicros, boolean isRoutingField)
+{
+type_tpuart_sim_byte& rxByte = _rxBytes[_rxTail % KNX_TPUART_SIM_RX_SIZE];
+
+  if ((byte)(_rxTail - _rxHead) == KNX_TPUART_SIM_RX_SIZE) return; // full, the byte is lost
+  if ((long)(timeMicros - _rxLastTimeMicros) < 0) timeMicros = _rxLastTimeMicros;
+  rxByte.data = data;
+  rxByte.isRoutingField = isRoutingField;
+  rxByte.timeMicros = timeMicros;
+  _rxLastTimeMicros = timeMicros;
+  _rxTail++;
+}
+
+inline void KnxTpUartSim::TxService(byte data)
+{
+unsigned long ackDelay;
+
+  if (_txArgsNb) { _txArgsNb--; return; } // SET ADDRESS argument
+  if (_txService)
+  { // data byte of the telegram being sent
+    _txTelegram.WriteRawByte(data, _txService & 0x3F);
+    if ((_txService & 0xC0) == TPUART_DATA_END_REQ)
+    { // telegram completed : repeated on the bus, then confirmed
+      _txTelegramsNb++;
+      if ((long)(_txEndTimeMicros - _rxLastTimeMicros) > 0) _rxLastTimeMicros = _txEndTimeMicros;
+      ReceiveTelegram(_txTelegram);
+      if (_txConfirm) ReceiveByte(_txConfirm, KNX_TPUART_SIM_TELEGRAM_GAP);
+    }
+    _txService = 0;
+    return;
+  }
+  switch (data)
+  {
+    case TPUART_RESET_REQ : // the bytes not arrived yet are lost
+      _resetsNb++;
+      if (_resetMutedNb) { _resetMutedNb--; break; } // no answer
+      _rxTail = _rxHead + (byte) available();
+      _rxLastTimeMicros = micros();
+      AppendRxByte(TPUART_RESET_INDICATION, _rxLastTimeMicros);
+      break;
+
+    case TPUART_STATE_REQ : ReceiveByte(TPUART_STATE_INDICATION); break;
+
+    case TPUART_SET_ADDR_REQ : _txArgsNb = 2; break;
+
+    case TPUART_RX_ACK_SERVICE_ADDRESSED :
+    case TPUART_RX_ACK_SERVICE_NOT_ADDRESSED :
+      _acksNb[data & 0x01]++;
+      ackDelay = micros() - _routingFieldTimeMicros;
+      if (ackDelay > _ackMaxDelayMicros) _ackMaxDelayMicros = ackDelay;
+      break;
+
+    default :
+      if ( (((data & 0xC0) == TPUART_DATA_START_CONTINUE_REQ) || ((data & 0xC0) == TPUART_DATA_END_REQ))
+           && ((data & 0x3F) < KNX_TELEGRAM_MAX_SIZE) ) _txService = data; // data start/continue/end
+      break;
+  }
+}
+
+#endif // KNXTPUARTSIM_H
@@ -0,0 +1,157 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : SpscRingBuffer.h
+// Author : Franck Marini
+// Description : Implementation of a lock-free single producer / single consumer ring buffer
+// Module dependencies : none
+
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include "Arduino.h"
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// #define SPSCRINGBUFFER_STAT // To be uncommented when doing Statistics
+
+
+// The type of the contained elements and the ring buffer size are defined at compile time (template)
+// The size shall be a power of 2, up to 32768 elements
+//
+// Contrary to ActionRingBuffer, the buffer can be used by 2 different execution contexts
+// (e.g. an interrupt routine and the arduino loop, or 2 threads on a linux host) :
+// - one single context (the producer) calls TryAppend()
+// - one single context (the consumer) calls Pop()
+// The producer only writes _tail and the consumer only writes _head, so no lock is needed.
+// In case of buffer full, the appended data is rejected (no overwrite) so that the producer
+// never writes a location the consumer may be reading.
+
+template<typename T, word size>
+class SpscRingBuffer {
+    static_assert((size >= 2) && (size <= 32768) && !(size & (size - 1)), "SpscRingBuffer size shall be a power of 2");
+
+    // The indexes are free running counters, the position in the buffer is obtained by masking
+    // The number of elements is (_tail - _head), the buffer is full when it equals size
+    volatile word _head; // written by the consumer only
+    volatile word _tail; // written by the producer only
+    T _buffer[size]; // elements buffer
+#ifdef SPSCRINGBUFFER_STAT
+    word _elementsMaxNb;  // written by the producer only
+    word _rejectedElementsNb; // written by the producer only
+#endif
+
+  public :
+
+    // Constructor
+    SpscRingBuffer()
+    {
+      _head = 0;
+      _tail = 0;
+    #ifdef SPSCRINGBUFFER_STAT
+      _elementsMaxNb = 0; // MAX nb of elements
+      _rejectedElementsNb = 0; // nb of rejected elements
+    #endif
+    };
+
+
+    // Append a data in the buffer (PRODUCER side). TryAppend() increments the "tail"
+    // Return FALSE when the buffer is full (the data is not appended), otherwise TRUE
+    boolean TryAppend(const T& appendedData)
+    {
+      word tail = _tail; // owned by the producer
+      if ((word)(tail - LoadIndex(_head)) >= size)
+      { // buffer full, the consumer is late
+    #ifdef SPSCRINGBUFFER_STAT
+        _rejectedElementsNb++;
+    #endif
+        return false;
+      }
+      _buffer[tail & (size - 1)] = appendedData;
+      StoreIndex(_tail, tail + 1); // publish the data to the consumer
+    #ifdef SPSCRINGBUFFER_STAT
+      if ((word)(tail + 1 - LoadIndex(_head)) > _elementsMaxNb) _elementsMaxNb = (word)(tail + 1 - LoadIndex(_head));
+    #endif
+      return true;
+    }
+
+
+    // Pop a data from the buffer (CONSUMER side). Pop() increments the "head"
+    // Return TRUE when a data is available, otherwise FALSE
+    boolean Pop(T& popData)
+    {
+      word head = _head; // owned by the consumer
+      if (head == LoadIndex(_tail)) return false; // no data in the buffer
+      popData = _buffer[head & (size - 1)];
+      StoreIndex(_head, head + 1); // release the location to the producer
+      return true;
+    }
+
+
+    // Return a pointer to the oldest data of the buffer (CONSUMER side), NULL when the buffer is empty
+    // The data stays in the buffer (and owned by the consumer) until Pop() is called
+    const T* Front(void) const
+    {
+      word head = _head; // owned by the consumer
+      if (head == LoadIndex(_tail)) return NULL; // no data in the buffer
+      return &_buffer[head & (size - 1)];
+    }
+
+
+    // Return the current number of data elements in the ring buffer
+    // NB : the value is a snapshot, it may change right after the call
+    word ElementsNb(void) const { return (word)(LoadIndex(_tail) - LoadIndex(_head)); }
+
+
+    // Return the ring buffer capacity
+    word Capacity(void) const { return size; }
+
+
+    #ifdef SPSCRINGBUFFER_STAT
+    // Return Stat information
+    void Info(String& str) const
+    {
+      str += "Elements Current Nb : " + String(ElementsNb(),DEC);
+      str += "\nElements Max Nb : " + String(_elementsMaxNb,DEC);
+      str += "\nRejected Elements Nb : " + String(_rejectedElementsNb,DEC);
+      str += "\n";
+    }
+    #endif
+
+  private :
+
+#if defined(__AVR__)
+    // 8-bit AVR : a 16-bit read/write is not atomic, we protect it against interrupts
+    // SREG is restored (rather than calling interrupts()) so that the function can be called from an ISR
+    static word LoadIndex(const volatile word& index)
+    { byte sreg = SREG; cli(); word value = index; SREG = sreg; return value; }
+
+    static void StoreIndex(volatile word& index, word value)
+    { byte sreg = SREG; cli(); index = value; SREG = sreg; }
+#else
+    // 32-bit targets and hosts : acquire/release ordering makes the data written before the index visible
+    // to the other context
+    static word LoadIndex(const volatile word& index)
+    { return __atomic_load_n(&index, __ATOMIC_ACQUIRE); }
+
+    static void StoreIndex(volatile word& index, word value)
+    { __atomic_store_n(&index, value, __ATOMIC_RELEASE); }
+#endif
+};
+
+#endif // SPSCRINGBUFFER_H
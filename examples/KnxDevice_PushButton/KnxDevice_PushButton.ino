@@ -11,14 +11,13 @@
 
 #include <KnxDevice.h>
 
-// Definition of the Communication Objects attached to the device
-KnxComObject KnxDevice::_comObjectsList[] =
-{
-  /* Index 0 */ KnxComObject(G_ADDR(0,0,1), KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_SENSOR  /* Sensor Output */ ) ,
-  /* Index 1 */ KnxComObject(G_ADDR(0,0,2), KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_LOGIC_IN_INIT /* Logical Input Object with Init Read */) , 
-};
+// Definition of the Communication Objects attached to the device (handle name, address, DPT, flags)
+// NB : the objects and their address index are built at compile time (see KnxComObjectTable.h)
+#define PUSH_BUTTON_COM_OBJECTS(OBJ) \
+  OBJ(SWITCH_CMD,    G_ADDR(0,0,1), KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */, COM_OBJ_SENSOR /* Sensor Output */) \
+  OBJ(SWITCH_STATUS, G_ADDR(0,0,2), KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */, COM_OBJ_LOGIC_IN_INIT /* Logical Input Object with Init Read */)
 
-const byte KnxDevice::_comObjectsNb = sizeof(_comObjectsList) / sizeof(KnxComObject); // do no change this code
+KNX_DEVICE_COM_OBJECTS(PUSH_BUTTON_COM_OBJECTS)
 
 // function and variables to manage push button signal debounce
 static inline word TimeDeltaWord(word now, word before) { return (word)(now - before); }
@@ -40,7 +39,7 @@ void setup(){
 void loop(){ 
   Knx.task();
   if (debounce && (TimeDeltaWord((word)millis(), debounceStartTime)> 500 /* ms */)) debounce = false;
-  if (pressed) { pressed=false; Knx.write(0,!Knx.read(1)); }
+  if (pressed) { pressed=false; Knx.write(SWITCH_CMD, !Knx.read(SWITCH_STATUS)); }
 }
 
 
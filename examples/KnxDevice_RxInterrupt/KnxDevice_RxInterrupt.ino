@@ -0,0 +1,67 @@
+// KNX switch actuator using KnxDevice library in RX INTERRUPT mode
+// The bytes received from the TPUART are handed to the KNX device by a timer interrupt, with their arrival time :
+// the End Of Packets are detected from the real gaps between the bytes, even when the loop is temporarily slow.
+
+// Required environment :
+// - "KNXTPUART_RX_INTERRUPT" flag set in KnxTpUart.h file
+// - a KNX network with a TPUART board and a push button device
+// - ComObject 0.0.1 is the command of the switch (configuration performed with ETS)
+// - ComObject 0.0.2 is the feedback status of the switch (configuration performed with ETS)
+// - Arduino MEGA with its Serial1 UART connected to HW TPUART interface (Timer2 is used by the example)
+// - the switched load (or a LED) connected to digital port 13
+
+#include <KnxDevice.h>
+
+#if !defined(KNXTPUART_RX_INTERRUPT)
+#error "KNXTPUART_RX_INTERRUPT flag shall be set in KnxTpUart.h for this example"
+#endif
+
+// Definition of the Communication Objects attached to the device (handle name, address, DPT, flags)
+#define SWITCH_COM_OBJECTS(OBJ) \
+  OBJ(SWITCH_CMD,    G_ADDR(0,0,1), KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */, COM_OBJ_LOGIC_IN /* Logical Input Object */) \
+  OBJ(SWITCH_STATUS, G_ADDR(0,0,2), KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */, COM_OBJ_SENSOR /* Sensor Output */)
+
+KNX_DEVICE_COM_OBJECTS(SWITCH_COM_OBJECTS)
+
+
+// UART RX interrupt hook : Timer2 compare interrupt every 256us
+// The Arduino core owns the UART RX interrupt, so the UART RX buffer is drained by a timer interrupt shorter than
+// a character time (0,57ms) : the arrival time of each byte is known within 256us.
+// NB : the ACK services are written by the interrupt too (or by Knx.task() when the interrupt occurs while it
+// writes the serial port), so the telegrams are acknowledged in time even when the loop is temporarily slow
+ISR(TIMER2_COMPA_vect)
+{
+  while (Serial1.available()) Knx.rxInterrupt(Serial1.read());
+}
+
+
+void StartRxInterrupt(void)
+{
+  TCCR2A = _BV(WGM21); // CTC mode
+  TCCR2B = _BV(CS22);  // prescaler 64 : 4us per tick (16MHz)
+  OCR2A = 63;          // 64 ticks : 256us
+  TIMSK2 = _BV(OCIE2A);
+}
+
+
+// Callback function to handle com objects updates
+void knxEvents(byte index) {
+  if (index == SWITCH_CMD)
+  {
+    digitalWrite(13, Knx.read(SWITCH_CMD));
+    Knx.write(SWITCH_STATUS, Knx.read(SWITCH_CMD));
+  }
+}
+
+
+void setup(){
+  pinMode(13, OUTPUT);
+  // the interrupt is started before Knx.begin() : the TPUART reset indication is received through it
+  StartRxInterrupt();
+  Knx.begin(Serial1, P_ADDR(1,1,2)); // start a KnxDevice session with physical address 1.1.2 on Serial1 UART
+}
+
+
+void loop(){
+  Knx.task();
+}
@@ -0,0 +1,160 @@
+#include <KnxAddressIndex.h>
+#include <new.h>
+#include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
+
+// WARNING : a board with enough RAM (e.g. MEGA 2560) is required for the 255 objects tests
+// The dispatch test goes up to 4096 objects when KNX_COM_OBJ_16BIT_INDEX flag is on (see KnxComObject.h),
+// a 32 bits board with about 80KB of RAM is then required
+// The tests run with the binary search, or with the presence bitmap when KNX_ADDRESS_INDEX_BITMAP flag is on
+// (see KnxAddressIndex.h)
+
+Cli cli = Cli(Serial);
+
+void Check(void);    // Compare the index lookup with a linear search, on all the group addresses
+void Bench16(void);  // Worst-case lookup time with 16 objects
+void Bench128(void); // Worst-case lookup time with 128 objects
+void Bench255(void); // Worst-case lookup time with 255 objects
+void Dispatch(void); // Mean dispatch time of a received telegram, from 16 objects to the max list size
+void AllTests(void);
+
+
+void setup() {
+  cli.RegisterCmd("check",&Check);
+  cli.RegisterCmd("b16",&Bench16);
+  cli.RegisterCmd("b128",&Bench128);
+  cli.RegisterCmd("b255",&Bench255);
+  cli.RegisterCmd("dispatch",&Dispatch);
+  cli.RegisterCmd("all",&AllTests);
+  Serial.begin(115200);
+}
+
+
+void loop() {
+  cli.Run();
+}
+
+
+// Create a list of sensor objects with random addresses (some of them duplicated)
+KnxComObject* CreateList(type_com_obj_index nb)
+{
+  KnxComObject* list = (KnxComObject*) malloc(nb * sizeof(KnxComObject));
+  if (list == NULL) { Serial.println(F("Not enough memory!")); return NULL; }
+  randomSeed(nb);
+  for (type_com_obj_index i = 0; i < nb; i++) new (&list[i]) KnxComObject((word) random(0, 4L * nb), KNX_DPT_1_001, COM_OBJ_SENSOR);
+  return list;
+}
+
+
+void Check(void) {
+  KnxComObject* list = CreateList(128);
+  KnxAddressIndex index;
+  unsigned long errorsNb = 0;
+  type_com_obj_index firstEntry, foundNb, expectedNb;
+  if (list == NULL) return;
+  index.Build(list, 128);
+  Serial.print(F("Entries nb : ")); Serial.print(index.GetEntriesNb());
+  Serial.print(F(", duplicates nb : ")); Serial.println(index.GetDuplicatesNb());
+  for (long addr = 0; addr < 0x10000; addr++)
+  {
+    foundNb = index.Find((word) addr, firstEntry);
+    expectedNb = 0;
+    for (type_com_obj_index i = 0; i < 128; i++)
+    {
+      if (list[i].GetAddr() != addr) continue;
+      // all the objects sharing the address are found, by increasing index
+      if ((expectedNb >= foundNb) || (index.GetComObjectIndex(firstEntry + expectedNb) != i)) errorsNb++;
+      expectedNb++;
+    }
+    if (foundNb != expectedNb) errorsNb++;
+  }
+  Serial.print(F("Lookup errors : ")); Serial.println(errorsNb);
+  free(list);
+}
+
+
+// The lookup duration is measured with Timer1 counting the CPU cycles (no prescaler)
+void Bench(byte nb) {
+  KnxComObject* list = CreateList(nb);
+  KnxAddressIndex index;
+  word start, cycles, overhead, maxCycles = 0, maxAddr = 0;
+  unsigned long buildTime;
+  type_com_obj_index firstEntry;
+  if (list == NULL) return;
+  buildTime = micros();
+  index.Build(list, nb);
+  buildTime = micros() - buildTime;
+  noInterrupts();
+  TCCR1A = 0; TCCR1B = _BV(CS10); // CPU clock
+  start = TCNT1; overhead = TCNT1 - start;
+  for (word addr = 0; addr < 4 * nb + 16; addr++) // assigned and not assigned addresses
+  {
+    start = TCNT1;
+    index.Find(addr, firstEntry);
+    cycles = TCNT1 - start - overhead;
+    if (cycles > maxCycles) { maxCycles = cycles; maxAddr = addr; }
+  }
+  interrupts();
+  Serial.print(F("Objects nb : ")); Serial.print(nb);
+  Serial.print(F(", build time (us) : ")); Serial.print(buildTime);
+  Serial.print(F(", worst-case lookup cycles : ")); Serial.print(maxCycles);
+  Serial.print(F(" (addr ")); Serial.print(maxAddr, HEX); Serial.println(F(")"));
+  free(list);
+}
+
+
+void Bench16(void) { Bench(16); }
+
+
+void Bench128(void) { Bench(128); }
+
+
+void Bench255(void) { Bench(255); }
+
+
+// Dispatch of a burst of telegrams : lookup of the target address, then access to each targeted object
+// (as done by the TPUART and KnxDevice layers), the duration is measured with micros()
+void Dispatch(type_com_obj_index nb) {
+  KnxComObject* list = CreateList(nb);
+  KnxAddressIndex index;
+  unsigned long start, duration;
+  type_com_obj_index firstEntry, targetedNb;
+  word telegramsNb = 0, targetsNb = 0;
+  byte indicators = 0;
+  if (list == NULL) return;
+  index.Build(list, nb);
+  start = micros();
+  for (word i = 0; i < 1024; i++)
+  { // 3 telegrams out of 4 target assigned addresses
+    word addr = (i & 3) ? list[(i * 97UL) % nb].GetAddr() : (word) (4L * nb + i);
+    targetedNb = index.Find(addr, firstEntry);
+    for (type_com_obj_index rank = 0; rank < targetedNb; rank++)
+      indicators |= list[index.GetComObjectIndex(firstEntry + rank)].GetIndicator();
+    telegramsNb++; targetsNb += targetedNb;
+  }
+  duration = micros() - start;
+  Serial.print(F("Objects nb : ")); Serial.print(nb);
+  Serial.print(F(", targeted objects : ")); Serial.print(targetsNb);
+  Serial.print(F(", dispatch time per telegram (us) : ")); Serial.print((float) duration / telegramsNb);
+  Serial.print(F(" (indicators ")); Serial.print(indicators, HEX); Serial.println(F(")"));
+  free(list);
+}
+
+
+void Dispatch(void) {
+  Dispatch(16);
+  Dispatch(64);
+  Dispatch(255);
+#if defined(KNX_COM_OBJ_16BIT_INDEX)
+  Dispatch(1024);
+  Dispatch(4096);
+#endif
+}
+
+
+void AllTests(void) {
+  Check();
+  Bench16();
+  Bench128();
+  Bench255();
+  Dispatch();
+}
@@ -0,0 +1,170 @@
+#include <KnxDevice.h>
+#include <new.h>
+#include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
+
+Cli cli = Cli(Serial);
+
+// Com objects list declared at compile time : shared addresses (0/0/1), unsorted addresses,
+// and objects without communication attribute (not indexed)
+#define TEST_COM_OBJECTS(OBJ) \
+  OBJ(IN_A,   G_ADDR(0,0,1), KNX_DPT_1_001,  COM_OBJ_LOGIC_IN) \
+  OBJ(TEMP,   G_ADDR(0,0,9), KNX_DPT_9_001,  COM_OBJ_SENSOR) \
+  OBJ(LOCAL,  G_ADDR(0,0,0), KNX_DPT_14_000, 0) \
+  OBJ(OUT,    G_ADDR(0,0,3), KNX_DPT_1_001,  COM_OBJ_SENSOR) \
+  OBJ(IN_B,   G_ADDR(0,0,1), KNX_DPT_1_001,  COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(COUNT,  G_ADDR(2,1,7), KNX_DPT_12_001, COM_OBJ_SENSOR) \
+  OBJ(FB,     G_ADDR(0,0,1), KNX_DPT_1_001,  COM_OBJ_SENSOR)
+
+KNX_DEVICE_COM_OBJECTS(TEST_COM_OBJECTS)
+
+// Compile time checks
+static_assert(KnxComObjectsNb_ == 7, "wrong objects nb");
+static_assert((TEMP == 1) && (FB == 6), "wrong handles");
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::EntriesNb() == 6, "wrong entries nb");
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::AddressesNb() == 4, "wrong addresses nb");
+static_assert(KnxDPTLength(KNX_DPT_12_001) == 5, "wrong length");
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::LongValuesSize(KnxComObjectsNb_) == 10, "wrong arena size");
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::LongValuesSize(COUNT) == 6, "wrong arena position");
+
+void knxEvents(type_com_obj_index index) {}
+
+void Check(void);    // Compare the flash index lookup with a linear search, on all the group addresses
+void Entries(void);  // Print the flash index entries
+void Bench(void);    // Worst-case lookup time, flash index vs index built at runtime
+void Ram(void);      // RAM used by the com objects, long values arena
+void AllTests(void);
+
+
+void setup() {
+  cli.RegisterCmd("check",&Check);
+  cli.RegisterCmd("entries",&Entries);
+  cli.RegisterCmd("bench",&Bench);
+  cli.RegisterCmd("ram",&Ram);
+  cli.RegisterCmd("all",&AllTests);
+  Serial.begin(115200);
+}
+
+
+void loop() {
+  cli.Run();
+}
+
+
+void Check(void) {
+  KnxAddressIndex index;
+  unsigned long errorsNb = 0;
+  type_com_obj_index firstEntry, foundNb, expectedNb;
+  index.Attach(knxComObjectsAddressIndex);
+  Serial.print(F("Entries nb : ")); Serial.print(index.GetEntriesNb());
+  Serial.print(F(", duplicates nb : ")); Serial.println(index.GetDuplicatesNb());
+  for (long addr = 0; addr < 0x10000; addr++)
+  {
+    foundNb = index.Find((word) addr, firstEntry);
+    expectedNb = 0;
+    for (type_com_obj_index i = 0; i < KnxComObjectsNb_; i++)
+    {
+      if ((KnxComObjectsAttr_::list[i].addr != addr) || !(KnxComObjectsAttr_::list[i].indicator & KNX_COM_OBJ_C_INDICATOR)) continue;
+      // all the objects sharing the address are found, by increasing index
+      if ((expectedNb >= foundNb) || (index.GetComObjectIndex(firstEntry + expectedNb) != i)) errorsNb++;
+      expectedNb++;
+    }
+    if (foundNb != expectedNb) errorsNb++;
+  }
+  Serial.print(F("Lookup errors : ")); Serial.println(errorsNb);
+}
+
+
+void Entries(void) {
+  for (type_com_obj_index i = 0; i < knxComObjectsAddressIndex.entriesNb; i++)
+  {
+    Serial.print(F("Entry ")); Serial.print(i);
+    Serial.print(F(" : addr ")); Serial.print(pgm_read_word(&knxComObjectsAddressIndex.entries[i].addr), HEX);
+    Serial.print(F(", index ")); Serial.println(pgm_read_com_obj_index(&knxComObjectsAddressIndex.entries[i].index));
+  }
+}
+
+
+// The lookup duration is measured with Timer1 counting the CPU cycles (no prescaler)
+word WorstLookupCycles(const KnxAddressIndex& index) {
+  word start, cycles, overhead, maxCycles = 0;
+  type_com_obj_index firstEntry;
+  noInterrupts();
+  TCCR1A = 0; TCCR1B = _BV(CS10); // CPU clock
+  start = TCNT1; overhead = TCNT1 - start;
+  for (word addr = 0; addr < 0x1120; addr++) // assigned and not assigned addresses
+  {
+    start = TCNT1;
+    index.Find(addr, firstEntry);
+    cycles = TCNT1 - start - overhead;
+    if (cycles > maxCycles) maxCycles = cycles;
+  }
+  interrupts();
+  return maxCycles;
+}
+
+
+void Bench(void) {
+  KnxAddressIndex flashIndex, ramIndex;
+  unsigned long buildTime;
+  // same objects as the compile time list, for the index built at runtime
+  KnxComObject* list = (KnxComObject*) malloc(KnxComObjectsNb_ * sizeof(KnxComObject));
+  if (list == NULL) { Serial.println(F("Not enough memory!")); return; }
+  for (type_com_obj_index i = 0; i < KnxComObjectsNb_; i++)
+    new (&list[i]) KnxComObject(KnxComObjectsAttr_::list[i].addr, KNX_DPT_1_001, KnxComObjectsAttr_::list[i].indicator);
+  buildTime = micros();
+  flashIndex.Attach(knxComObjectsAddressIndex);
+  buildTime = micros() - buildTime;
+  Serial.print(F("Flash index : attach time (us) : ")); Serial.print(buildTime);
+  Serial.print(F(", worst-case lookup cycles : ")); Serial.println(WorstLookupCycles(flashIndex));
+  buildTime = micros();
+  ramIndex.Build(list, KnxComObjectsNb_);
+  buildTime = micros() - buildTime;
+  Serial.print(F("RAM index : build time (us) : ")); Serial.print(buildTime);
+  Serial.print(F(", worst-case lookup cycles : ")); Serial.println(WorstLookupCycles(ramIndex));
+  free(list);
+}
+
+
+// The long values (TEMP 2 bytes, LOCAL 4 bytes, COUNT 4 bytes) are in the arena sized at compile time :
+// 10 bytes, no heap use
+// With KNX_COM_OBJ_PACKED_TABLE flag on, the values arena holds the long values (no short value other than B1
+// in the list), and the validity flags and the 4 B1 values take 1 byte each
+// A standalone long com object gets its data space from the constructor : without data space, its value
+// cannot be updated and UpdateValue() returns an error
+void Ram(void) {
+  byte longValue[4], value[4] = { 0x12, 0x34, 0x56, 0x78 }, readValue[4];
+  KnxComObject withSpace(longValue, G_ADDR(0,0,5), KNX_DPT_12_001, COM_OBJ_LOGIC_IN_INIT);
+  KnxComObject withoutSpace(G_ADDR(0,0,5), KNX_DPT_12_001, COM_OBJ_LOGIC_IN_INIT);
+  KnxTelegram tg;
+  word errorsNb = 0;
+  Serial.print(F("Com objects RAM size : ")); Serial.print(Knx.getComObjectsRamSize());
+#ifdef KNX_COM_OBJ_PACKED_TABLE
+  Serial.print(F(" (packed table ")); Serial.print(sizeof(KnxPackedComObjects));
+  Serial.print(F(", validity bits ")); Serial.print(sizeof(knxComObjectsValidityBits_));
+  Serial.print(F(", B1 values bits ")); Serial.print(sizeof(knxComObjectsB1Bits_));
+  Serial.print(F(", values arena ")); Serial.print(sizeof(knxComObjectsValues_) - 1); Serial.println(F(")"));
+  if (Knx.getComObjectsRamSize() != sizeof(KnxPackedComObjects) + 1 + 1 + 10) errorsNb++;
+#else
+  Serial.print(F(" (objects ")); Serial.print(KnxComObjectsNb_ * sizeof(KnxComObject));
+  Serial.print(F(", long values arena ")); Serial.print(sizeof(knxComObjectsLongValues_) - 1); Serial.println(F(")"));
+  if (Knx.getComObjectsRamSize() != KnxComObjectsNb_ * sizeof(KnxComObject) + 10) errorsNb++;
+#endif
+  // standalone long com objects
+  if (withSpace.UpdateValue(value) != KNX_COM_OBJECT_OK) errorsNb++;
+  withSpace.GetValue(readValue);
+  if (memcmp(readValue, value, sizeof(value)) || !withSpace.GetValidity()) errorsNb++;
+  if (withoutSpace.UpdateValue(value) != KNX_COM_OBJECT_ERROR) errorsNb++;
+  withSpace.CopyToTelegram(tg, KNX_COMMAND_VALUE_WRITE);
+  if (withoutSpace.UpdateValue(tg) != KNX_COM_OBJECT_ERROR) errorsNb++;
+  withoutSpace.GetValue(readValue);
+  if (readValue[0] || readValue[3] || withoutSpace.GetValidity()) errorsNb++;
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void AllTests(void) {
+  Check();
+  Entries();
+  Bench();
+  Ram();
+}
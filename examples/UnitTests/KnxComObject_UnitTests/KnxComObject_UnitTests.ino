@@ -6,6 +6,8 @@ Cli cli = Cli(Serial);
 void KNX_DPT_1_001_Tests(void); // 1 bit COM OBJ tests (1.001 B1 DPT_Switch)
 void KNX_DPT_4_001_Tests(void); // 1 byte COM OBJ tests (4.001 A8 DPT_Char_ASCII)
 void KNX_DPT_7_001_Tests(void); // 2 bytes COM OBJ tests (7.001 U16 DPT_Value_2_Ucount)
+void Ram(void);                 // RAM size of a com object, pre-encoded header part
+void Bench(void);               // WRITE telegram build time, from the pre-encoded header vs field by field
 void AllTests(void);
 
 
@@ -13,6 +15,8 @@ void setup(){
   cli.RegisterCmd("dpt1",&KNX_DPT_1_001_Tests);
   cli.RegisterCmd("dpt4",&KNX_DPT_4_001_Tests);
   cli.RegisterCmd("dpt7",&KNX_DPT_7_001_Tests);
+  cli.RegisterCmd("ram",&Ram);
+  cli.RegisterCmd("bench",&Bench);
   cli.RegisterCmd("all",&AllTests);
   Serial.begin(115200);
 }
@@ -120,15 +124,18 @@ void KNX_DPT_7_001_Tests(void)
     Serial.println(F("\n########## KNX_DPT_7_001 Tests ##########"));
     
     Serial.println(F("\n### KNX_DPT_7_001 SENSOR object creation :"));
-    KnxComObject sensor(0x1234,KNX_DPT_7_001,COM_OBJ_SENSOR);
+    byte sensorValue[2] = {0};
+    KnxComObject sensor(sensorValue,0x1234,KNX_DPT_7_001,COM_OBJ_SENSOR);
     PrintComObjInfo(sensor, traces);
     
     Serial.println(F("\n### KNX_DPT_7_001 LOGIC INPUT object creation :"));
-    KnxComObject logicIn(0x1234,KNX_DPT_7_001,COM_OBJ_LOGIC_IN);
+    byte logicInValue[2] = {0};
+    KnxComObject logicIn(logicInValue,0x1234,KNX_DPT_7_001,COM_OBJ_LOGIC_IN);
     PrintComObjInfo(logicIn, traces);
     
     Serial.println(F("\n### KNX_DPT_7_001 LOGIC INPUT WITH INIT object creation :"));
-    KnxComObject logicInInit(0x1234,KNX_DPT_7_001,COM_OBJ_LOGIC_IN_INIT);
+    byte logicInInitValue[2] = {0};
+    KnxComObject logicInInit(logicInInitValue,0x1234,KNX_DPT_7_001,COM_OBJ_LOGIC_IN_INIT);
     PrintComObjInfo(logicInInit, traces);
 
     Serial.println(F("\n### KNX_DPT_7_001 LOGIC INPUT WITH INIT object update value (0xABCD) :"));
@@ -148,6 +155,79 @@ void KNX_DPT_7_001_Tests(void)
     tg.SetLongPayload(val2,2);
     logicInInit.UpdateValue(tg);
     PrintComObjInfo(logicInInit, traces); 
+
+    Serial.println(F("\n### KNX_DPT_7_001 LOGIC INPUT WITH INIT build WRITE telegram from header (src 0x1101, 0xAABB, valid checksum) :"));
+    logicInInit.SetSourceAddress(0x1101);
+    logicInInit.CopyToTelegram(tg, KNX_COMMAND_VALUE_WRITE);
+    PrintTelegramInfo(tg, traces);
+    Serial.println(F("\n### KNX_DPT_7_001 LOGIC INPUT WITH INIT build READ telegram from header (cleared payload, valid checksum) :"));
+    logicInInit.CopyToTelegram(tg, KNX_COMMAND_VALUE_READ);
+    PrintTelegramInfo(tg, traces);
+}
+
+
+// A com object stores the pre-encoded header of its telegrams (KNX_TELEGRAM_HEADER_SIZE bytes) and its XOR sum,
+// the group address being stored in the header only : the header costs 6 + 1 - 2 = 5 bytes per com object.
+// On AVR (no padding), a com object takes 13 bytes (15 bytes with KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES flag on) :
+// header 6, XOR sum 1, DPT 1, indicator 1, length 1, (priority enum 2), validity 1, value or value pointer 2,
+// i.e. 8 bytes (10 bytes) without the pre-encoded header.
+void Ram(void)
+{
+  word errorsNb = 0;
+  const byte headerSize = KNX_TELEGRAM_HEADER_SIZE + 1 - sizeof(word);
+  Serial.print(F("KnxComObject size : ")); Serial.print(sizeof(KnxComObject));
+  Serial.print(F(", pre-encoded header part : ")); Serial.print(headerSize);
+  Serial.print(F(", without pre-encoded header : ")); Serial.println(sizeof(KnxComObject) - headerSize);
+  if (headerSize != 5) errorsNb++;
+#if defined(__AVR__)
+#ifdef KNX_COM_OBJ_SUPPORT_ALL_PRIORITIES
+  if (sizeof(KnxComObject) != 15) errorsNb++;
+#else
+  if (sizeof(KnxComObject) != 13) errorsNb++;
+#endif
+#endif
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+// The build duration is measured with Timer1 counting the CPU cycles (no prescaler)
+// The field by field build is the one used before the pre-encoded headers (attributes, value, command, checksum)
+word BuildCycles(KnxComObject& obj, KnxTelegram& tg, boolean fromHeader)
+{
+  word start, cycles;
+  noInterrupts();
+  start = TCNT1;
+  if (fromHeader) obj.CopyToTelegram(tg, KNX_COMMAND_VALUE_WRITE);
+  else
+  {
+    obj.CopyAttributes(tg);
+    obj.CopyValue(tg);
+    tg.SetCommand(KNX_COMMAND_VALUE_WRITE);
+    tg.UpdateChecksum();
+  }
+  cycles = TCNT1 - start;
+  interrupts();
+  return cycles;
+}
+
+
+void Bench(void)
+{
+  byte longValue[4] = { 0x12, 0x34, 0x56, 0x78 };
+  KnxComObject b1(0x1234, KNX_DPT_1_001, COM_OBJ_SENSOR);
+  KnxComObject u32(longValue, 0x1235, KNX_DPT_12_001, COM_OBJ_SENSOR);
+  KnxTelegram headerTg, fieldsTg;
+  word errorsNb = 0;
+  TCCR1A = 0; TCCR1B = _BV(CS10); // CPU clock
+  b1.SetSourceAddress(0x1101); u32.SetSourceAddress(0x1101);
+  headerTg.SetSourceAddress(0x1101); fieldsTg.SetSourceAddress(0x1101); // source address set once by KnxTpUart
+  Serial.print(F("B1 WRITE build cycles : from header ")); Serial.print(BuildCycles(b1, headerTg, true));
+  Serial.print(F(", field by field ")); Serial.println(BuildCycles(b1, fieldsTg, false));
+  for (byte i = 0; i < KNX_TELEGRAM_MAX_SIZE; i++) if (headerTg.ReadRawByte(i) != fieldsTg.ReadRawByte(i)) errorsNb++;
+  Serial.print(F("U32 WRITE build cycles : from header ")); Serial.print(BuildCycles(u32, headerTg, true));
+  Serial.print(F(", field by field ")); Serial.println(BuildCycles(u32, fieldsTg, false));
+  for (byte i = 0; i < KNX_TELEGRAM_MAX_SIZE; i++) if (headerTg.ReadRawByte(i) != fieldsTg.ReadRawByte(i)) errorsNb++;
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
 }
 
 
@@ -156,5 +236,7 @@ void AllTests(void)
 KNX_DPT_1_001_Tests();
 KNX_DPT_4_001_Tests();
 KNX_DPT_7_001_Tests();
+Ram();
+Bench();
 }
 
@@ -0,0 +1,1018 @@
+// KnxDevice unit tests, run on a simulated TPUART link (KnxTpUartSim) : no TPUART needed
+// NB : the tests are valid in polling and in RX INTERRUPT modes (KNXTPUART_RX_INTERRUPT flag)
+
+#include <KnxDevice.h>
+#include <KnxTpUartSim.h>
+#include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
+
+Cli cli = Cli(Serial);
+KnxTpUartSim tpuartSim;
+
+// Definition of the Communication Objects attached to the device
+#define TEST_COM_OBJECTS(OBJ) \
+  OBJ(INIT_0, G_ADDR(0,1,0), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(INIT_1, G_ADDR(0,1,1), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(INIT_2, G_ADDR(0,1,2), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(INIT_3, G_ADDR(0,1,3), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(INIT_4, G_ADDR(0,1,4), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(INIT_5, G_ADDR(0,1,5), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(INIT_6, G_ADDR(0,1,6), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(INIT_7, G_ADDR(0,1,7), KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(CMD_0,  G_ADDR(0,2,0), KNX_DPT_1_001, COM_OBJ_LOGIC_IN) \
+  OBJ(CMD_1,  G_ADDR(0,2,1), KNX_DPT_1_001, COM_OBJ_LOGIC_IN) \
+  OBJ(SENSOR_0, G_ADDR(0,3,0), KNX_DPT_1_001, COM_OBJ_SENSOR) \
+  OBJ(SENSOR_1, G_ADDR(0,3,1), KNX_DPT_1_001, COM_OBJ_SENSOR) \
+  OBJ(TEMP,     G_ADDR(0,3,2), KNX_DPT_9_001, COM_OBJ_SENSOR) \
+  OBJ(LUX,      G_ADDR(0,3,3), KNX_DPT_7_001, COM_OBJ_SENSOR) \
+  OBJ(SHARED,   G_ADDR(0,3,4), KNX_DPT_1_001, KNX_COM_OBJ_C_INDICATOR | KNX_COM_OBJ_W_INDICATOR | KNX_COM_OBJ_T_INDICATOR)
+
+KNX_DEVICE_COM_OBJECTS(TEST_COM_OBJECTS)
+
+#define DEVICE_ADDR P_ADDR(1,1,2)
+#define PEER_ADDR   P_ADDR(1,1,9) // source of the telegrams received by the device
+#define INIT_OBJECTS_NB 8
+
+// Simulated peers answering the read requests sent by the device
+unsigned long responseDelayMicros; // delay of the answer after the end of the read request, 0 = no answer
+word mutedAddr;                    // group address whose first read is not answered (0 = none)
+word sentNb;                       // nb of telegrams sent by the device, already checked by Run()
+word eventsNb;                     // nb of knxEvents() calls
+
+// Update handlers
+type_knx_com_obj_handler handlers[KnxComObjectsNb_];
+byte changedBits[KNX_DEVICE_BITSET_SIZE(KnxComObjectsNb_)], otherChangedBits[KNX_DEVICE_BITSET_SIZE(KnxComObjectsNb_)];
+word handlerCallsNb, batchCallsNb;
+type_com_obj_index lastIndex, lastChangedNb;
+byte batchAction; // action of the batch handler : 0 none, 1 disable the batch, 2 switch to the other bitset
+unsigned long handlerDurationMicros; // execution time of the slow handler
+
+// Transactions completion handler
+word txHandlerCallsNb;
+type_knx_tx_handle txLastHandle;
+e_KnxTxStatus txLastStatus;
+
+void Init(void);      // Init reads : startup time to full validity
+void Handlers(void);  // Per-object handlers and batched updates
+void Budget(void);    // Dispatch budget and handlers duration counters
+void Transactions(void); // Tracked writes : handles pool and completion statuses
+void Retries(void);   // Retries backoff, jitter and counters
+void RateLimits(void); // Device and group address rate limits
+void Policies(void);  // Send policies
+void IsrWrites(void); // Writes from an interrupt routine
+void WriteBench(void); // write() duration and heap use
+void AlarmBench(void); // Alarm latency under normal priority load
+void AllTests(void);
+
+
+void setup() {
+  cli.RegisterCmd("init",&Init);
+  cli.RegisterCmd("handlers",&Handlers);
+  cli.RegisterCmd("budget",&Budget);
+  cli.RegisterCmd("transactions",&Transactions);
+  cli.RegisterCmd("retries",&Retries);
+  cli.RegisterCmd("ratelimits",&RateLimits);
+  cli.RegisterCmd("policies",&Policies);
+  cli.RegisterCmd("isrwrites",&IsrWrites);
+  cli.RegisterCmd("writebench",&WriteBench);
+  cli.RegisterCmd("alarmbench",&AlarmBench);
+  cli.RegisterCmd("all",&AllTests);
+  Serial.begin(115200);
+}
+
+
+void loop() {
+  cli.Run();
+}
+
+
+void knxEvents(type_com_obj_index index) {
+  eventsNb++;
+}
+
+
+#if defined(KNXTPUART_RX_INTERRUPT)
+// Simulated UART RX interrupt
+void SimRxInterrupt(byte data) { Knx.rxInterrupt(data); }
+#endif
+
+
+// Start the device on the simulated link
+e_KnxDeviceStatus Begin(void) {
+#if defined(KNXTPUART_RX_INTERRUPT)
+  tpuartSim.SetRxHook(SimRxInterrupt); // the reset indication is received through the interrupt
+#endif
+  tpuartSim.ClearStats();
+  sentNb = 0; eventsNb = 0;
+  return Knx.begin(tpuartSim, DEVICE_ADDR);
+}
+
+
+void End(void) {
+  Knx.end();
+  tpuartSim.SetRxHook(NULL);
+}
+
+
+// Answer the last telegram sent by the device when it is a read request
+void AnswerRead(void) {
+  const KnxTelegram& request = tpuartSim.GetSentTelegram();
+  KnxTelegram response;
+  if (request.GetCommand() != KNX_COMMAND_VALUE_READ) return;
+  if (request.GetTargetAddress() == mutedAddr) { mutedAddr = 0; return; } // first read lost
+  response.SetSourceAddress(PEER_ADDR);
+  response.SetTargetAddress(request.GetTargetAddress());
+  response.SetPayloadLength(1);
+  response.SetCommand(KNX_COMMAND_VALUE_RESPONSE);
+  response.SetFirstPayloadByte(1);
+  response.UpdateChecksum();
+  tpuartSim.ReceiveTelegram(response, responseDelayMicros);
+}
+
+
+// Inject a write telegram of a B1 value sent by a peer
+void ReceiveWrite(word groupAddr, byte value) {
+  KnxTelegram tg;
+  tg.SetSourceAddress(PEER_ADDR);
+  tg.SetTargetAddress(groupAddr);
+  tg.SetPayloadLength(1);
+  tg.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  tg.SetFirstPayloadByte(value);
+  tg.UpdateChecksum();
+  tpuartSim.ReceiveTelegram(tg);
+}
+
+
+// Run Knx.task() every 100us during durationMicros (the simulated UART RX interrupt too)
+// The read requests are answered by the simulated peers
+void Run(unsigned long durationMicros) {
+  unsigned long startTime = micros();
+  while ((micros() - startTime) < durationMicros)
+  {
+    delayMicroseconds(100);
+    tpuartSim.Task();
+    Knx.task();
+    if (tpuartSim.GetSentTelegramsNb() != sentNb)
+    {
+      sentNb = tpuartSim.GetSentTelegramsNb();
+      if (responseDelayMicros) AnswerRead();
+    }
+  }
+}
+
+
+// Run the device till the end of the init reads (10 sec max), return the init duration (0 when not completed)
+unsigned long RunInit(void) {
+  for (word i = 0; (i < 1000) && !Knx.getInitDuration(); i++) Run(10000);
+  return Knx.getInitDuration();
+}
+
+
+// Count the valid init objects
+byte ValidInitObjectsNb(void) {
+  byte validNb = 0;
+  byte value;
+  for (byte i = INIT_0; i < INIT_0 + INIT_OBJECTS_NB; i++) if (Knx.read(i, value) == KNX_DEVICE_OK) validNb++;
+  return validNb;
+}
+
+
+// The 8 init objects are read on the bus, the peers answer 20ms after each read request.
+// The startup time is measured with 1, 2 and 4 reads in flight : one read round trip (request and response
+// telegrams, 20ms answer delay) is about 40ms, and several reads are pipelined. The former scheduling waited 500ms
+// after each read, i.e. 4 sec for 8 objects.
+// A lost response (no answer to the first read of INIT_3) delays the startup by the read timeout.
+// With a device rate limit (1 telegram / 150ms), the reads wait in the TX queue longer than their timeout (100ms) :
+// the timeout starts when they are sent, each object is read once.
+// NB : end() clears the validity of the init objects, so that each run starts with 8 objects to be read.
+// begin() is then called again without end() : the device is restarted and the init is performed again.
+void Init(void) {
+  const byte readsNbs[] = { 1, 2, 4 };
+  unsigned long durations[3], duration;
+  word errorsNb = 0;
+
+  Serial.println(F("\n########## Init reads tests ##########"));
+  responseDelayMicros = 20000;
+  mutedAddr = 0;
+  Knx.setResetPolicy(1000, 0, 10); // the device is stopped : the policy is kept for the next begin()
+  for (byte i = 0; i < 3; i++)
+  {
+    if (Begin() != KNX_DEVICE_OK) errorsNb++;
+    Knx.setInitReadPolicy(readsNbs[i], 1000);
+    durations[i] = RunInit();
+    Serial.print(F("Reads in flight ")); Serial.print(readsNbs[i]);
+    Serial.print(F(" : init duration (ms) ")); Serial.print(durations[i]);
+    Serial.print(F(", read requests ")); Serial.print(tpuartSim.GetSentTelegramsNb());
+    Serial.print(F(", valid objects ")); Serial.println(ValidInitObjectsNb());
+    if (!durations[i] || (ValidInitObjectsNb() != INIT_OBJECTS_NB) || (eventsNb != INIT_OBJECTS_NB)) errorsNb++;
+    if (tpuartSim.GetSentTelegramsNb() != INIT_OBJECTS_NB) errorsNb++;
+    if (durations[i] > (INIT_OBJECTS_NB * 500UL) / 8) errorsNb++; // 8 times faster than the former scheduling
+    End();
+  }
+  // pipelined reads : 2 reads in flight are faster than 1, 4 reads are limited by the bus load (at most 1 telegram
+  // of difference)
+  if ((durations[1] >= durations[0]) || (durations[2] > durations[1] + 20)) errorsNb++;
+
+  // lost response : INIT_3 is read again after the timeout
+  mutedAddr = G_ADDR(0,1,3);
+  Begin();
+  Knx.setInitReadPolicy(2, 300);
+  duration = RunInit();
+  Serial.print(F("Lost response : init duration (ms) ")); Serial.print(duration);
+  Serial.print(F(", read requests ")); Serial.println(tpuartSim.GetSentTelegramsNb());
+  if ((duration < 300) || (tpuartSim.GetSentTelegramsNb() != INIT_OBJECTS_NB + 1)) errorsNb++;
+  if (ValidInitObjectsNb() != INIT_OBJECTS_NB) errorsNb++;
+
+  // reads held by the rate limit : no read timed out before being sent
+  Begin();
+  Knx.setInitReadPolicy(4, 100);
+  Knx.setTxRateLimit(150, 1);
+  duration = RunInit();
+  Run(300000); // a read queued again would be sent meanwhile
+  Serial.print(F("Rate limited reads : init duration (ms) ")); Serial.print(duration);
+  Serial.print(F(", read requests ")); Serial.println(tpuartSim.GetSentTelegramsNb());
+  if ((duration < (INIT_OBJECTS_NB - 1) * 150UL) || (tpuartSim.GetSentTelegramsNb() != INIT_OBJECTS_NB)) errorsNb++;
+  if (ValidInitObjectsNb() != INIT_OBJECTS_NB) errorsNb++;
+  Knx.setTxRateLimit(0, 1);
+
+  // begin() called again without end() : the device is restarted, the init objects are read again
+  if (Begin() != KNX_DEVICE_OK) errorsNb++;
+  duration = RunInit();
+  Serial.print(F("Restart : init duration (ms) ")); Serial.print(duration);
+  Serial.print(F(", read requests ")); Serial.println(tpuartSim.GetSentTelegramsNb());
+  if (!duration || (tpuartSim.GetSentTelegramsNb() != INIT_OBJECTS_NB)) errorsNb++;
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void OnCommand(type_com_obj_index index) {
+  handlerCallsNb++;
+  lastIndex = index;
+}
+
+
+void OnBatch(const byte bits[], type_com_obj_index changedNb) {
+  batchCallsNb++;
+  lastChangedNb = changedNb;
+  lastIndex = Knx.isComObjectSet(bits, CMD_0) ? CMD_0 : (Knx.isComObjectSet(bits, CMD_1) ? CMD_1 : 0xFF);
+  if (batchAction == 1) Knx.setBatchedEvents(NULL, NULL);
+  else if (batchAction == 2) Knx.setBatchedEvents(otherChangedBits, OnBatch);
+  batchAction = 0;
+}
+
+
+// Receive a write on a com object, and check the notification : knxEvents(), handler or batch handler calls nb
+word CheckNotification(word groupAddr, word expectedEventsNb, word expectedHandlerCallsNb, word expectedBatchCallsNb) {
+  eventsNb = 0; handlerCallsNb = 0; batchCallsNb = 0;
+  ReceiveWrite(groupAddr, 1);
+  Run(20000);
+  if ((eventsNb != expectedEventsNb) || (handlerCallsNb != expectedHandlerCallsNb) || (batchCallsNb != expectedBatchCallsNb))
+  {
+    Serial.print(F("Unexpected notification of ")); Serial.print(groupAddr, HEX);
+    Serial.print(F(" : events ")); Serial.print(eventsNb);
+    Serial.print(F(", handler calls ")); Serial.print(handlerCallsNb);
+    Serial.print(F(", batch calls ")); Serial.println(batchCallsNb);
+    return 1;
+  }
+  return 0;
+}
+
+
+// knxEvents() is called while no handler is attached, then the handler of CMD_0 replaces it (CMD_1 keeps
+// knxEvents()). setHandler() fails without table and out of range.
+// With the batched updates, the batch handler gets the bitset of the updated objects. A batch handler disabling
+// the batch (or switching to another bitset) is safe : the bitset is not cleared by the device after the call.
+void Handlers(void) {
+  word errorsNb = 0;
+
+  Serial.println(F("\n########## Handlers tests ##########"));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+  Knx.attachHandlers(NULL);
+  if (Knx.setHandler(CMD_0, OnCommand) != KNX_DEVICE_ERROR) errorsNb++; // no table
+  errorsNb += CheckNotification(G_ADDR(0,2,0), 1, 0, 0);
+
+  for (byte i = 0; i < KnxComObjectsNb_; i++) handlers[i] = NULL;
+  Knx.attachHandlers(handlers);
+  if (Knx.setHandler(CMD_0, OnCommand) != KNX_DEVICE_OK) errorsNb++;
+  if (Knx.setHandler(KnxComObjectsNb_, OnCommand) != KNX_DEVICE_ERROR) errorsNb++; // out of range
+  errorsNb += CheckNotification(G_ADDR(0,2,0), 0, 1, 0);
+  if (lastIndex != CMD_0) errorsNb++;
+  errorsNb += CheckNotification(G_ADDR(0,2,1), 1, 0, 0); // no handler for CMD_1
+
+  // batched updates
+  Knx.setBatchedEvents(changedBits, OnBatch);
+  batchAction = 0;
+  errorsNb += CheckNotification(G_ADDR(0,2,1), 0, 0, 1);
+  if ((lastIndex != CMD_1) || (lastChangedNb != 1) || Knx.isComObjectSet(changedBits, CMD_1)) errorsNb++; // cleared
+  // the handler switches to the other bitset : the next update is notified through it
+  batchAction = 2;
+  errorsNb += CheckNotification(G_ADDR(0,2,0), 0, 0, 1);
+  if (Knx.isComObjectSet(otherChangedBits, CMD_0)) errorsNb++;
+  errorsNb += CheckNotification(G_ADDR(0,2,1), 0, 0, 1);
+  if (lastIndex != CMD_1) errorsNb++;
+  // the handler disables the batch : the next updates are notified one by one
+  batchAction = 1;
+  errorsNb += CheckNotification(G_ADDR(0,2,0), 0, 0, 1);
+  errorsNb += CheckNotification(G_ADDR(0,2,0), 0, 1, 0);
+  errorsNb += CheckNotification(G_ADDR(0,2,1), 1, 0, 0);
+  Knx.attachHandlers(NULL);
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void OnSlowCommand(type_com_obj_index index) {
+  handlerCallsNb++;
+  delayMicroseconds(handlerDurationMicros);
+}
+
+
+// Receive telegramsNb writes back to back on CMD_0 while the loop is stalled, then run the device
+void ReceiveWritesBurst(byte telegramsNb) {
+  for (byte i = 0; i < telegramsNb; i++) ReceiveWrite(G_ADDR(0,2,0), i & 1);
+  for (word i = 0; i < 400; i++) { delayMicroseconds(100); tpuartSim.Task(); } // 40ms stall
+  Run(30000);
+}
+
+
+// The CMD_0 handler runs 600us, and 3 writes are received while the loop is stalled (TPUART RX queue full) : with
+// a 1000us budget, 2 telegrams are dispatched by the first task() execution, the last one by the next execution.
+// With an unlimited budget (65535us), the 3 telegrams are dispatched at once.
+// A 70ms handler is then measured : the durations are not truncated to 16 bits (65ms).
+void Budget(void) {
+  unsigned long handlersDuration;
+  word deferredNb, errorsNb = 0;
+
+  Serial.println(F("\n########## Dispatch budget tests ##########"));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+  for (byte i = 0; i < KnxComObjectsNb_; i++) handlers[i] = NULL;
+  Knx.attachHandlers(handlers);
+  Knx.setHandler(CMD_0, OnSlowCommand);
+  handlerDurationMicros = 600;
+
+  Knx.setDispatchBudget(1000);
+  handlerCallsNb = 0;
+  deferredNb = Knx.getDeferredDispatchesNb();
+  handlersDuration = Knx.getHandlersDuration();
+  ReceiveWritesBurst(3);
+  Serial.print(F("Budget 1000us : handler calls ")); Serial.print(handlerCallsNb);
+  Serial.print(F(", deferred dispatches ")); Serial.print(Knx.getDeferredDispatchesNb() - deferredNb);
+  Serial.print(F(", handlers duration (us) ")); Serial.print(Knx.getHandlersDuration() - handlersDuration);
+  Serial.print(F(", max (us) ")); Serial.println(Knx.getMaxHandlerDuration());
+  if ((handlerCallsNb != 3) || (Knx.getDeferredDispatchesNb() - deferredNb != 1)) errorsNb++;
+  if ((Knx.getHandlersDuration() - handlersDuration < 3 * 600UL) || (Knx.getHandlersDuration() - handlersDuration > 3 * 700UL)) errorsNb++;
+  if ((Knx.getMaxHandlerDuration() < 600) || (Knx.getMaxHandlerDuration() > 700)) errorsNb++;
+
+  Knx.setDispatchBudget(65535);
+  handlerCallsNb = 0;
+  deferredNb = Knx.getDeferredDispatchesNb();
+  ReceiveWritesBurst(3);
+  Serial.print(F("Budget 65535us : handler calls ")); Serial.print(handlerCallsNb);
+  Serial.print(F(", deferred dispatches ")); Serial.println(Knx.getDeferredDispatchesNb() - deferredNb);
+  if ((handlerCallsNb != 3) || (Knx.getDeferredDispatchesNb() != deferredNb)) errorsNb++;
+
+  handlerDurationMicros = 70000;
+  handlersDuration = Knx.getHandlersDuration();
+  ReceiveWritesBurst(1);
+  Serial.print(F("Slow handler : max duration (us) ")); Serial.print(Knx.getMaxHandlerDuration());
+  Serial.print(F(", handlers duration (us) ")); Serial.println(Knx.getHandlersDuration() - handlersDuration);
+  if ((Knx.getMaxHandlerDuration() < 70000) || (Knx.getHandlersDuration() - handlersDuration < 70000)) errorsNb++;
+  Knx.setDispatchBudget(KNX_DEVICE_DISPATCH_BUDGET_DEFAULT_MICROS);
+  Knx.attachHandlers(NULL);
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void OnTxCompleted(type_knx_tx_handle handle, type_com_obj_index objectIndex, e_KnxTxStatus status,
+                   unsigned long latencyMicros) {
+  txHandlerCallsNb++;
+  txLastHandle = handle;
+  txLastStatus = status;
+  lastIndex = objectIndex;
+}
+
+
+// Check the status of a transaction (the completion is read, the handle is released)
+word CheckTxStatus(type_knx_tx_handle handle, e_KnxTxStatus expectedStatus) {
+  e_KnxTxStatus status = Knx.getTxStatus(handle);
+  if (status == expectedStatus) return 0;
+  Serial.print(F("Unexpected status of handle ")); Serial.print(handle, HEX);
+  Serial.print(F(" : ")); Serial.print(status); Serial.print(F(" instead of ")); Serial.println(expectedStatus);
+  return 1;
+}
+
+
+// Handles : a handle is unique (slot and generation), a released slot is reused with a new generation and the
+// former handle stays unknown. With 4 pending transactions the pool is full, the 5th write is done untracked.
+// A polled transaction completed and not read yet is overwritten when the pool is full (its handle gets unknown),
+// a pending one never is.
+// Statuses : ACK, LOCAL (object without TRANSMIT attribute), NACK, NO_ANSWER, SUPERSEDED (write coalescing),
+// DROPPED (full TX queue), RESET (device stopped), and the completion handler called once by task().
+void Transactions(void) {
+  type_knx_tx_handle handles[KNX_DEVICE_TX_TRANSACTIONS_NB + 1], handle;
+  unsigned long latency = 0;
+  word telegramsNb;
+  word errorsNb = 0;
+
+  Serial.println(F("\n########## Transactions tests ##########"));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+
+  // handles generation and reuse
+  handle = Knx.writeTracked(SENSOR_0, true);
+  if ((handle == KNX_TX_HANDLE_NONE) || (Knx.getTxStatus(handle) != KNX_TX_PENDING)) errorsNb++;
+  Run(50000);
+  if ((Knx.getTxStatus(handle, &latency) != KNX_TX_ACK) || !latency || (latency > 50000)) errorsNb++;
+  errorsNb += CheckTxStatus(handle, KNX_TX_UNKNOWN); // completion read, handle released
+  handles[0] = Knx.writeTracked(SENSOR_0, false);
+  if (((handles[0] & 7) != (handle & 7)) || (handles[0] == handle)) errorsNb++; // same slot, new generation
+  errorsNb += CheckTxStatus(handle, KNX_TX_UNKNOWN); // the former handle does not alias the new one
+  Run(50000);
+  errorsNb += CheckTxStatus(handles[0], KNX_TX_ACK);
+  Serial.print(F("ACK latency (us) ")); Serial.println(latency);
+
+  // full pool : the 5th write is sent untracked
+  telegramsNb = tpuartSim.GetSentTelegramsNb();
+  for (byte i = 0; i <= KNX_DEVICE_TX_TRANSACTIONS_NB; i++) handles[i] = Knx.writeTracked(SENSOR_1, i & 1);
+  for (byte i = 0; i < KNX_DEVICE_TX_TRANSACTIONS_NB; i++)
+  {
+    if (handles[i] == KNX_TX_HANDLE_NONE) errorsNb++;
+    for (byte j = 0; j < i; j++) if (handles[i] == handles[j]) errorsNb++;
+  }
+  if (handles[KNX_DEVICE_TX_TRANSACTIONS_NB] != KNX_TX_HANDLE_NONE) errorsNb++;
+  Run(200000);
+  if (tpuartSim.GetSentTelegramsNb() - telegramsNb != KNX_DEVICE_TX_TRANSACTIONS_NB + 1) errorsNb++;
+  // drop on overwrite : the completions are not read, the new transaction takes the slot of the first one
+  handle = Knx.writeTracked(SENSOR_1, true);
+  if ((handle == KNX_TX_HANDLE_NONE) || ((handle & 7) != (handles[0] & 7))) errorsNb++;
+  errorsNb += CheckTxStatus(handles[0], KNX_TX_UNKNOWN);
+  for (byte i = 1; i < KNX_DEVICE_TX_TRANSACTIONS_NB; i++) errorsNb += CheckTxStatus(handles[i], KNX_TX_ACK);
+  Run(50000);
+  errorsNb += CheckTxStatus(handle, KNX_TX_ACK);
+
+  // local update, NACK and no answer
+  handle = Knx.writeTracked(CMD_0, true);
+  Run(50000);
+  errorsNb += CheckTxStatus(handle, KNX_TX_LOCAL);
+  tpuartSim.SetConfirm(TPUART_DATA_CONFIRM_FAILED);
+  handle = Knx.writeTracked(SENSOR_0, true);
+  Run(100000);
+  errorsNb += CheckTxStatus(handle, KNX_TX_NACK);
+  tpuartSim.SetConfirm(0);
+  handle = Knx.writeTracked(SENSOR_0, false);
+  Run(1000000);
+  errorsNb += CheckTxStatus(handle, KNX_TX_NO_ANSWER);
+  tpuartSim.SetConfirm(TPUART_DATA_CONFIRM_SUCCESS);
+  Run(100000);
+
+  // superseded write : only the latest value is sent
+  Knx.setWriteCoalescing(true);
+  telegramsNb = tpuartSim.GetSentTelegramsNb();
+  handles[0] = Knx.writeTracked(SENSOR_0, true);
+  handles[1] = Knx.writeTracked(SENSOR_0, false);
+  errorsNb += CheckTxStatus(handles[0], KNX_TX_SUPERSEDED);
+  Run(50000);
+  errorsNb += CheckTxStatus(handles[1], KNX_TX_ACK);
+  if (tpuartSim.GetSentTelegramsNb() - telegramsNb != 1) errorsNb++;
+  Knx.setWriteCoalescing(false);
+
+  // dropped action : the oldest action of the full NORMAL queue is dropped
+  handle = Knx.writeTracked(SENSOR_0, true);
+  for (byte i = 0; i < ACTIONS_QUEUE_SIZE; i++) Knx.write(SENSOR_1, i & 1);
+  errorsNb += CheckTxStatus(handle, KNX_TX_DROPPED);
+  Run(1000000);
+
+  // completion handler : called once, the handle is released
+  txHandlerCallsNb = 0;
+  handle = Knx.writeTracked(SENSOR_1, true, OnTxCompleted);
+  Run(50000);
+  if ((txHandlerCallsNb != 1) || (txLastHandle != handle) || (txLastStatus != KNX_TX_ACK) || (lastIndex != SENSOR_1))
+    errorsNb++;
+  errorsNb += CheckTxStatus(handle, KNX_TX_UNKNOWN);
+
+  // device stopped : the queued write is completed as RESET, its handler is not called
+  txHandlerCallsNb = 0;
+  handles[0] = Knx.writeTracked(SENSOR_0, true);
+  handles[1] = Knx.writeTracked(SENSOR_1, true, OnTxCompleted);
+  End();
+  errorsNb += CheckTxStatus(handles[0], KNX_TX_RESET);
+  errorsNb += CheckTxStatus(handles[1], KNX_TX_RESET);
+  if (txHandlerCallsNb) errorsNb++;
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+// Send a tracked write of SENSOR_0 not acknowledged (NACK) by the bus, and run the device during durationMillis
+// The sending times (in ms) of the attempts are recorded, return the nb of attempts
+byte RecordAttempts(unsigned long durationMillis, unsigned long times[], byte maxNb, type_knx_tx_handle& handle) {
+  word telegramsNb = tpuartSim.GetSentTelegramsNb();
+  byte attemptsNb = 0;
+  tpuartSim.SetConfirm(TPUART_DATA_CONFIRM_FAILED);
+  handle = Knx.writeTracked(SENSOR_0, true);
+  for (unsigned long i = 0; i < durationMillis; i++)
+  {
+    Run(1000);
+    if (tpuartSim.GetSentTelegramsNb() == telegramsNb) continue;
+    telegramsNb = tpuartSim.GetSentTelegramsNb();
+    if (attemptsNb < maxNb) times[attemptsNb] = millis();
+    attemptsNb++;
+  }
+  tpuartSim.SetConfirm(TPUART_DATA_CONFIRM_SUCCESS);
+  return attemptsNb;
+}
+
+
+// Send a tracked write of SHARED (value 1) not acknowledged (NACK) by the bus, with a device rate limit of 1 telegram
+// per second : the retry is queued again after its backoff, and held in the TX queue by the rate limit
+// The nb of sent telegrams is returned in telegramsNb, and the nb of errors by the function
+word QueueHeldRetry(type_knx_tx_handle& handle, word& telegramsNb) {
+  word errorsNb = 0;
+  Knx.setTxRateLimit(1000, 1);
+  tpuartSim.SetConfirm(TPUART_DATA_CONFIRM_FAILED);
+  handle = Knx.writeTracked(SHARED, true);
+  Run(50000);
+  tpuartSim.SetConfirm(TPUART_DATA_CONFIRM_SUCCESS);
+  telegramsNb = tpuartSim.GetSentTelegramsNb();
+  Run(200000); // backoff elapsed
+  if ((tpuartSim.GetSentTelegramsNb() != telegramsNb) || (Knx.getTxStatus(handle) != KNX_TX_PENDING)) errorsNb++;
+  return errorsNb;
+}
+
+
+// Check the delays between the attempts : the delay before the retry n is in [backoff/2, backoff] (equal jitter),
+// the backoff being doubled on each retry up to the max backoff. The sending of a telegram takes less than 40ms.
+word CheckRetryDelays(const unsigned long times[], byte attemptsNb, word backoffMillis, word maxBackoffMillis) {
+  unsigned long backoff = backoffMillis, delay;
+  word errorsNb = 0;
+  for (byte i = 1; i < attemptsNb; i++)
+  {
+    delay = times[i] - times[i - 1];
+    Serial.print(F("Retry ")); Serial.print(i); Serial.print(F(" : delay (ms) ")); Serial.print(delay);
+    Serial.print(F(", backoff (ms) ")); Serial.println(backoff);
+    if ((delay < backoff / 2) || (delay > backoff + 40)) errorsNb++;
+    backoff = (backoff * 2 > maxBackoffMillis) ? maxBackoffMillis : backoff * 2;
+  }
+  return errorsNb;
+}
+
+
+// A write is sent 4 times (3 retries) with a 100ms backoff up to 400ms, then the device gives up : the transaction
+// remains pending during the retries, and completes as NACK. The delays are checked on 4 writes (random jitter).
+// A retried write is superseded by a newer write of the com object.
+// A retried write already queued again (held by a rate limit) is superseded by a bus WRITE : the stale value is not
+// sent, and the com object keeps the bus value. It is also superseded by a newer write of the application : only
+// the newer value is sent.
+// With a 40s backoff (up to 65s), the doubled backoff does not fit in a word : the second retry waits between 32.5s
+// and 65s (the former computation overflowed to a shorter delay).
+void Retries(void) {
+  unsigned long times[4];
+  type_knx_tx_handle handle, newHandle;
+  word retriesNb, giveUpsNb, telegramsNb, errorsNb = 0;
+
+  Serial.println(F("\n########## Retries tests ##########"));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+  Knx.setRetryPolicy(4, 100, 400);
+  for (byte n = 0; n < 4; n++)
+  {
+    retriesNb = Knx.getRetriesNb(); giveUpsNb = Knx.getGiveUpsNb();
+    if (RecordAttempts(1000, times, 4, handle) != 4) errorsNb++;
+    errorsNb += CheckRetryDelays(times, 4, 100, 400);
+    if ((Knx.getRetriesNb() - retriesNb != 3) || (Knx.getGiveUpsNb() - giveUpsNb != 1)) errorsNb++;
+    errorsNb += CheckTxStatus(handle, KNX_TX_NACK);
+  }
+
+  // superseded retry : the retry is cancelled, the newer value is sent
+  retriesNb = Knx.getRetriesNb();
+  RecordAttempts(50, times, 4, handle); // NACK received, retry delay not elapsed
+  if (Knx.getTxStatus(handle) != KNX_TX_PENDING) errorsNb++; // waiting for its retry
+  newHandle = Knx.writeTracked(SENSOR_0, false);
+  errorsNb += CheckTxStatus(handle, KNX_TX_SUPERSEDED);
+  Run(1000000);
+  errorsNb += CheckTxStatus(newHandle, KNX_TX_ACK);
+  if (Knx.getRetriesNb() != retriesNb) errorsNb++;
+
+  // queued retry superseded by a bus write
+  errorsNb += QueueHeldRetry(handle, telegramsNb);
+  ReceiveWrite(G_ADDR(0,3,4), 0);
+  Run(1500000);
+  errorsNb += CheckTxStatus(handle, KNX_TX_SUPERSEDED);
+  if (tpuartSim.GetSentTelegramsNb() != telegramsNb) errorsNb++; // stale value not sent
+  if (Knx.read(SHARED) != 0) errorsNb++;
+  // queued retry superseded by an application write
+  errorsNb += QueueHeldRetry(handle, telegramsNb);
+  Knx.write(SHARED, (byte)0);
+  errorsNb += CheckTxStatus(handle, KNX_TX_SUPERSEDED);
+  Run(1500000);
+  if ((tpuartSim.GetSentTelegramsNb() != telegramsNb + 1) || (tpuartSim.GetSentTelegram().GetFirstPayloadByte() != 0))
+    errorsNb++;
+  Knx.setTxRateLimit(0, 1);
+
+  // large backoff
+  Knx.setRetryPolicy(3, 40000, 65000);
+  if (RecordAttempts(110000, times, 3, handle) != 3) errorsNb++;
+  errorsNb += CheckRetryDelays(times, 3, 40000, 65000);
+  errorsNb += CheckTxStatus(handle, KNX_TX_NACK);
+  Knx.setRetryPolicy(KNX_DEVICE_RETRY_DEFAULT_ATTEMPTS_NB, 1, 1);
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+// Telegram sent by the device
+typedef struct {
+  word addr;
+  word value; // 1st payload byte, or 2 bytes value
+  unsigned long timeMillis;
+} type_sent_telegram;
+
+
+// Run the device during durationMillis, and record the telegrams sent meanwhile (target address, value and
+// sending time). Return the nb of sent telegrams
+byte RecordTelegrams(unsigned long durationMillis, type_sent_telegram telegrams[], byte maxNb) {
+  word telegramsNb = tpuartSim.GetSentTelegramsNb();
+  byte sentTelegramsNb = 0;
+  for (unsigned long i = 0; i < durationMillis; i++)
+  {
+    Run(1000);
+    if (tpuartSim.GetSentTelegramsNb() == telegramsNb) continue;
+    telegramsNb = tpuartSim.GetSentTelegramsNb();
+    if (sentTelegramsNb < maxNb)
+    {
+      telegrams[sentTelegramsNb].addr = tpuartSim.GetSentTelegram().GetTargetAddress();
+      telegrams[sentTelegramsNb].value = tpuartSim.GetSentTelegram().GetFirstPayloadByte();
+      if (tpuartSim.GetSentTelegram().GetPayloadLength() == 3)
+      {
+        byte value[2];
+        tpuartSim.GetSentTelegram().GetLongPayload(value, 2);
+        telegrams[sentTelegramsNb].value = (value[0] << 8) + value[1];
+      }
+      telegrams[sentTelegramsNb].timeMillis = millis();
+    }
+    sentTelegramsNb++;
+  }
+  return sentTelegramsNb;
+}
+
+
+// Check a recorded telegram : target address, value, and sending time window after startTimeMillis
+word CheckTelegram(const type_sent_telegram& telegram, word addr, word value, unsigned long startTimeMillis,
+                   unsigned long minDelayMillis, unsigned long maxDelayMillis) {
+  unsigned long delay = telegram.timeMillis - startTimeMillis;
+  if ((telegram.addr == addr) && (telegram.value == value) && (delay >= minDelayMillis) && (delay <= maxDelayMillis))
+    return 0;
+  Serial.print(F("Unexpected telegram : addr ")); Serial.print(telegram.addr, HEX);
+  Serial.print(F(", value ")); Serial.print(telegram.value); Serial.print(F(", delay (ms) ")); Serial.println(delay);
+  return 1;
+}
+
+
+// Device limit (1 telegram / 100ms, burst 2) : 2 writes are sent at once, the next ones every 100ms. A local write
+// (com object without TRANSMIT attribute) is not held meanwhile.
+// Group limit on SENSOR_0 (1 telegram / 200ms) : the second write of SENSOR_0 is held, the 3 writes of SENSOR_1
+// queued after it are sent meanwhile, in their order. The held write is then sent.
+// The group limits table is full with KNX_DEVICE_TX_GROUP_LIMITS_NB addresses, a removed limit frees its slot.
+void RateLimits(void) {
+  type_sent_telegram telegrams[6];
+  type_knx_tx_handle handle;
+  unsigned long startTime;
+  word telegramsNb, errorsNb = 0;
+
+  Serial.println(F("\n########## Rate limits tests ##########"));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+
+  // device limit
+  Knx.setTxRateLimit(100, 2);
+  startTime = millis();
+  for (byte i = 0; i < 5; i++) Knx.write(SENSOR_1, i & 1);
+  if (RecordTelegrams(600, telegrams, 6) != 5) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,1), 0, startTime, 0, 40);
+  errorsNb += CheckTelegram(telegrams[1], G_ADDR(0,3,1), 1, startTime, 0, 80);
+  for (byte i = 2; i < 5; i++)
+    errorsNb += CheckTelegram(telegrams[i], G_ADDR(0,3,1), i & 1, startTime, (i - 1) * 100UL, (i - 1) * 100UL + 40);
+  // the local write queued after 3 writes is done while the third one is held
+  telegramsNb = tpuartSim.GetSentTelegramsNb();
+  for (byte i = 0; i < 3; i++) Knx.write(SENSOR_1, i & 1);
+  handle = Knx.writeTracked(CMD_0, true);
+  Run(80000);
+  errorsNb += CheckTxStatus(handle, KNX_TX_LOCAL);
+  if (tpuartSim.GetSentTelegramsNb() - telegramsNb != 2) errorsNb++;
+  Run(200000);
+  Knx.setTxRateLimit(0, 1);
+
+  // group limit : the held write does not delay the other ones
+  if (Knx.setGroupRateLimit(G_ADDR(0,3,0), 200, 1) != KNX_DEVICE_OK) errorsNb++;
+  startTime = millis();
+  Knx.write(SENSOR_0, (byte)1);
+  Knx.write(SENSOR_0, (byte)0);
+  for (byte i = 0; i < 3; i++) Knx.write(SENSOR_1, (i + 1) & 1);
+  if (RecordTelegrams(400, telegrams, 6) != 5) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,0), 1, startTime, 0, 40);
+  for (byte i = 1; i < 4; i++) errorsNb += CheckTelegram(telegrams[i], G_ADDR(0,3,1), i & 1, startTime, 0, 40 * (i + 1));
+  errorsNb += CheckTelegram(telegrams[4], G_ADDR(0,3,0), 0, startTime, 200, 240);
+
+  // group limits table
+  for (byte i = 1; i < KNX_DEVICE_TX_GROUP_LIMITS_NB; i++)
+    if (Knx.setGroupRateLimit(G_ADDR(0,4,i), 100, 1) != KNX_DEVICE_OK) errorsNb++;
+  if (Knx.setGroupRateLimit(G_ADDR(0,4,0), 100, 1) != KNX_DEVICE_ERROR) errorsNb++; // full
+  if (Knx.setGroupRateLimit(G_ADDR(0,3,0), 100, 2) != KNX_DEVICE_OK) errorsNb++; // limit of a limited address changed
+  Knx.setGroupRateLimit(G_ADDR(0,3,0), 0, 1);
+  if (Knx.setGroupRateLimit(G_ADDR(0,4,0), 100, 1) != KNX_DEVICE_OK) errorsNb++;
+  for (byte i = 0; i < KNX_DEVICE_TX_GROUP_LIMITS_NB; i++) Knx.setGroupRateLimit(G_ADDR(0,4,i), 0, 1);
+  // no limit anymore on SENSOR_0
+  startTime = millis();
+  Knx.write(SENSOR_0, (byte)1);
+  Knx.write(SENSOR_0, (byte)0);
+  if (RecordTelegrams(100, telegrams, 6) != 2) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[1], G_ADDR(0,3,0), 0, startTime, 0, 80);
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+// TEMP policy (0.5 deadband, 1s min interval, 5s max interval) : the first value is sent at once, a change below
+// the deadband within the min interval is not sent, a change above the deadband is sent at once (min interval
+// elapsed), a change below the deadband is sent after the max interval.
+// LUX policy (10% deadband, 2s heartbeat) : a 5% change is sent by the heartbeat, a 14% change at once, and the
+// unchanged value is sent again by the heartbeat.
+// A write following a queued tracked write of LUX is queued as is : the tracked value is not changed.
+// A write replacing a failed write waiting for its retry cancels the retry, and it is sent at once.
+void Policies(void) {
+  type_knx_send_policy policies[] = { { TEMP, 0.5, false, 1000, 5, 0 }, { LUX, 10, true, 0, 0, 2 } };
+  type_knx_send_policy badPolicies[] = { { KnxComObjectsNb_, 0, false, 0, 0, 0 } };
+  type_sent_telegram telegrams[4];
+  type_knx_tx_handle handle;
+  unsigned long startTime;
+  word writesNb, sendsNb, retriesNb, errorsNb = 0;
+  unsigned int lux = 0;
+
+  Serial.println(F("\n########## Send policies tests ##########"));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+  if (Knx.attachSendPolicies(badPolicies, 1) != KNX_DEVICE_ERROR) errorsNb++; // out of range
+  if (Knx.attachSendPolicies(NULL, 2) != KNX_DEVICE_OK) errorsNb++; // detached
+  if (Knx.attachSendPolicies(policies, 2) != KNX_DEVICE_OK) errorsNb++;
+  writesNb = Knx.getPolicyWritesNb(); sendsNb = Knx.getPolicySendsNb();
+
+  // absolute deadband, min and max intervals
+  startTime = millis();
+  Knx.write(TEMP, 10.0f);
+  if (RecordTelegrams(100, telegrams, 4) != 1) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,2), 1000, startTime, 0, 40);
+  Knx.write(TEMP, 10.25f);
+  if (RecordTelegrams(1400, telegrams, 4) != 0) errorsNb++; // below the deadband
+  startTime = millis();
+  Knx.write(TEMP, 11.0f);
+  if (RecordTelegrams(100, telegrams, 4) != 1) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,2), 1100, startTime, 0, 40);
+  Knx.write(TEMP, 11.25f);
+  if (RecordTelegrams(6000, telegrams, 4) != 1) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,2), 1125, startTime, 5000, 5040); // max interval
+  if ((Knx.getPolicyWritesNb() - writesNb != 4) || (Knx.getPolicySendsNb() - sendsNb != 3)) errorsNb++;
+
+  // relative deadband and heartbeat
+  writesNb = Knx.getPolicyWritesNb(); sendsNb = Knx.getPolicySendsNb();
+  startTime = millis();
+  Knx.write(LUX, 1000U);
+  if (RecordTelegrams(100, telegrams, 4) != 1) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,3), 1000, startTime, 0, 40);
+  Knx.write(LUX, 1050U);
+  if (RecordTelegrams(2000, telegrams, 4) != 1) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,3), 1050, startTime, 2000, 2040); // heartbeat
+  startTime = millis();
+  Knx.write(LUX, 1200U);
+  if (RecordTelegrams(2100, telegrams, 4) != 2) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,3), 1200, startTime, 0, 40);
+  errorsNb += CheckTelegram(telegrams[1], G_ADDR(0,3,3), 1200, startTime, 2000, 2040); // heartbeat, no change
+  if ((Knx.getPolicyWritesNb() - writesNb != 3) || (Knx.getPolicySendsNb() - sendsNb != 4)) errorsNb++;
+
+  // write following a queued tracked write
+  writesNb = Knx.getPolicyWritesNb();
+  startTime = millis();
+  handle = Knx.writeTracked(LUX, 500U);
+  Knx.write(LUX, 600U);
+  if (RecordTelegrams(100, telegrams, 4) != 2) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,3), 500, startTime, 0, 40);
+  errorsNb += CheckTelegram(telegrams[1], G_ADDR(0,3,3), 600, startTime, 0, 80);
+  errorsNb += CheckTxStatus(handle, KNX_TX_ACK);
+  if ((Knx.getPolicyWritesNb() != writesNb) || (Knx.read(LUX, lux) != KNX_DEVICE_OK) || (lux != 600)) errorsNb++;
+
+  // write replacing a failed one : the retry of the failed value is cancelled
+  Knx.setRetryPolicy(3, 100, 100);
+  retriesNb = Knx.getRetriesNb();
+  tpuartSim.SetConfirm(TPUART_DATA_CONFIRM_FAILED);
+  Knx.write(LUX, 2000U);
+  if (RecordTelegrams(50, telegrams, 4) != 1) errorsNb++;
+  tpuartSim.SetConfirm(TPUART_DATA_CONFIRM_SUCCESS);
+  startTime = millis();
+  Knx.write(LUX, 2010U); // below the deadband
+  if (RecordTelegrams(300, telegrams, 4) != 1) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,3), 2010, startTime, 0, 40);
+  if (Knx.getRetriesNb() != retriesNb) errorsNb++;
+  Knx.setRetryPolicy(KNX_DEVICE_RETRY_DEFAULT_ATTEMPTS_NB, 1, 1);
+  Knx.attachSendPolicies(NULL, 0);
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+// KNX_DEVICE_ISR_WRITES_NB writes are queued, the next one is refused. A write to an unknown object or with the
+// wrong value type is refused. The queued writes are sent in their order, with their values.
+// With the TX queue full of ACTIONS_QUEUE_SIZE writes, the queued writes wait : no write is dropped.
+// The writes still queued are dropped by end().
+void IsrWrites(void) {
+  type_sent_telegram telegrams[ACTIONS_QUEUE_SIZE + KNX_DEVICE_ISR_WRITES_NB];
+  byte luxValue[2] = { 0x12, 0x34 };
+  unsigned long startTime;
+  unsigned int lux = 0;
+  word errorsNb = 0;
+
+  Serial.println(F("\n########## ISR writes tests ##########"));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+
+  // queue size and refused writes
+  for (byte i = 0; i < KNX_DEVICE_ISR_WRITES_NB; i++)
+    if (Knx.writeFromIsr(SENSOR_1, i & 1) != KNX_DEVICE_OK) errorsNb++;
+  if (Knx.writeFromIsr(SENSOR_1, 1) != KNX_DEVICE_ERROR) errorsNb++; // full
+  if (Knx.writeFromIsr(KnxComObjectsNb_, 1) != KNX_DEVICE_ERROR) errorsNb++; // unknown object
+  if (Knx.writeFromIsr(LUX, 1) != KNX_DEVICE_ERROR) errorsNb++; // long object
+  if (Knx.writeFromIsr(SENSOR_0, luxValue) != KNX_DEVICE_ERROR) errorsNb++; // short object
+  startTime = millis();
+  if (RecordTelegrams(400, telegrams, KNX_DEVICE_ISR_WRITES_NB) != KNX_DEVICE_ISR_WRITES_NB) errorsNb++;
+  for (byte i = 0; i < KNX_DEVICE_ISR_WRITES_NB; i++)
+    errorsNb += CheckTelegram(telegrams[i], G_ADDR(0,3,1), i & 1, startTime, 0, 400);
+
+  // short and long objects
+  if (Knx.writeFromIsr(SENSOR_0, 1) != KNX_DEVICE_OK) errorsNb++;
+  if (Knx.writeFromIsr(LUX, luxValue) != KNX_DEVICE_OK) errorsNb++;
+  startTime = millis();
+  if (RecordTelegrams(100, telegrams, 2) != 2) errorsNb++;
+  errorsNb += CheckTelegram(telegrams[0], G_ADDR(0,3,0), 1, startTime, 0, 100);
+  errorsNb += CheckTelegram(telegrams[1], G_ADDR(0,3,3), 0x1234, startTime, 0, 100);
+  Knx.read(LUX, lux);
+  if (lux != 0x1234) errorsNb++;
+
+  // backpressure : the TX queue is full
+  for (byte i = 0; i < ACTIONS_QUEUE_SIZE; i++) Knx.write(SENSOR_1, i & 1);
+  for (byte i = 0; i < KNX_DEVICE_ISR_WRITES_NB; i++) Knx.writeFromIsr(SENSOR_0, i & 1);
+  startTime = millis();
+  if (RecordTelegrams(1000, telegrams, ACTIONS_QUEUE_SIZE + KNX_DEVICE_ISR_WRITES_NB)
+      != ACTIONS_QUEUE_SIZE + KNX_DEVICE_ISR_WRITES_NB) errorsNb++; // some writes dropped
+  else
+  {
+    for (byte i = 0; i < ACTIONS_QUEUE_SIZE; i++)
+      errorsNb += CheckTelegram(telegrams[i], G_ADDR(0,3,1), i & 1, startTime, 0, 1000);
+    for (byte i = 0; i < KNX_DEVICE_ISR_WRITES_NB; i++)
+      errorsNb += CheckTelegram(telegrams[ACTIONS_QUEUE_SIZE + i], G_ADDR(0,3,0), i & 1, startTime, 0, 1000);
+  }
+
+  // the queued writes are dropped by end()
+  Knx.writeFromIsr(SENSOR_0, (byte)0);
+  End();
+  responseDelayMicros = 20000;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+  if (RecordTelegrams(100, telegrams, 1) != 0) errorsNb++;
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+// Smallest heap block, allocated then freed : the same address is given again as long as no block is kept
+// allocated meanwhile (a freed block is reused by the next small allocation)
+void* HeapProbe(void) {
+  void *probe = malloc(1);
+  free(probe);
+  return probe;
+}
+
+
+// Write a value 2 * ACTIONS_QUEUE_SIZE times without running the device (the second half overwrites the queued
+// actions), the durations are measured with Timer1 counting the CPU cycles (no prescaler)
+// Return the nb of failed writes
+template <typename T> word WriteCycles(type_com_obj_index index, T value, word& minCycles, word& maxCycles) {
+  word start, cycles, overhead, failedNb = 0;
+  minCycles = 0xFFFF; maxCycles = 0;
+  noInterrupts();
+  TCCR1A = 0; TCCR1B = _BV(CS10); // CPU clock
+  start = TCNT1; overhead = TCNT1 - start;
+  for (byte i = 0; i < 2 * ACTIONS_QUEUE_SIZE; i++)
+  {
+    start = TCNT1;
+    if (Knx.write(index, value) != KNX_DEVICE_OK) failedNb++;
+    cycles = TCNT1 - start - overhead;
+    if (cycles < minCycles) minCycles = cycles;
+    if (cycles > maxCycles) maxCycles = cycles;
+  }
+  interrupts();
+  return failedNb;
+}
+
+
+// write() of B1, U16 and F16 objects : the values are carried inline by the TX actions, the writes use no heap
+// (an action overwritten by the full queue leaks nothing) and their durations do not depend on the heap state.
+// The RAM of the TX actions (queues, retries and sent action) is printed.
+void WriteBench(void) {
+  const char* names[] = { "B1", "U16", "F16" };
+  word minCycles[3], maxCycles[3], failedNb = 0, errorsNb = 0;
+  void *probe;
+
+  Serial.println(F("\n########## write() bench ##########"));
+  Serial.print(F("TX action size (bytes) ")); Serial.print(sizeof(type_tx_action));
+  Serial.print(F(", TX actions RAM (bytes) "));
+  Serial.println(sizeof(type_tx_action) * (ACTIONS_QUEUE_SIZE + TX_LANE_PRIO_NB * ACTIONS_PRIO_QUEUE_SIZE + KNX_DEVICE_RETRIES_NB + 1));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+  probe = HeapProbe();
+  failedNb += WriteCycles(SENSOR_0, true, minCycles[0], maxCycles[0]);
+  failedNb += WriteCycles(LUX, 1000U, minCycles[1], maxCycles[1]);
+  failedNb += WriteCycles(TEMP, 21.5f, minCycles[2], maxCycles[2]);
+  for (byte i = 0; i < 3; i++)
+  {
+    Serial.print(names[i]); Serial.print(F(" write cycles : min ")); Serial.print(minCycles[i]);
+    Serial.print(F(", max ")); Serial.println(maxCycles[i]);
+  }
+  if (failedNb) errorsNb++;
+  if (HeapProbe() != probe) { Serial.println(F("Heap used by the writes")); errorsNb++; }
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+// Queue ACTIONS_QUEUE_SIZE - 1 writes of SENSOR_1 (NORMAL priority), start the sending of the first one, then
+// write SENSOR_0 with the given priority. The rank of the SENSOR_0 telegram among the sent ones (0 : first) and its
+// latency from the write are given. Return the nb of sent telegrams
+byte AlarmLatency(e_KnxPriority priority, byte& rank, unsigned long& latencyMillis) {
+  type_sent_telegram telegrams[ACTIONS_QUEUE_SIZE];
+  unsigned long startTime;
+  byte sentTelegramsNb;
+  for (byte i = 0; i < ACTIONS_QUEUE_SIZE - 1; i++) Knx.write(SENSOR_1, i & 1);
+  Run(1000); // first write popped, its telegram is being sent
+  startTime = millis();
+  Knx.write(SENSOR_0, true, priority);
+  sentTelegramsNb = RecordTelegrams(1000, telegrams, ACTIONS_QUEUE_SIZE);
+  for (rank = 0; (rank < sentTelegramsNb) && (telegrams[rank].addr != G_ADDR(0,3,0)); rank++);
+  latencyMillis = (rank < sentTelegramsNb) ? telegrams[rank].timeMillis - startTime : 0;
+  return sentTelegramsNb;
+}
+
+
+// Alarm latency under normal priority load : the alarm telegram is sent right after the telegram being sent, in
+// less than 2 telegrams time (60ms). With the NORMAL priority, the same write waits for the whole backlog.
+void AlarmBench(void) {
+  unsigned long alarmLatency, normalLatency;
+  byte alarmRank, normalRank, sentNb;
+  word errorsNb = 0;
+
+  Serial.println(F("\n########## Alarm latency bench ##########"));
+  responseDelayMicros = 20000; mutedAddr = 0;
+  Begin();
+  RunInit();
+  responseDelayMicros = 0;
+  sentNb = AlarmLatency(KNX_PRIORITY_ALARM_VALUE, alarmRank, alarmLatency);
+  Serial.print(F("ALARM priority : rank ")); Serial.print(alarmRank); Serial.print(F(" of ")); Serial.print(sentNb);
+  Serial.print(F(", latency (ms) ")); Serial.println(alarmLatency);
+  if ((sentNb != ACTIONS_QUEUE_SIZE) || (alarmRank != 1) || (alarmLatency > 60)) errorsNb++;
+  sentNb = AlarmLatency(KNX_PRIORITY_NORMAL_VALUE, normalRank, normalLatency);
+  Serial.print(F("NORMAL priority : rank ")); Serial.print(normalRank); Serial.print(F(" of ")); Serial.print(sentNb);
+  Serial.print(F(", latency (ms) ")); Serial.println(normalLatency);
+  if ((sentNb != ACTIONS_QUEUE_SIZE) || (normalRank != ACTIONS_QUEUE_SIZE - 1) || (normalLatency <= alarmLatency)) errorsNb++;
+  End();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void AllTests(void) {
+  Init();
+  Handlers();
+  Budget();
+  Transactions();
+  Retries();
+  RateLimits();
+  Policies();
+  IsrWrites();
+  WriteBench();
+  AlarmBench();
+}
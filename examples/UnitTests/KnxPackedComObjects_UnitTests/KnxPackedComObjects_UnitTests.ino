@@ -0,0 +1,189 @@
+#include <KnxDevice.h>
+#include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
+
+Cli cli = Cli(Serial);
+
+// Com objects of all the value storages : B1 values (bitset), short values (B2, B1U3, U8) and long values (arena)
+#define TEST_COM_OBJECTS(OBJ) \
+  OBJ(SWITCH,  G_ADDR(0,0,1), KNX_DPT_1_001,  COM_OBJ_LOGIC_IN) \
+  OBJ(TEMP,    G_ADDR(0,0,2), KNX_DPT_9_001,  COM_OBJ_SENSOR) \
+  OBJ(CONTROL, G_ADDR(0,0,3), KNX_DPT_2_001,  COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(ENABLE,  G_ADDR(0,0,4), KNX_DPT_1_003,  COM_OBJ_LOGIC_IN_INIT) \
+  OBJ(DIMMING, G_ADDR(0,1,5), KNX_DPT_3_007,  COM_OBJ_LOGIC_IN) \
+  OBJ(COUNT,   G_ADDR(0,1,6), KNX_DPT_5_010,  COM_OBJ_SENSOR) \
+  OBJ(LOCAL,   G_ADDR(0,0,0), KNX_DPT_14_000, 0) \
+  OBJ(ALARM,   G_ADDR(1,2,3), KNX_DPT_1_005,  COM_OBJ_SENSOR) \
+  OBJ(ENERGY,  G_ADDR(2,1,7), KNX_DPT_12_001, COM_OBJ_SENSOR)
+
+// Packed table
+KNX_PACKED_COM_OBJECTS(TEST_COM_OBJECTS, packed)
+
+// Same objects in a KnxComObject list (reference)
+#define TEST_OBJECT(name, ...) KnxComObject(__VA_ARGS__),
+KnxComObject list[] = { TEST_COM_OBJECTS(TEST_OBJECT) };
+byte longValues[2 + 4 + 4];
+
+// Compile time checks : value positions and sizes
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::B1ValuesNb(KnxComObjectsNb_) == 3, "wrong B1 values nb");
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::PackedValuePos(ENABLE) == (KNX_PACKED_COM_OBJ_B1_VALUE | 1), "wrong B1 position");
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::PackedValuePos(COUNT) == 4, "wrong value position");
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::PackedValuesSize(KnxComObjectsNb_) == 2 + 1 + 1 + 1 + 4 + 4, "wrong values size");
+static_assert(KnxComObjectTableCalc<KnxComObjectsAttr_>::ValidityBits(0) == 0xF3, "wrong validity bits");
+
+void Check(void);  // Compare the packed objects with the KnxComObject ones (attributes, values, telegrams)
+void Ram(void);    // RAM used by the packed table and by the KnxComObject list
+void Bench(void);  // Value access time, packed table vs KnxComObject list
+void Lookup(void); // Received telegram dispatch time (address lookup and update), packed table vs KnxComObject list
+void AllTests(void);
+
+
+void setup() {
+  KnxComObject::AttachLongValuesArena(list, KnxComObjectsNb_, longValues);
+  packed.SetSourceAddress(P_ADDR(1,1,1));
+  for (byte i = 0; i < KnxComObjectsNb_; i++) list[i].SetSourceAddress(P_ADDR(1,1,1));
+  cli.RegisterCmd("check",&Check);
+  cli.RegisterCmd("ram",&Ram);
+  cli.RegisterCmd("bench",&Bench);
+  cli.RegisterCmd("lookup",&Lookup);
+  cli.RegisterCmd("all",&AllTests);
+  Serial.begin(115200);
+}
+
+
+void loop() {
+  cli.Run();
+}
+
+
+// Compare the telegrams built by both objects for a given command
+word CheckTelegrams(byte index, e_KnxCommand command) {
+  KnxTelegram packedTg, refTg;
+  word errorsNb = 0;
+  packed[index].CopyToTelegram(packedTg, command);
+  list[index].CopyToTelegram(refTg, command);
+  for (byte i = 0; i < KNX_TELEGRAM_MAX_SIZE; i++)
+    if (packedTg.ReadRawByte(i) != refTg.ReadRawByte(i)) errorsNb++;
+  return errorsNb;
+}
+
+
+// Compare the values of both objects
+word CheckValues(byte index) {
+  byte packedValue[KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2], refValue[KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2];
+  word errorsNb = 0;
+  if (packed[index].GetValidity() != list[index].GetValidity()) errorsNb++;
+  packed[index].GetValue(packedValue); list[index].GetValue(refValue);
+  for (byte i = 0; i < ((list[index].GetLength() <= 2) ? 1 : list[index].GetLength() - 1); i++)
+    if (packedValue[i] != refValue[i]) errorsNb++;
+  return errorsNb + CheckTelegrams(index, KNX_COMMAND_VALUE_WRITE) + CheckTelegrams(index, KNX_COMMAND_VALUE_RESPONSE);
+}
+
+
+void Check(void) {
+  byte value[KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2];
+  KnxTelegram tg;
+  word errorsNb = 0;
+  for (byte index = 0; index < KnxComObjectsNb_; index++)
+  {
+    // attributes
+    if (packed[index].GetAddr() != list[index].GetAddr()) errorsNb++;
+    if (packed[index].GetDptId() != list[index].GetDptId()) errorsNb++;
+    if (packed[index].GetIndicator() != list[index].GetIndicator()) errorsNb++;
+    if (packed[index].GetLength() != list[index].GetLength()) errorsNb++;
+    if (packed[index].GetPriority() != list[index].GetPriority()) errorsNb++;
+    errorsNb += CheckTelegrams(index, KNX_COMMAND_VALUE_READ);
+    errorsNb += CheckValues(index);
+    // values updated by the application
+    for (byte i = 0; i < sizeof(value); i++) value[i] = 0x11 * (i + index);
+    if (list[index].GetLength() <= 2) value[0] &= (list[index].GetLength() == 1) ? 0x01 : 0xFF; // B1 value : bit 0
+    packed[index].UpdateValue(value); list[index].UpdateValue(value);
+    errorsNb += CheckValues(index);
+    if (list[index].GetLength() <= 2)
+    { // short values only
+      packed[index].ToggleValue(); list[index].ToggleValue();
+      errorsNb += CheckValues(index);
+    }
+    // values updated by a telegram
+    list[index].CopyAttributes(tg);
+    tg.SetCommand(KNX_COMMAND_VALUE_WRITE);
+    for (byte i = 0; i < sizeof(value); i++) value[i] = 0x5A + i;
+    if (list[index].GetLength() == 1) tg.SetFirstPayloadByte(1);
+    else tg.SetLongPayload(value, list[index].GetLength() - 1);
+    if (packed[index].UpdateValue(tg) != list[index].UpdateValue(tg)) errorsNb++;
+    errorsNb += CheckValues(index);
+  }
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void Ram(void) {
+  Serial.print(F("Packed table RAM size : ")); Serial.println(packed.GetRamSize());
+  Serial.print(F("KnxComObject list RAM size : "));
+  Serial.println(KnxComObjectsNb_ * sizeof(KnxComObject) + KnxComObject::GetLongValuesSize(list, KnxComObjectsNb_));
+}
+
+
+// The access duration is measured with Timer1 counting the CPU cycles (no prescaler)
+void Bench(void) {
+  word start, packedCycles, refCycles;
+  byte sum = 0;
+  noInterrupts();
+  TCCR1A = 0; TCCR1B = _BV(CS10); // CPU clock
+  start = TCNT1;
+  for (byte i = 0; i < KnxComObjectsNb_; i++) if (packed[i].GetLength() <= 2) sum += packed[i].GetValue();
+  packedCycles = TCNT1 - start;
+  start = TCNT1;
+  for (byte i = 0; i < KnxComObjectsNb_; i++) if (list[i].GetLength() <= 2) sum += list[i].GetValue();
+  refCycles = TCNT1 - start;
+  interrupts();
+  Serial.print(F("Short values read cycles : packed ")); Serial.print(packedCycles);
+  Serial.print(F(", KnxComObject ")); Serial.print(refCycles);
+  Serial.print(F(" (sum ")); Serial.print(sum); Serial.println(F(")"));
+}
+
+
+// Dispatch of a received write telegram as done by KnxDevice : address lookup in the index, then update of the
+// com objects having the W indicator (the address is given by the telegram, the length by the com object)
+template <typename T> word DispatchCycles(T& objects, const KnxAddressIndex& index, KnxTelegram& tg) {
+  type_com_obj_index firstEntry, nb, objIndex;
+  word start, cycles;
+  noInterrupts();
+  start = TCNT1;
+  nb = index.Find(tg.GetTargetAddress(), firstEntry);
+  for (type_com_obj_index i = 0; i < nb; i++)
+  {
+    objIndex = index.GetComObjectIndex(firstEntry + i);
+    if (objects[objIndex].GetIndicator() & KNX_COM_OBJ_W_INDICATOR) objects[objIndex].UpdateValue(tg);
+  }
+  cycles = TCNT1 - start;
+  interrupts();
+  return cycles;
+}
+
+
+// The duration is measured with Timer1 counting the CPU cycles (no prescaler), for a telegram to each com object
+// address. Both tables use the same address index (built at runtime from the KnxComObject list).
+void Lookup(void) {
+  KnxAddressIndex index;
+  KnxTelegram tg;
+  unsigned long packedCycles = 0, refCycles = 0;
+  if (index.Build(list, KnxComObjectsNb_) != KNX_ADDRESS_INDEX_OK) { Serial.println(F("Not enough memory!")); return; }
+  TCCR1A = 0; TCCR1B = _BV(CS10); // CPU clock
+  for (byte i = 0; i < KnxComObjectsNb_; i++)
+  {
+    list[i].CopyToTelegram(tg, KNX_COMMAND_VALUE_WRITE);
+    packedCycles += DispatchCycles(packed, index, tg);
+    refCycles += DispatchCycles(list, index, tg);
+  }
+  Serial.print(F("Dispatch cycles (")); Serial.print(KnxComObjectsNb_);
+  Serial.print(F(" telegrams) : packed ")); Serial.print(packedCycles);
+  Serial.print(F(", KnxComObject ")); Serial.println(refCycles);
+}
+
+
+void AllTests(void) {
+  Check();
+  Ram();
+  Bench();
+  Lookup();
+}
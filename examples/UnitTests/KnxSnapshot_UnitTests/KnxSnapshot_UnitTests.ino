@@ -0,0 +1,184 @@
+#include <KnxSnapshot.h>
+#include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
+
+Cli cli = Cli(Serial);
+
+// EEPROM storage with a fake clock (time in sec, 0 = no clock), counting the written bytes
+class FakeClockStorage : public KnxEepromStorage {
+  public :
+    unsigned long time;
+    word writesNb;
+    FakeClockStorage() : KnxEepromStorage(0), time(1000000), writesNb(0) {}
+    unsigned long GetTime(void) { return time; }
+    void Write(word offset, byte value) { writesNb++; KnxEepromStorage::Write(offset, value); }
+};
+
+FakeClockStorage storage;
+
+byte longValues[2 + 4]; // data space of the long values (9.001 and 14.000 objects)
+KnxComObject list[] = { KnxComObject(0x0001, KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT),  // never stale
+                        KnxComObject(longValues, 0x0002, KNX_DPT_9_001, COM_OBJ_LOGIC_IN_INIT),  // stale after 1 min
+                        KnxComObject(0x0003, KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT),  // not persistent
+                        KnxComObject(longValues + 2, 0x0004, KNX_DPT_14_000, COM_OBJ_LOGIC_IN_INIT)  // never stale
+                      };
+const word rules[] PROGMEM = { KNX_SNAPSHOT_NO_EXPIRY, 1, KNX_SNAPSHOT_NOT_PERSISTENT, KNX_SNAPSHOT_NO_EXPIRY };
+const byte listNb = sizeof(list) / sizeof(KnxComObject);
+KnxSnapshot snapshot(storage, rules);
+
+void Clear(void);    // Erase the snapshot storage
+void Attach(void);   // Attach the list to the snapshot (restore)
+void Set(void);      // Update all the com objects values
+void Save(void);     // Perform a complete save cycle
+void Restore(void);  // Restore the saved values (snapshot is 30 sec old)
+void Age(void);      // Restore the saved values (snapshot is 5 min old)
+void Default(void);  // Default rule on a clockless storage
+void Scenario(void);
+
+
+void setup() {
+  cli.RegisterCmd("c",&Clear);
+  cli.RegisterCmd("attach",&Attach);
+  cli.RegisterCmd("set",&Set);
+  cli.RegisterCmd("save",&Save);
+  cli.RegisterCmd("restore",&Restore);
+  cli.RegisterCmd("age",&Age);
+  cli.RegisterCmd("default",&Default);
+  cli.RegisterCmd("s",&Scenario);
+  Serial.begin(115200);
+}
+
+
+void loop() {
+  cli.Run();
+}
+
+
+void PrintValidity(void) {
+  Serial.print(F("Validity : "));
+  for (byte i = 0; i < listNb; i++) { Serial.print(list[i].GetValidity()); Serial.print(' '); }
+  Serial.println();
+}
+
+
+void Clear(void) {
+  for (word i = 0; i < 32; i++) storage.Write(i, 0xFF);
+  Serial.println(F("Storage erased"));
+}
+
+
+type_com_obj_index AttachNb(void) {
+  type_com_obj_index restoredNb = snapshot.Restore(list, listNb);
+  Serial.print(F("Attached, restored objects nb : ")); Serial.println(restoredNb);
+  return restoredNb;
+}
+
+
+void Attach(void) { AttachNb(); }
+
+
+void Set(void) {
+  byte value[4] = {0x11, 0x22, 0x33, 0x44};
+  list[0].UpdateValue((byte)1);
+  list[1].UpdateValue(value);
+  list[2].UpdateValue((byte)1);
+  list[3].UpdateValue(value);
+  for (byte i = 0; i < listNb; i++) snapshot.SetChanged(i); // done by KnxDevice on each update
+  PrintValidity();
+}
+
+
+// Save cycle of a snapshot, return the nb of saved records
+word SaveCycle(KnxSnapshot& snap) {
+  word savedNb = snap.GetSavedRecordsNb();
+  storage.writesNb = 0;
+  snap.StartSave();
+  for (byte i = 0; i <= listNb; i++) snap.Task(); // one changed object per call, then the header
+  savedNb = snap.GetSavedRecordsNb() - savedNb;
+  Serial.print(F("Saved records nb (changed records only) : ")); Serial.print(savedNb);
+  Serial.print(F(", written bytes nb : ")); Serial.println(storage.writesNb);
+  return savedNb;
+}
+
+
+void Save(void) { SaveCycle(snapshot); }
+
+
+type_com_obj_index RestoreWithAge(unsigned long ageSec) {
+  byte restoredLongValues[2 + 4] = {0};
+  KnxComObject restored[] = { KnxComObject(0x0001, KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT),
+                              KnxComObject(restoredLongValues, 0x0002, KNX_DPT_9_001, COM_OBJ_LOGIC_IN_INIT),
+                              KnxComObject(0x0003, KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT),
+                              KnxComObject(restoredLongValues + 2, 0x0004, KNX_DPT_14_000, COM_OBJ_LOGIC_IN_INIT) };
+  KnxSnapshot restoredSnapshot(storage, rules);
+  type_com_obj_index restoredNb;
+  byte value[4];
+  storage.time += ageSec;
+  restoredNb = restoredSnapshot.Restore(restored, listNb);
+  Serial.print(F("Restored objects nb : ")); Serial.println(restoredNb);
+  Serial.print(F("Validity : "));
+  for (byte i = 0; i < listNb; i++) { Serial.print(restored[i].GetValidity()); Serial.print(' '); }
+  Serial.println();
+  restored[3].GetValue(value);
+  Serial.print(F("Object 3 value : ")); for (byte i = 0; i < 4; i++) { Serial.print(value[i], HEX); Serial.print(' '); }
+  Serial.println();
+  storage.time -= ageSec;
+  return restoredNb;
+}
+
+
+void Restore(void) { RestoreWithAge(30); }
+
+
+void Age(void) { RestoreWithAge(300); }
+
+
+// Without rules table nor clock, nothing is restored unless NO_EXPIRY is given as default rule
+// Return the nb of errors
+word DefaultErrors(void) {
+  unsigned long time = storage.time;
+  word errorsNb = 0;
+  storage.time = 0; // no clock
+  {
+    KnxSnapshot maxAge(storage);
+    maxAge.Restore(list, listNb);
+    SaveCycle(maxAge);
+    KnxSnapshot maxAgeRestart(storage);
+    if (maxAgeRestart.Restore(list, listNb) != 0) errorsNb++; // the age is unknown
+  }
+  {
+    KnxSnapshot noExpiry(storage, NULL, KNX_SNAPSHOT_NO_EXPIRY);
+    noExpiry.Restore(list, listNb);
+    SaveCycle(noExpiry);
+    KnxSnapshot noExpiryRestart(storage, NULL, KNX_SNAPSHOT_NO_EXPIRY);
+    if (noExpiryRestart.Restore(list, listNb) != listNb) errorsNb++;
+  }
+  storage.time = time;
+  return errorsNb;
+}
+
+
+void Default(void) {
+  word errorsNb = DefaultErrors();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void Scenario(void) {
+  word errorsNb = 0;
+  Clear();
+  if (AttachNb() != 0) errorsNb++; // nothing restored, the storage is empty
+  Set();
+  if (SaveCycle(snapshot) != 3) errorsNb++; // 3 records saved (object 2 is not persistent)
+  storage.time += 60;
+  if ((SaveCycle(snapshot) != 0) || storage.writesNb) errorsNb++; // nothing changed : the header is not written
+  list[0].UpdateValue((byte)0);
+  snapshot.SetChanged(0);
+  if (SaveCycle(snapshot) != 1) errorsNb++; // 1 record saved, then the header time
+  if (storage.writesNb != 1 + 1) errorsNb++; // the value byte and the time low byte (60 sec later)
+  if (RestoreWithAge(30) != 3) errorsNb++; // 3 objects restored
+  if (RestoreWithAge(300) != 2) errorsNb++; // 2 objects restored, object 1 is stale
+  if (AttachNb() != 3) errorsNb++; // the restored objects are not saved again
+  if (SaveCycle(snapshot) != 0) errorsNb++;
+  errorsNb += DefaultErrors();
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
@@ -12,6 +12,9 @@ void CommandTests(void);
 void PayloadTests(void);
 void ChecksumTests(void);
 void CopyTests(void);
+void ChecksumIncrementalTests(void); // Compare the incremental checksum with a full rescan after random field updates
+void ChecksumBench(void); // CPU cycles of the checksum check and update, and of a telegram reception with its check
+                          // at EOP, compared with a full rescan
 void AllTests(void);
 
 
@@ -25,6 +28,8 @@ void setup(){
   cli.RegisterCmd("pld",&PayloadTests);
   cli.RegisterCmd("cks",&ChecksumTests);
   cli.RegisterCmd("copy",&CopyTests);
+  cli.RegisterCmd("ckinc",&ChecksumIncrementalTests);
+  cli.RegisterCmd("ckbench",&ChecksumBench);
   cli.RegisterCmd("all",&AllTests);
   Serial.begin(115200);
 }
@@ -229,6 +234,112 @@ void ChecksumTests(void)
 }
 
 
+// Checksum calculated by scanning all the data bytes
+byte ChecksumRescan(const KnxTelegram& telegram)
+{
+  byte xorSum = 0;
+  for (byte i = 0; i < KNX_TELEGRAM_HEADER_SIZE + telegram.GetPayloadLength() + 1; i++) xorSum ^= telegram.ReadRawByte(i);
+  return (byte)(~xorSum);
+}
+
+
+void ChecksumIncrementalTests(void)
+{
+    KnxTelegram telegram, copy;
+    byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2];
+    unsigned long errorsNb = 0;
+    Serial.println(F("\n########## Incremental Checksum Tests ##########"));
+    randomSeed(1);
+    for (word i = 0; i < 10000; i++)
+    {
+      switch (random(8))
+      {
+        case 0 : telegram.WriteRawByte(random(256), random(KNX_TELEGRAM_MAX_SIZE)); break;
+        case 1 : telegram.SetPayloadLength(random(KNX_TELEGRAM_PAYLOAD_MAX_SIZE)); break;
+        case 2 : telegram.SetTargetAddress(random(0x10000)); telegram.SetSourceAddress(random(0x10000)); break;
+        case 3 : telegram.SetCommand((e_KnxCommand) random(4)); telegram.SetFirstPayloadByte(random(64)); break;
+        case 4 : for (byte j = 0; j < sizeof(payload); j++) payload[j] = random(256);
+                 telegram.SetLongPayload(payload, random(sizeof(payload) + 1)); break;
+        case 5 : telegram.UpdateChecksum(); if (!telegram.IsChecksumCorrect()) errorsNb++; break;
+        case 6 : telegram.ChangePriority((e_KnxPriority)(random(4) << 2)); telegram.SetMulticast(random(2)); break;
+        case 7 : telegram.Copy(copy); if (copy.CalculateChecksum() != ChecksumRescan(copy)) errorsNb++;
+                 telegram.CopyHeader(copy); if (copy.CalculateChecksum() != ChecksumRescan(copy)) errorsNb++; break;
+      }
+      if (telegram.CalculateChecksum() != ChecksumRescan(telegram)) errorsNb++;
+    }
+    Serial.print(F("Checksum errors : ")); Serial.println(errorsNb);
+}
+
+
+void ChecksumAssemblyBench(byte payloadLength);
+
+// The durations are measured with Timer1 counting the CPU cycles (no prescaler)
+void ChecksumBench(void)
+{
+    KnxTelegram telegram;
+    byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2] = {0};
+    word start, overhead, checkCycles, updateCycles, rescanCycles;
+    volatile byte result;
+    Serial.println(F("\n########## Checksum Bench ##########"));
+    for (byte length = 1; length < KNX_TELEGRAM_PAYLOAD_MAX_SIZE; length += 7)
+    {
+      telegram.SetPayloadLength(length);
+      telegram.SetLongPayload(payload, length - 1);
+      noInterrupts();
+      TCCR1A = 0; TCCR1B = _BV(CS10); // CPU clock
+      start = TCNT1; overhead = TCNT1 - start;
+      start = TCNT1; telegram.UpdateChecksum(); updateCycles = TCNT1 - start - overhead;
+      start = TCNT1; result = telegram.IsChecksumCorrect(); checkCycles = TCNT1 - start - overhead;
+      start = TCNT1; result = (telegram.GetChecksum() == ChecksumRescan(telegram)); rescanCycles = TCNT1 - start - overhead;
+      interrupts();
+      Serial.print(F("Payload length ")); Serial.print(length);
+      Serial.print(F(" : UpdateChecksum() ")); Serial.print(updateCycles);
+      Serial.print(F(" cycles, IsChecksumCorrect() ")); Serial.print(checkCycles);
+      Serial.print(F(" cycles, full rescan ")); Serial.print(rescanCycles);
+      Serial.print(F(" cycles => ")); Serial.print(rescanCycles - checkCycles); Serial.println(F(" cycles saved per check"));
+    }
+    ChecksumAssemblyBench(1);  // 9 bytes telegram
+    ChecksumAssemblyBench(15); // 23 bytes telegram
+}
+
+
+// Reception of a whole telegram (raw bytes written one by one) followed by the checksum check at EOP :
+// with the incremental checksum (WriteRawByte() then IsChecksumCorrect()), and in the former way (the raw bytes
+// are stored as is, then the checksum is calculated by rescanning the data bytes)
+// The durations are measured with Timer1 counting the CPU cycles (no prescaler)
+void ChecksumAssemblyBench(byte payloadLength)
+{
+    KnxTelegram ref, telegram;
+    byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2], raw[KNX_TELEGRAM_MAX_SIZE], length, xorSum, i;
+    word start, overhead, incrementalCycles, rescanCycles;
+    volatile byte result;
+    for (i = 0; i < sizeof(payload); i++) payload[i] = 0x11 * i;
+    ref.SetTargetAddress(0x1234); ref.SetSourceAddress(0x1101);
+    ref.SetPayloadLength(payloadLength);
+    ref.SetLongPayload(payload, payloadLength - 1);
+    ref.UpdateChecksum();
+    length = ref.GetTelegramLength();
+    noInterrupts();
+    TCCR1A = 0; TCCR1B = _BV(CS10); // CPU clock
+    start = TCNT1; overhead = TCNT1 - start;
+    start = TCNT1;
+    for (i = 0; i < length; i++) telegram.WriteRawByte(ref.ReadRawByte(i), i);
+    result = telegram.IsChecksumCorrect();
+    incrementalCycles = TCNT1 - start - overhead;
+    start = TCNT1;
+    for (i = 0; i < length; i++) raw[i] = ref.ReadRawByte(i);
+    xorSum = 0;
+    for (i = 0; i < length - 1; i++) xorSum ^= raw[i];
+    result = ((byte)(~xorSum) == raw[length - 1]);
+    rescanCycles = TCNT1 - start - overhead;
+    interrupts();
+    Serial.print(F("Telegram of ")); Serial.print(length);
+    Serial.print(F(" bytes, assembly and EOP check : incremental ")); Serial.print(incrementalCycles);
+    Serial.print(F(" cycles, full rescan ")); Serial.print(rescanCycles); Serial.print(F(" cycles"));
+    Serial.println(telegram.IsChecksumCorrect() ? "" : " CHECKSUM ERROR!");
+}
+
+
 void CopyTests(void)
 {
      String traces;
@@ -281,4 +392,6 @@ void AllTests(void)
   PayloadTests();
   ChecksumTests();
   CopyTests();
+  ChecksumIncrementalTests();
+  ChecksumBench();
 }
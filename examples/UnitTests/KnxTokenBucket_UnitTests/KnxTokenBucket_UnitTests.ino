@@ -0,0 +1,119 @@
+#include <KnxDevice.h>
+#include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
+
+Cli cli = Cli(Serial);
+
+// Simulated TP line : about 50 telegrams per second (a telegram and its acknowledge take 20ms)
+#define BUS_TELEGRAM_MILLIS 20
+#define BUS_DEVICES_NB 4
+#define BUS_QUEUE_SIZE 16         // Telegrams waiting in a device (the oldest one is lost when full)
+#define BUS_DURATION_MILLIS 10000 // Simulated time of a scenario
+
+KnxTokenBucket buckets[BUS_DEVICES_NB];
+word sentNb[BUS_DEVICES_NB], offeredNb[BUS_DEVICES_NB];
+
+void Bucket(void); // Token bucket rate and burst
+void Bus(void);    // Bus sharing between devices under overload, with and without rate limits
+void AllTests(void);
+
+
+void setup() {
+  cli.RegisterCmd("bucket",&Bucket);
+  cli.RegisterCmd("bus",&Bus);
+  cli.RegisterCmd("all",&AllTests);
+  Serial.begin(115200);
+}
+
+
+void loop() {
+  cli.Run();
+}
+
+
+void Bucket(void) {
+  KnxTokenBucket bucket;
+  word errorsNb = 0;
+  // no limit
+  for (byte i = 0; i < 100; i++) { if (!bucket.Available(0)) errorsNb++; bucket.Take(); }
+  // 1 token every 100ms, 3 tokens burst
+  bucket.SetRate(100, 3, 0);
+  for (byte i = 0; i < 3; i++) { if (!bucket.Available(0)) errorsNb++; bucket.Take(); }
+  if (bucket.Available(0) || bucket.Available(99)) errorsNb++;
+  if (!bucket.Available(100)) errorsNb++;
+  bucket.Take();
+  if (bucket.Available(150) || !bucket.Available(210)) errorsNb++; // the 10ms late call does not delay the next token
+  bucket.Take();
+  if (bucket.Available(299) || !bucket.Available(300)) errorsNb++;
+  // burst after a quiet time
+  for (byte i = 0; i < 3; i++) { if (!bucket.Available(10000)) errorsNb++; bucket.Take(); }
+  if (bucket.Available(10000)) errorsNb++;
+  // long term rate : 1 token per period
+  word takenNb = 0;
+  for (unsigned long t = 20000; t < 30000; t++) if (bucket.Available(t)) { bucket.Take(); takenNb++; }
+  if ((takenNb < 99) || (takenNb > 103)) errorsNb++;
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+// Simulate BUS_DURATION_MILLIS of bus activity
+// Each device gets a new telegram to send every producePeriods[i] msec. When the bus is free, the devices having
+// a telegram and a token start sending : the lowest physical address wins the arbitration (device 0 first).
+void Simulate(const word producePeriods[], const word limitPeriods[]) {
+  byte queuedNb[BUS_DEVICES_NB];
+  unsigned long busFreeTime = 0;
+  word busNb = 0;
+  for (byte i = 0; i < BUS_DEVICES_NB; i++)
+  {
+    buckets[i].SetRate(limitPeriods[i], 5, 0);
+    queuedNb[i] = 0; sentNb[i] = 0; offeredNb[i] = 0;
+  }
+  for (unsigned long t = 0; t < BUS_DURATION_MILLIS; t++)
+  {
+    for (byte i = 0; i < BUS_DEVICES_NB; i++)
+      if (!(t % producePeriods[i])) { offeredNb[i]++; if (queuedNb[i] < BUS_QUEUE_SIZE) queuedNb[i]++; }
+    if (t < busFreeTime) continue; // telegram ongoing
+    for (byte i = 0; i < BUS_DEVICES_NB; i++)
+    {
+      if (!queuedNb[i] || !buckets[i].Available(t)) continue;
+      buckets[i].Take(); queuedNb[i]--; sentNb[i]++; busNb++;
+      busFreeTime = t + BUS_TELEGRAM_MILLIS;
+      break; // arbitration won
+    }
+  }
+  for (byte i = 0; i < BUS_DEVICES_NB; i++)
+  {
+    Serial.print(F("  device ")); Serial.print(i);
+    Serial.print(F(" : sent ")); Serial.print(sentNb[i]); Serial.print(F("/")); Serial.print(offeredNb[i]);
+    Serial.print(F(", bus share ")); Serial.print(busNb ? (sentNb[i] * 100UL) / busNb : 0); Serial.println(F("%"));
+  }
+}
+
+
+void Bus(void) {
+  // device 0 floods the bus (200 telegrams/s), the other ones send 10 telegrams/s
+  const word floodPeriods[BUS_DEVICES_NB] = { 5, 100, 100, 100 };
+  const word noLimits[BUS_DEVICES_NB] = { 0, 0, 0, 0 };
+  const word floodLimit[BUS_DEVICES_NB] = { 50, 0, 0, 0 }; // device 0 limited to 20 telegrams/s
+  // all the devices flood the bus, and are limited to 10 telegrams/s each (40 telegrams/s in all)
+  const word allFloodPeriods[BUS_DEVICES_NB] = { 5, 5, 5, 5 };
+  const word allLimits[BUS_DEVICES_NB] = { 100, 100, 100, 100 };
+  word errorsNb = 0;
+
+  Serial.println(F("Device 0 flooding, no rate limit :"));
+  Simulate(floodPeriods, noLimits);
+  if (sentNb[0] < 9 * (sentNb[1] + sentNb[2] + sentNb[3])) errorsNb++; // device 0 takes the bus
+  Serial.println(F("Device 0 flooding, limited to 20 telegrams/s :"));
+  Simulate(floodPeriods, floodLimit);
+  for (byte i = 1; i < BUS_DEVICES_NB; i++) if (sentNb[i] * 10UL < offeredNb[i] * 9UL) errorsNb++; // others served
+  if (sentNb[0] > (BUS_DURATION_MILLIS / 50) + 5) errorsNb++;
+  Serial.println(F("All the devices flooding, limited to 10 telegrams/s :"));
+  Simulate(allFloodPeriods, allLimits);
+  for (byte i = 1; i < BUS_DEVICES_NB; i++) if ((sentNb[i] + 5 < sentNb[0]) || (sentNb[i] > sentNb[0] + 5)) errorsNb++; // fair share
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void AllTests(void) {
+  Bucket();
+  Bus();
+}
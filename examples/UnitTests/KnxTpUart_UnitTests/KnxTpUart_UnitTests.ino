@@ -9,11 +9,16 @@
 //  - the feedback status of the channel is configured on EIB address 0x0002
 
 #include <KnxDevice.h>
+#include <KnxTpUartSim.h> // simulated TPUART link, used by the tests marked (SIM) : no TPUART needed
 // NB 1 : "KNXTPUART_DEBUG_INFO" and "KNXTPUART_DEBUG_ERROR" flags shall be set in order to get KnxTpUart traces
 // NB 2 : IsAddressAssigned() function shall be made public in KnxTpUart class (in KnxTpUart.h file) for Attach_Tests() test
+// NB 3 : "KNXTPUART_RX_INTERRUPT" flag shall be set for Normal_Rx_Isr() test, and shall not be set for Normal_Rx_Stall() test
 #include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
 
 Cli cli = Cli(Serial);
+KnxTpUartSim tpuartSim;
+KnxTpUart *simTpUart; // TPUART fed by the simulated UART RX interrupt
+word isrWritesNb;     // Nb of characters written on the link from the simulated UART RX interrupt
 String traces;
 KnxComObject objList[] =
 {
@@ -21,7 +26,7 @@ KnxComObject objList[] =
   KnxComObject(0x0002, KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_LOGIC_IN) , // feedback status of the switched actuator
   KnxComObject(0x0003, KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_LOGIC_IN) , // Push button command
 };
-byte resetEvt, newTgEvt, newStateEvt, ackEvt;
+byte resetEvt, newTgEvt, newStateEvt, ackEvt, rxErrorEvt;
 e_TpUartTxAck ackVal;
 
 
@@ -65,6 +70,7 @@ void eventCallback(e_KnxTpUartEvent evt)
   if ( evt == TPUART_EVENT_RESET) resetEvt++;
   if ( evt == TPUART_EVENT_RECEIVED_EIB_TELEGRAM) newTgEvt++;
   if ( evt == TPUART_EVENT_STATE_INDICATION) newStateEvt++;
+  if ( evt == TPUART_EVENT_EIB_TELEGRAM_RECEPTION_ERROR) rxErrorEvt++;
 }
 
 
@@ -76,10 +82,15 @@ void ackCallback(e_TpUartTxAck ack)
 
 
 void Reset_Tests(void);         // Test Reset function
+void Async_Reset_Tests(void);   // Test non-blocking reset (StartReset/ResetTask) with retry backoff
+void Async_Reset_Sim(void);     // (SIM) Test reset duration when a failed reset is started again
 void Attach_Tests(void);        // Attach Tests
 void Init_Tests(void);          // Test Init function
 void Bus_Monitoring(void);      // Test Bus Monitoring mode
 void Normal_Rx(void);           // Test addressed telegrams reception
+void Normal_Rx_Stall(void);     // (SIM) Test addressed telegrams reception with 10ms loop stalls
+void Normal_Rx_Burst(void);     // (SIM) Test RX queue with bursts of back-to-back telegrams
+void Normal_Rx_Isr(void);       // (SIM) Test RX INTERRUPT mode : reset, ACK services written by the interrupt
 void Normal_Rx_ResetEvt(void);  // Test Reset Event reception
 void Normal_Rx_StateEvt(void);  // Test State Event reception
 void Normal_Tx_Val0(void);      // Test telegram transmission : Send boolean value 1 to valid address 0x0001 (switch actuator OFF)
@@ -87,15 +98,21 @@ void Normal_Tx_Val1(void);      // Test telegram transmission : Send boolean val
 void Normal_Tx_NoAck(void);     // Test telegram transmission with NoAck (target address does not exist)
 void Normal_Tx_Timeout(void);   // Test telegram transmission with no answer timeout (no asnwer got from the TPUART)
 void Normal_Tx_Reset(void);     // Test telegram transmission with reset response
+void Normal_Tx_Burst(void);     // (SIM) Test telegram transmission duration : the telegram pieces are written in bursts
 void All_Tests(void);
 
 
 void setup(){
   cli.RegisterCmd("reset",&Reset_Tests);
+  cli.RegisterCmd("areset",&Async_Reset_Tests);
+  cli.RegisterCmd("aresetsim",&Async_Reset_Sim);
   cli.RegisterCmd("attach",&Attach_Tests);
   cli.RegisterCmd("init",&Init_Tests);
   cli.RegisterCmd("moni",&Bus_Monitoring);
   cli.RegisterCmd("rx",&Normal_Rx);
+  cli.RegisterCmd("rxstall",&Normal_Rx_Stall);
+  cli.RegisterCmd("rxburst",&Normal_Rx_Burst);
+  cli.RegisterCmd("rxisr",&Normal_Rx_Isr);
   cli.RegisterCmd("rxreset",&Normal_Rx_ResetEvt);
   cli.RegisterCmd("rxstate",&Normal_Rx_StateEvt);
   cli.RegisterCmd("tx0",&Normal_Tx_Val0);  
@@ -103,6 +120,7 @@ void setup(){
   cli.RegisterCmd("txnoack",&Normal_Tx_NoAck);
   cli.RegisterCmd("txnoans",&Normal_Tx_Timeout);
   cli.RegisterCmd("txreset",&Normal_Tx_Reset);
+  cli.RegisterCmd("txburst",&Normal_Tx_Burst);
   cli.RegisterCmd("all",&All_Tests);
   Serial.begin(115200);
 }
@@ -128,6 +146,29 @@ void Reset_Tests(void)
 }
 
 
+void Async_Reset_Tests(void)
+// NB : disconnect the TPUART to check the retries and the failure (3 attempts of 200ms, backoff 100ms then 200ms)
+{
+    e_TpUartResetStatus status;
+    unsigned long callsNb = 0, startTime;
+    Serial.println(F("\n########## Async Reset Tests ##########"));
+    Serial.println(F("Requesting Reset..."));
+    KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
+    tpuart.SetDebugString(&traces);
+    tpuart.SetResetPolicy(200, 100, 3);
+
+    startTime = millis();
+    tpuart.StartReset();
+    do { status = tpuart.ResetTask(); callsNb++; } // the loop keeps running during the reset
+    while ((status != TPUART_RESET_STATUS_DONE) && (status != TPUART_RESET_STATUS_FAILED));
+    TracesDisplay();
+    Serial.print(F("Reset status = ")); Serial.println(status);
+    Serial.print(F("ResetTask calls nb = ")); Serial.println(callsNb);
+    Serial.print(F("Elapsed time (ms) = ")); Serial.println(millis() - startTime);
+    if (status == TPUART_RESET_STATUS_DONE) { Serial.print(F("Reset duration (ms) = ")); Serial.println(tpuart.GetLastResetDuration()); }
+}
+
+
 void Attach_Tests()
 // WARNING : IsAddressAssigned() function shall be made public (private by default) for this test
 {
@@ -162,12 +203,13 @@ byte return_val;
     Serial.print(F("Attach return val = ")); Serial.println(return_val);
     for (byte i=0; i<sizeof(list)/sizeof(KnxComObject); i++)
     {
-      byte index;
-      return_val = tpuart.IsAddressAssigned(list[i].GetAddr(), index);
+      type_com_obj_index firstEntry, nb;
+      return_val = tpuart.IsAddressAssigned(list[i].GetAddr(), firstEntry, nb);
       Serial.print(F("Adress=")); Serial.print(list[i].GetAddr(), HEX);
       if (return_val)
       {
-        Serial.print(F(" => index=")); Serial.println(index);           
+        Serial.print(F(" => first entry=")); Serial.print(firstEntry);
+        Serial.print(F(", objects nb=")); Serial.println(nb);
       }
       else
       {
@@ -197,12 +239,13 @@ byte return_val;
     Serial.print(F("Attach return val = ")); Serial.println(return_val);
     for (byte i=0; i<sizeof(list)/sizeof(KnxComObject); i++)
     {
-      byte index;
-      return_val = tpuart.IsAddressAssigned(list[i].GetAddr(), index);
+      type_com_obj_index firstEntry, nb;
+      return_val = tpuart.IsAddressAssigned(list[i].GetAddr(), firstEntry, nb);
       Serial.print(F("Adress=")); Serial.print(list[i].GetAddr(), HEX);
       if (return_val)
       {
-        Serial.print(F(" => index=")); Serial.println(index);           
+        Serial.print(F(" => first entry=")); Serial.print(firstEntry);
+        Serial.print(F(", objects nb=")); Serial.println(nb);
       }
       else
       {
@@ -236,12 +279,13 @@ byte return_val;
     Serial.print(F("Attach return val = ")); Serial.println(return_val);
     for (byte i=0; i<sizeof(list)/sizeof(KnxComObject); i++)
     {
-      byte index;
-      return_val = tpuart.IsAddressAssigned(list[i].GetAddr(), index);
+      type_com_obj_index firstEntry, nb;
+      return_val = tpuart.IsAddressAssigned(list[i].GetAddr(), firstEntry, nb);
       Serial.print(F("Adress=")); Serial.print(list[i].GetAddr(), HEX);
       if (return_val)
       {
-        Serial.print(F(" => index=")); Serial.println(index);           
+        Serial.print(F(" => first entry=")); Serial.print(firstEntry);
+        Serial.print(F(", objects nb=")); Serial.println(nb);
       }
       else
       {
@@ -275,12 +319,13 @@ byte return_val;
     Serial.print(F("Attach return val = ")); Serial.println(return_val);
     for (byte i=0; i<sizeof(list)/sizeof(KnxComObject); i++)
     {
-      byte index;
-      return_val = tpuart.IsAddressAssigned(list[i].GetAddr(), index);
+      type_com_obj_index firstEntry, nb;
+      return_val = tpuart.IsAddressAssigned(list[i].GetAddr(), firstEntry, nb);
       Serial.print(F("Adress=")); Serial.print(list[i].GetAddr(), HEX);
       if (return_val)
       {
-        Serial.print(F(" => index=")); Serial.println(index);           
+        Serial.print(F(" => first entry=")); Serial.print(firstEntry);
+        Serial.print(F(", objects nb=")); Serial.println(nb);
       }
       else
       {
@@ -389,7 +434,6 @@ void Normal_Rx(void)
   Serial.println(F("\n########## RX Tests  ##########"));
   Serial.println(F("Press Enter to stop  the test..."));
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-  KnxTelegram &tg = tpuart.GetReceivedTelegram();
   tpuart.SetDebugString(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
@@ -407,7 +451,8 @@ void Normal_Rx(void)
     {
       newTgEvt--;
       Serial.print("Telegram received, index="); Serial.println(tpuart.GetTargetedComObjectIndex());
-      PrintTelegramInfo(tg);
+      PrintTelegramInfo(*tpuart.GetReceivedTelegram());
+      tpuart.ReleaseReceivedTelegram();
     }
     if (Serial.available()) running = 0;
   }
@@ -415,11 +460,265 @@ void Normal_Rx(void)
 }
 
 
+// Start a TPUART on the simulated link
+void SimStart(KnxTpUart& tpuart)
+{
+  tpuartSim.ClearStats();
+  tpuart.Reset();
+  tpuart.SetEvtCallback(eventCallback);
+  tpuart.SetAckCallback(ackCallback);
+  tpuart.AttachComObjectsList(objList,sizeof(objList)/sizeof(KnxComObject));
+  tpuart.Init();
+  newTgEvt = 0; rxErrorEvt = 0; ackEvt = 0;
+}
+
+
+// Run the RX task every 400us during durationMicros, the received telegrams are released
+void SimRx(KnxTpUart& tpuart, unsigned long durationMicros)
+{
+unsigned long startTime = micros();
+
+  while ((micros() - startTime) < durationMicros)
+  {
+    delayMicroseconds(400);
+    tpuart.RXTask();
+    while (tpuart.GetReceivedTelegram()) tpuart.ReleaseReceivedTelegram();
+  }
+}
+
+
+// Run the TPUART tasks during durationMicros (RX task every 400us, TX task every 800us), the received telegrams
+// are released (unless release is false). The simulated UART RX interrupt (RX hook) is raised every 100us.
+void SimRun(KnxTpUart& tpuart, unsigned long durationMicros, boolean release = true)
+{
+unsigned long startTime = micros();
+byte step = 0;
+
+  while ((micros() - startTime) < durationMicros)
+  {
+    delayMicroseconds(100);
+    tpuartSim.Task();
+    step++;
+    if (!(step % 4))
+    {
+      tpuart.RXTask();
+      if (release) while (tpuart.GetReceivedTelegram()) tpuart.ReleaseReceivedTelegram();
+    }
+    if (!(step % 8)) tpuart.TXTask();
+  }
+}
+
+
+// Simulated UART RX interrupt : the received byte is handed to RXInterrupt(), which writes the ACK services
+void SimRxInterrupt(byte data)
+{
+#if defined(KNXTPUART_RX_INTERRUPT)
+word writtenNb = tpuartSim.GetWrittenNb();
+
+  simTpUart->RXInterrupt(data);
+  if (tpuartSim.GetWrittenNb() != writtenNb) isrWritesNb++;
+#endif
+}
+
+
+// Build a write telegram to a com object address
+void SimTelegram(KnxTelegram& tg, word addr, byte value)
+{
+  tg.ClearTelegram();
+  tg.SetSourceAddress(0x1101);
+  tg.SetTargetAddress(addr);
+  tg.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  tg.SetFirstPayloadByte(value);
+  tg.UpdateChecksum();
+}
+
+
+void Normal_Rx_Stall(void)
+// (SIM) The RX task is stopped during 10ms every 30ms while 30 telegrams are received at full bus load :
+// all of them shall be received without error.
+// Then a stall hides the gap between 2 telegrams and ends while the 2nd one is still being received :
+// the arrival times of the buffered bytes shall remain close to the real ones (no false EOP on the 2nd telegram).
+{
+  KnxTelegram tg;
+  byte injectedNb = 0;
+  word errorsNb = 0;
+  unsigned long lastStallTime, startTime;
+  long stallMicros;
+
+  Serial.println(F("\n########## RX Tests with loop stalls (SIM) ##########"));
+#if defined(KNXTPUART_RX_INTERRUPT)
+  Serial.println(F("KNXTPUART_RX_INTERRUPT flag shall not be set for this test"));
+  return;
+#endif
+  KnxTpUart tpuart(tpuartSim, 0x1234, NORMAL);
+  SimStart(tpuart);
+  startTime = millis(); lastStallTime = startTime;
+  while ((injectedNb < 30) || tpuartSim.GetRxPendingNb())
+  {
+    if ((injectedNb < 30) && (tpuartSim.GetRxPendingNb() <= KNX_TPUART_SIM_RX_SIZE - KNX_TELEGRAM_MAX_SIZE))
+    {
+      SimTelegram(tg, (injectedNb % 3) + 1, injectedNb & 1);
+      tpuartSim.ReceiveTelegram(tg, 3000);
+      injectedNb++;
+    }
+    SimRx(tpuart, 400);
+    if ((millis() - lastStallTime) > 30)
+    { // simulate an application doing some long processing
+      delay(10);
+      lastStallTime = millis();
+    }
+    if ((millis() - startTime) > 2000) break; // the injected bytes are not read
+  }
+  SimRx(tpuart, 5000);
+  Serial.print(F("Telegrams received = ")); Serial.print(newTgEvt);
+  Serial.print(F(", errors = ")); Serial.println(rxErrorEvt);
+  if ((newTgEvt != 30) || rxErrorEvt) errorsNb++;
+
+  // the stall starts after 2 bytes of the 1st telegram, and ends after the routing field of the 2nd one
+  newTgEvt = 0; rxErrorEvt = 0;
+  SimTelegram(tg, 0x0001, 1);
+  tpuartSim.ReceiveTelegram(tg);
+  tpuartSim.ReceiveTelegram(tg, 3000);
+  while (tpuartSim.GetRxPendingNb() > 2 * tg.GetTelegramLength() - 2) SimRx(tpuart, 100);
+  stallMicros = (long)(tpuartSim.GetRxLastTime() - micros())
+                - (tg.GetTelegramLength() - KNX_TELEGRAM_HEADER_SIZE) * TPUART_CHAR_TIME_MICROSEC + 100;
+  if (stallMicros > 0) delayMicroseconds(stallMicros);
+  tpuart.RXTask(); // the next byte arrives after the next RXTask() call : the buffer is found empty
+  SimRx(tpuart, 10000);
+  Serial.print(F("Telegrams received after the stall = ")); Serial.print(newTgEvt);
+  Serial.print(F(", errors = ")); Serial.println(rxErrorEvt);
+  if ((newTgEvt != 2) || rxErrorEvt) errorsNb++;
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void Normal_Rx_Burst(void)
+// (SIM) A burst of 8 back-to-back write telegrams (to addresses 0x0001 to 0x0003) is received at full speed, the bytes
+// being spaced by one character time and the telegrams by the min EOP gap.
+// 1st burst : the RX queue is not processed during the burst, (TPUART_RX_QUEUE_SIZE - 1) telegrams shall be queued
+// and the others counted as overflows
+// 2nd burst : the RX queue is processed after each telegram, no telegram shall be lost
+// In RX INTERRUPT mode, the bytes are handed to RXInterrupt() by the simulated UART RX interrupt.
+{
+  KnxTelegram tg;
+  byte burst, i, receivedNb;
+  word errorsNb = 0;
+
+  Serial.println(F("\n########## RX queue burst tests (SIM) ##########"));
+  KnxTpUart tpuart(tpuartSim, 0x1234, NORMAL);
+#if defined(KNXTPUART_RX_INTERRUPT)
+  simTpUart = &tpuart;
+  tpuartSim.SetRxHook(SimRxInterrupt);
+#endif
+  SimStart(tpuart);
+  for (burst = 0; burst < 2; burst++)
+  {
+    newTgEvt = 0; rxErrorEvt = 0; receivedNb = 0;
+    for (i = 0; i < 8; i++)
+    {
+      SimTelegram(tg, (i % 3) + 1, i & 1);
+      tpuartSim.ReceiveTelegram(tg, TPUART_EOP_GAP_MICROSEC + 100);
+      while (tpuartSim.GetRxPendingNb() > tg.GetTelegramLength()) SimRun(tpuart, 400, false);
+      if (burst) while (tpuart.GetReceivedTelegram()) { tpuart.ReleaseReceivedTelegram(); receivedNb++; }
+    }
+    SimRun(tpuart, 10000, false);
+    while (tpuart.GetReceivedTelegram()) { tpuart.ReleaseReceivedTelegram(); receivedNb++; }
+    Serial.print(F("Burst ")); Serial.print(burst + 1);
+    Serial.print(F(" : received telegrams = ")); Serial.print(receivedNb);
+    Serial.print(F(", events = ")); Serial.print(newTgEvt);
+    Serial.print(F(", errors = ")); Serial.print(rxErrorEvt);
+    Serial.print(F(", overflows (total) = ")); Serial.print(tpuart.GetRxOverflowsNb());
+    Serial.print(F(", queue max nb = ")); Serial.println(tpuart.GetRxQueueMaxNb());
+    if (rxErrorEvt || (newTgEvt != receivedNb)) errorsNb++;
+    if (!burst && ((receivedNb != TPUART_RX_QUEUE_SIZE - 1) || (tpuart.GetRxOverflowsNb() != 8 - receivedNb))) errorsNb++;
+    if (burst && ((receivedNb != 8) || (tpuart.GetRxOverflowsNb() != 9 - TPUART_RX_QUEUE_SIZE))) errorsNb++;
+  }
+  tpuartSim.SetRxHook(NULL);
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void Normal_Rx_Isr(void)
+// (SIM) RX INTERRUPT mode : the received bytes are handed to RXInterrupt() by a simulated UART RX interrupt
+// - Reset() shall get the reset indication through the interrupt
+// - 10 addressed and 10 not addressed telegrams are received while a telegram is sent : the ACK services shall be
+//   written within 1,7ms, and the interrupt shall never write the link during a writing of the main context
+// - the routing field of an addressed telegram arrives during a writing of the main context : the ACK service shall
+//   be written by the main context right after its writing
+// - an addressed and a not addressed telegrams are received while the main loop is stalled (no RXTask()/TXTask()
+//   call for 15ms) : the interrupt shall write both ACK services within 1,7ms
+{
+#if defined(KNXTPUART_RX_INTERRUPT)
+  KnxTelegram tg, txTg;
+  word errorsNb = 0;
+  unsigned long startTime;
+  long waitMicros;
+  word writtenNb;
+
+  Serial.println(F("\n########## RX interrupt tests (SIM) ##########"));
+  KnxTpUart tpuart(tpuartSim, 0x1234, NORMAL);
+  simTpUart = &tpuart; isrWritesNb = 0;
+  tpuartSim.SetRxHook(SimRxInterrupt);
+  SimStart(tpuart);
+  if (tpuart.GetResetStatus() != TPUART_RESET_STATUS_DONE) errorsNb++;
+  for (byte i = 0; i < 20; i++)
+  {
+    SimTelegram(tg, (i & 1) ? 0x0001 : 0x0009 /* not assigned */, i & 1);
+    tpuartSim.ReceiveTelegram(tg, 3000);
+    if (i == 5) { SimTelegram(txTg, 0x0002, 1); tpuart.SendTelegram(txTg); }
+    SimRun(tpuart, 8000);
+  }
+  SimRun(tpuart, 10000);
+  // the interrupt does not run till the routing field arrival, then it occurs during the STATE REQUEST writing
+  SimTelegram(tg, 0x0001, 1);
+  tpuartSim.ReceiveTelegram(tg, 3000);
+  waitMicros = (long)(tpuartSim.GetRxLastTime() - micros())
+               - (tg.GetTelegramLength() - KNX_TELEGRAM_HEADER_SIZE) * TPUART_CHAR_TIME_MICROSEC + 10;
+  if (waitMicros > 0) delayMicroseconds(waitMicros);
+  writtenNb = isrWritesNb;
+  tpuart.DEBUG_SendStateReqCommand();
+  Serial.print(F("ACK service during a writing : written by the interrupt = ")); Serial.print(isrWritesNb - writtenNb);
+  Serial.print(F(", by the main context = ")); Serial.println(tpuartSim.GetAcksNb(true) - 10 - (isrWritesNb - writtenNb));
+  if ((tpuartSim.GetAcksNb(true) != 11) || (isrWritesNb != writtenNb)) errorsNb++;
+  SimRun(tpuart, 10000);
+  // the main loop is stalled : only the UART RX interrupt runs
+  SimTelegram(tg, 0x0001, 1);
+  tpuartSim.ReceiveTelegram(tg, 3000);
+  SimTelegram(tg, 0x0009 /* not assigned */, 1);
+  tpuartSim.ReceiveTelegram(tg, 3000);
+  startTime = micros();
+  while ((micros() - startTime) < 15000) { delayMicroseconds(100); tpuartSim.Task(); }
+  Serial.print(F("ACK services during the stall : addressed = ")); Serial.print(tpuartSim.GetAcksNb(true) - 11);
+  Serial.print(F(", not addressed = ")); Serial.println(tpuartSim.GetAcksNb(false) - 10);
+  if ((tpuartSim.GetAcksNb(true) != 12) || (tpuartSim.GetAcksNb(false) != 11)) errorsNb++;
+  SimRun(tpuart, 10000);
+  tpuartSim.SetRxHook(NULL);
+  Serial.print(F("Reset status = ")); Serial.println(tpuart.GetResetStatus());
+  Serial.print(F("ACK services : addressed = ")); Serial.print(tpuartSim.GetAcksNb(true));
+  Serial.print(F(", not addressed = ")); Serial.print(tpuartSim.GetAcksNb(false));
+  Serial.print(F(", max delay (us) = ")); Serial.println(tpuartSim.GetAckMaxDelay());
+  Serial.print(F("Characters written by the interrupt = ")); Serial.print(isrWritesNb);
+  Serial.print(F(", during a main context writing = ")); Serial.println(tpuartSim.GetNestedWritesNb());
+  Serial.print(F("Telegrams received = ")); Serial.print(newTgEvt);
+  Serial.print(F(", errors = ")); Serial.print(rxErrorEvt);
+  Serial.print(F(", sent = ")); Serial.print(tpuartSim.GetSentTelegramsNb());
+  Serial.print(F(", ack = ")); Serial.println(ackVal);
+  if ((tpuartSim.GetAcksNb(true) != 12) || (tpuartSim.GetAcksNb(false) != 11)) errorsNb++;
+  if (tpuartSim.GetAckMaxDelay() > 1700) errorsNb++;
+  if (tpuartSim.GetNestedWritesNb()) errorsNb++;
+  if ((newTgEvt != 12) || rxErrorEvt) errorsNb++;
+  if ((tpuartSim.GetSentTelegramsNb() != 1) || (ackEvt != 1) || (ackVal != ACK_RESPONSE)) errorsNb++;
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+#else
+  Serial.println(F("KNXTPUART_RX_INTERRUPT flag shall be set for this test"));
+#endif
+}
+
+
 void Normal_Rx_ResetEvt(void)
 {
   Serial.println(F("\n########## Reset Event reception test  ##########"));
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-  KnxTelegram &tg = tpuart.GetReceivedTelegram();
   tpuart.SetDebugString(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
@@ -447,7 +746,6 @@ void Normal_Rx_StateEvt(void)
 {
   Serial.println(F("\n########## State Event reception test  ##########"));  
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-  KnxTelegram &tg = tpuart.GetReceivedTelegram();
   tpuart.SetDebugString(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
@@ -661,13 +959,111 @@ void Normal_Tx_Reset(void)
 }
 
 
+void Normal_Tx_Burst(void)
+// (SIM) A F16 value (11 bytes telegram, i.e. 22 characters) is sent with the TX task called every 800us, then every
+// 2ms : the telegram pieces are written in bursts (up to TPUART_TX_MAX_PENDING_CHARS waiting characters), so that
+// the telegram leaves the UART after its wire time (22 characters at 19200 baud, i.e. 12.6ms), plus the delay of
+// the first TX task call. NB : with one telegram piece written per call, it would take 22ms with the 2ms period.
+{
+  const word txPeriods[] = { 800, 2000 };
+  KnxTelegram tg;
+  byte value[2] = { 0x0C, 0x1A }; // 21.0 degrees
+  unsigned long startTime, txDuration, wireTime, step;
+  word errorsNb = 0;
+
+  Serial.println(F("\n########## Telegram transmission bursts tests (SIM) ##########"));
+  tg.SetSourceAddress(0x1234);
+  tg.SetTargetAddress(0x0002);
+  tg.SetPayloadLength(3);
+  tg.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  tg.SetLongPayload(value, 2);
+  tg.UpdateChecksum();
+  wireTime = 2UL * tg.GetTelegramLength() * TPUART_CHAR_TIME_MICROSEC;
+  for (byte i = 0; i < sizeof(txPeriods) / sizeof(word); i++)
+  {
+    KnxTpUart tpuart(tpuartSim, 0x1234, NORMAL);
+#if defined(KNXTPUART_RX_INTERRUPT)
+    simTpUart = &tpuart;
+    tpuartSim.SetRxHook(SimRxInterrupt);
+#endif
+    SimStart(tpuart);
+    SimRun(tpuart, 2000); // the reset and init characters have left the UART
+    startTime = micros();
+    tpuart.SendTelegram(tg);
+    for (step = 1; !ackEvt && (step < 1000); step++) // 100ms max
+    {
+      delayMicroseconds(100);
+      tpuartSim.Task();
+      if (!(step % 4)) tpuart.RXTask();
+      if (!(step % (txPeriods[i] / 100))) tpuart.TXTask();
+    }
+    tpuartSim.SetRxHook(NULL);
+    txDuration = tpuartSim.GetTxEndTime() - startTime;
+    Serial.print(F("TX task period (us) ")); Serial.print(txPeriods[i]);
+    Serial.print(F(" : telegram sent in (us) ")); Serial.print(txDuration);
+    Serial.print(F(", wire time (us) ")); Serial.print(wireTime);
+    Serial.print(F(", ack = ")); Serial.println(ackVal);
+    if (!ackEvt || (ackVal != ACK_RESPONSE) || (tpuartSim.GetSentTelegramsNb() != 1)) errorsNb++;
+    if (txDuration > wireTime + txPeriods[i] + 100) errorsNb++;
+  }
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
+void Async_Reset_Sim(void)
+// (SIM) The TPUART does not answer the 3 first RESET REQUESTs (2 attempts of 10ms, no backoff) : the first reset
+// fails after 20ms and is started again, as KnxDevice::task() does. With StartReset(true), the reset duration
+// includes the failed reset (30ms), with StartReset() it only covers the last reset (10ms).
+{
+  const boolean restarts[] = { true, false };
+  e_TpUartResetStatus status;
+  word errorsNb = 0;
+
+  Serial.println(F("\n########## Async Reset Tests (SIM) ##########"));
+  for (byte i = 0; i < 2; i++)
+  {
+    KnxTpUart tpuart(tpuartSim, 0x1234, NORMAL);
+#if defined(KNXTPUART_RX_INTERRUPT)
+    simTpUart = &tpuart;
+    tpuartSim.SetRxHook(SimRxInterrupt);
+#endif
+    tpuart.SetResetPolicy(10, 0, 2);
+    tpuartSim.ClearStats();
+    tpuartSim.SetResetMuted(3);
+    tpuart.StartReset();
+    for (word step = 0; step < 1000; step++) // 100ms max
+    {
+      delayMicroseconds(100);
+      tpuartSim.Task();
+      status = tpuart.ResetTask();
+      if (status == TPUART_RESET_STATUS_DONE) break;
+      if (status == TPUART_RESET_STATUS_FAILED) tpuart.StartReset(restarts[i]);
+    }
+    tpuartSim.SetRxHook(NULL);
+    Serial.print(F("StartReset(")); Serial.print(restarts[i]);
+    Serial.print(F(") on failure : status = ")); Serial.print(status);
+    Serial.print(F(", requests nb = ")); Serial.print(tpuartSim.GetResetsNb());
+    Serial.print(F(", reset duration (ms) = ")); Serial.println(tpuart.GetLastResetDuration());
+    if ((status != TPUART_RESET_STATUS_DONE) || (tpuartSim.GetResetsNb() != 4)) errorsNb++;
+    if (restarts[i] && ((tpuart.GetLastResetDuration() < 30) || (tpuart.GetLastResetDuration() > 32))) errorsNb++;
+    if (!restarts[i] && (tpuart.GetLastResetDuration() > 12)) errorsNb++;
+  }
+  Serial.print(F("Errors : ")); Serial.println(errorsNb);
+}
+
+
 void All_Tests(void)
 {
   Reset_Tests(); TracesDisplay();
+  Async_Reset_Tests(); TracesDisplay();
+  Async_Reset_Sim(); TracesDisplay();
   Attach_Tests(); TracesDisplay();
   Init_Tests(); TracesDisplay();
   Bus_Monitoring(); TracesDisplay();
   Normal_Rx(); TracesDisplay();
+  Normal_Rx_Stall(); TracesDisplay();
+  Normal_Rx_Burst(); TracesDisplay();
+  Normal_Rx_Isr(); TracesDisplay();
   Normal_Rx_ResetEvt(); TracesDisplay();
   Normal_Rx_StateEvt(); TracesDisplay();
   Normal_Tx_Val0(); TracesDisplay();
@@ -675,4 +1071,5 @@ void All_Tests(void)
   Normal_Tx_NoAck(); TracesDisplay();
   Normal_Tx_Timeout(); TracesDisplay();
   Normal_Tx_Reset(); TracesDisplay();
+  Normal_Tx_Burst(); TracesDisplay();
 }
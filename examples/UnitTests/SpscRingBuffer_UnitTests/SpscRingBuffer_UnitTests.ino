@@ -0,0 +1,166 @@
+#include <SpscRingBuffer.h> // /!\ Turn "SPSCRINGBUFFER_STAT" define on in SpscRingBuffer.h to allow statistics info
+#include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
+#if !defined(__AVR__)
+#include <thread>
+#include <atomic>
+#endif
+
+Cli cli = Cli(Serial);
+
+SpscRingBuffer<long, 8> buffer; // Ring buffer containing up to 8 long values
+SpscRingBuffer<word, 512> stressBuffer; // Ring buffer shared between the producer (Timer1 ISR on AVR, a thread
+                                        // elsewhere) and the loop (consumer)
+long counter = 1;
+volatile word isrCounter = 0; // next value appended by the producer
+volatile word isrRejectedNb = 0; // nb of values rejected because the buffer was full
+
+void Add(void);
+void Pop(void);
+void Info(void);
+void Scenario(void);
+void Stress(void);
+
+
+void setup() {
+  cli.RegisterCmd("a",&Add);
+  cli.RegisterCmd("p",&Pop);
+  cli.RegisterCmd("i",&Info);
+  cli.RegisterCmd("s",&Scenario);
+  cli.RegisterCmd("t",&Stress);
+  Serial.begin(115200);
+}
+
+
+void loop() {
+  cli.Run();
+}
+
+
+void Info() {
+  String str;
+  str = " => Info() :\n"; buffer.Info(str);
+  Serial.print(str);
+}
+
+
+void Add(void) {
+  if (buffer.TryAppend(counter))
+  {
+    Serial.print(F("Value ")); Serial.print(counter,DEC); Serial.println(F(" appended"));
+    counter++;
+  }
+  else
+  {
+    Serial.print(F("Value ")); Serial.print(counter,DEC); Serial.println(F(" rejected : buffer full!"));
+  }
+}
+
+
+void Pop(void) {
+  boolean result;
+  long popVal;
+  result = buffer.Pop(popVal);
+  if (result) {
+  Serial.print(F("Popped value ")); Serial.println(popVal,DEC);
+  }
+  else Serial.println(F("No value popped : buffer empty!"));
+}
+
+
+void Scenario(void) {
+  Info(); // Buffer empty
+  for( int i=1; i<=7; i++) Add(); // Append 7 elements (value 1 to 7)
+  Info(); // show 7 elements
+  Add(); // Append value 8
+  Info(); // show 8 elements
+  Pop(); //  value 1 popped
+  Info(); // show 7 elements
+  for( int i=1; i<=7; i++) Pop(); // Pop 7 elements (value 2 to 8)
+  Info(); // buffer is empty
+  Pop(); // tell buffer is empty
+  Serial.println("counter value reset"); counter = 1;
+  for( int i=1; i<=8; i++) Add(); // Append 8 elements (value 1 to 8)
+  Info(); // show 8 elements
+  Add(); //  value 9 is rejected, value 1 is NOT overwritten
+  Info(); // tell one element is rejected
+  for( int i=1; i<=8; i++) Pop(); // Pop value 1 to 8
+  Pop(); // tell buffer is empty
+}
+
+
+#if defined(__AVR__)
+// Timer1 compare interrupt : producer side of the stress test
+ISR(TIMER1_COMPA_vect)
+{
+  word value = isrCounter;
+  if (stressBuffer.TryAppend(value)) isrCounter = value + 1;
+  else isrRejectedNb++;
+}
+
+
+// Start the producer : Timer1 interrupt every 20us
+void StartProducer(void) {
+  noInterrupts();
+  TCCR1A = 0; TCCR1B = _BV(WGM12) | _BV(CS10); // CTC mode, no prescaler
+  OCR1A = 319; // 16MHz / 320 = 50kHz
+  TIMSK1 |= _BV(OCIE1A);
+  interrupts();
+}
+
+
+void StopProducer(void) { TIMSK1 &= ~_BV(OCIE1A); }
+#else
+std::atomic<bool> producerRunning(false);
+std::thread producer;
+
+// Producer thread of the stress test : values are appended as fast as possible, the thread yields when the
+// buffer is full
+void ProduceValues(void) {
+  word value;
+  while (producerRunning.load())
+  {
+    value = isrCounter;
+    if (stressBuffer.TryAppend(value)) isrCounter = value + 1;
+    else { isrRejectedNb++; std::this_thread::yield(); }
+  }
+}
+
+
+void StartProducer(void) { producerRunning = true; producer = std::thread(ProduceValues); }
+
+
+void StopProducer(void) { producerRunning = false; producer.join(); }
+#endif
+
+
+// Stress test : values are appended by the producer (Timer1 ISR every 20us on AVR, a thread running on another
+// core elsewhere) and popped by the loop during 5 seconds
+// The popped values shall be consecutive, whatever the interrupt position or the threads interleaving, and all
+// the appended values shall be popped
+void Stress(void) {
+  word expected = 0, popVal;
+  unsigned long poppedNb = 0, errorsNb = 0;
+  unsigned long startTime;
+
+  isrCounter = 0; isrRejectedNb = 0;
+  StartProducer();
+  startTime = millis();
+  while (millis() - startTime < 5000)
+  {
+    if (stressBuffer.Pop(popVal))
+    {
+      if (popVal != expected) errorsNb++;
+      expected = popVal + 1;
+      poppedNb++;
+    }
+  }
+  StopProducer();
+  while (stressBuffer.Pop(popVal)) { if (popVal != expected) errorsNb++; expected = popVal + 1; poppedNb++; }
+
+  Serial.print(F("Popped values : ")); Serial.println(poppedNb,DEC);
+  Serial.print(F("Ops per sec : ")); Serial.println(poppedNb/5,DEC);
+  Serial.print(F("Rejected values (buffer full) : ")); Serial.println(isrRejectedNb,DEC);
+  Serial.print(F("Sequence errors : ")); Serial.println(errorsNb,DEC);
+  if ((word)poppedNb != isrCounter) errorsNb++; // values lost
+  Serial.print(F("Errors : ")); Serial.println(errorsNb,DEC);
+}